@@ -0,0 +1,90 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory/async_memory.hpp>
+#include <remote_memory/detail/linux/procmem.hpp>
+#include <atomic>
+
+namespace {
+
+    constexpr std::size_t reads     = 1024;
+    constexpr std::size_t read_size = 256;
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(reads * read_size * 4);
+        return child;
+    }
+
+    std::vector<std::uint8_t> buffer(reads * read_size);
+
+    // 1024 scattered small reads handed to the engine at once, then waited for
+    void scattered_reads(bench::state& state, remote::async_memory& memory)
+    {
+        std::atomic<std::size_t> completed{0};
+        state.bytes_per_iteration(reads * read_size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            for (std::size_t r = 0; r < reads; ++r)
+                memory.read(target().address() + r * read_size * 4, buffer.data() + r * read_size, read_size
+                            , [&](const std::error_code&, std::size_t) { ++completed; });
+            memory.drain();
+        }
+
+        bench::do_not_optimize(completed.load());
+    }
+
+    remote::async_options options(std::size_t submit_batch, bool thread_pool)
+    {
+        remote::async_options o;
+        o.queue_depth  = 1024;
+        o.submit_batch = submit_batch;
+        o.thread_pool  = thread_pool;
+        return o;
+    }
+
+} // namespace
+
+BENCHMARK("async/latency/io_uring")
+{
+    static remote::async_memory memory(target().pid());
+    std::uint64_t               value;
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(memory.read(target().address(), &value, sizeof(value)).get());
+}
+
+BENCHMARK("async/latency/thread_pool")
+{
+    static remote::async_memory memory(target().pid(), options(1, true));
+    std::uint64_t               value;
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(memory.read(target().address(), &value, sizeof(value)).get());
+}
+
+BENCHMARK("async/scattered/io_uring_batch_1")
+{
+    static remote::async_memory memory(target().pid(), options(1, false));
+    scattered_reads(state, memory);
+}
+
+BENCHMARK("async/scattered/io_uring_batch_32")
+{
+    static remote::async_memory memory(target().pid(), options(32, false));
+    scattered_reads(state, memory);
+}
+
+BENCHMARK("async/scattered/thread_pool")
+{
+    static remote::async_memory memory(target().pid(), options(1, true));
+    scattered_reads(state, memory);
+}
+
+BENCHMARK("async/scattered/pread")
+{
+    std::error_code ec;
+    static const auto fd = remote::detail::open_procmem(target().pid(), ec);
+    state.bytes_per_iteration(reads * read_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t r = 0; r < reads; ++r)
+            remote::detail::procmem_read(fd.get(), target().address() + r * read_size * 4
+                                         , buffer.data() + r * read_size, read_size, ec);
+    bench::do_not_optimize(buffer[0]);
+}
@@ -0,0 +1,116 @@
+#ifndef REMOTE_MEMORY_BENCH_HPP
+#define REMOTE_MEMORY_BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    /// \brief The number of heap allocations made by the process so far.
+    std::size_t allocations() noexcept;
+
+    class state {
+        std::size_t                     _iterations;
+        std::size_t                     _bytes_per_iteration = 0;
+        const std::vector<std::size_t>* _arguments;
+
+    public:
+        state(std::size_t iterations, const std::vector<std::size_t>& arguments) noexcept
+                : _iterations(iterations), _arguments(&arguments)
+        {}
+
+        std::size_t iterations() const noexcept { return _iterations; }
+
+        /// \brief The i-th argument of a benchmark registered with argument sets.
+        std::size_t argument(std::size_t i) const { return _arguments->at(i); }
+
+        /// \brief Lets the report include throughput.
+        void bytes_per_iteration(std::size_t bytes) noexcept { _bytes_per_iteration = bytes; }
+        std::size_t bytes_per_iteration() const noexcept { return _bytes_per_iteration; }
+    };
+
+    using function = void (*)(state&);
+
+    struct benchmark {
+        std::string              name;
+        function                 run;
+        std::vector<std::size_t> arguments;
+    };
+
+    std::vector<benchmark>& registry();
+
+    using argument_sets = std::vector<std::vector<std::size_t>>;
+
+    /// \brief from, from * multiplier, ... up to and including to.
+    inline std::vector<std::size_t> range(std::size_t from, std::size_t to, std::size_t multiplier)
+    {
+        std::vector<std::size_t> values;
+        for (auto value = from; value <= to; value *= multiplier)
+            values.push_back(value);
+        return values;
+    }
+
+    /// \brief Every combination of one value from each list, the last list varying fastest.
+    inline argument_sets product(std::initializer_list<std::vector<std::size_t>> lists)
+    {
+        argument_sets sets{{}};
+        for (const auto& list : lists) {
+            argument_sets next;
+            for (const auto& set : sets)
+                for (auto value : list) {
+                    next.push_back(set);
+                    next.back().push_back(value);
+                }
+            sets.swap(next);
+        }
+        return sets;
+    }
+
+    struct registration {
+        registration(const char* name, function run) { registry().push_back({name, run, {}}); }
+
+        /// \brief Registers the benchmark once per argument set, named name/argument0/argument1...
+        registration(const char* name, function run, const argument_sets& sets)
+        {
+            for (const auto& arguments : sets) {
+                std::string full_name = name;
+                for (auto argument : arguments)
+                    full_name += '/' + std::to_string(argument);
+                registry().push_back({full_name, run, arguments});
+            }
+        }
+    };
+
+    /// \brief Prevents the compiler from optimizing away the computation of value.
+    template<class T>
+    inline void do_not_optimize(const T& value) noexcept
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+} // namespace bench
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+/// \brief Registers a benchmark. The body receives a bench::state& named state and must run
+///        state.iterations() iterations of the measured operation.
+#define BENCHMARK(name)                                                                          \
+    static void BENCH_CONCAT(bench_function_, __LINE__)(bench::state&);                         \
+    static bench::registration BENCH_CONCAT(bench_registration_, __LINE__)(                      \
+            name, &BENCH_CONCAT(bench_function_, __LINE__));                                     \
+    static void BENCH_CONCAT(bench_function_, __LINE__)(bench::state & state)
+
+/// \brief Registers a benchmark once per set of arguments, which the body reads with state.argument(i).
+/// \code BENCHMARK_ARGUMENTS("read", bench::product({bench::range(8, 4096, 8), {1, 2, 4}}))
+#define BENCHMARK_ARGUMENTS(name, sets)                                                          \
+    static void BENCH_CONCAT(bench_function_, __LINE__)(bench::state&);                         \
+    static bench::registration BENCH_CONCAT(bench_registration_, __LINE__)(                      \
+            name, &BENCH_CONCAT(bench_function_, __LINE__), sets);                               \
+    static void BENCH_CONCAT(bench_function_, __LINE__)(bench::state & state)
+
+#endif // include guard
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <sys/mman.h>
+
+namespace {
+
+    constexpr std::size_t page = 4096;
+    constexpr std::size_t size = 64 * 1024 * 1024;
+
+    // 64 MiB with a guard page every 4 MiB and one 4 MiB hole, the way thread stacks and arenas look
+    std::uint8_t* sparse()
+    {
+        static const auto memory = [] {
+            auto m = static_cast<std::uint8_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE
+                                                       , MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+            for (std::size_t offset = 4 * 1024 * 1024; offset < size; offset += 4 * 1024 * 1024)
+                ::mprotect(m + offset, page, PROT_NONE);
+            ::mprotect(m + 32 * 1024 * 1024 + page, 4 * 1024 * 1024 - page, PROT_NONE);
+            return m;
+        }();
+        return memory;
+    }
+
+    remote::memory            mem;
+    std::vector<std::uint8_t> destination(size);
+
+} // namespace
+
+BENCHMARK("best_effort/sparse_64m/best_effort")
+{
+    remote::best_effort_result result;
+    state.bytes_per_iteration(size);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        mem.read_best_effort(sparse(), destination.data(), size, result);
+        bench::do_not_optimize(result.transferred);
+    }
+}
+
+BENCHMARK("best_effort/sparse_64m/page_by_page")
+{
+    state.bytes_per_iteration(size);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t offset = 0; offset < size; offset += page) {
+            std::error_code ec;
+            mem.read(sparse() + offset, destination.data() + offset, page, ec);
+            bench::do_not_optimize(ec);
+        }
+}
+
+BENCHMARK("best_effort/dense_64m/read")
+{
+    // the same amount of readable memory without holes, the speed best_effort should stay close to
+    static const auto dense = static_cast<std::uint8_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE
+                                                                , MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+    state.bytes_per_iteration(size);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        remote::read_request request(dense, destination.data(), size);
+        mem.read_many(&request, 1);
+        bench::do_not_optimize(request.transferred);
+    }
+}
@@ -0,0 +1,55 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/cached_operations_policy.hpp>
+
+namespace {
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(1024 * 1024);
+        return child;
+    }
+
+    // reads the 8 byte fields of 64 byte objects spread over 16 pages, the way a tool walks an entity list
+    template<class Memory>
+    void field_reads(bench::state& state, const Memory& memory)
+    {
+        constexpr std::size_t objects = 16 * 4096 / 64;
+        state.bytes_per_iteration(objects * 8 * 8);
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            for (std::size_t object = 0; object < objects; ++object)
+                for (std::size_t field = 0; field < 8; ++field)
+                    bench::do_not_optimize(memory.template read<std::uint64_t>(target().address() + object * 64
+                                                                               + field * 8));
+    }
+
+} // namespace
+
+BENCHMARK("field_reads/uncached")
+{
+    static const remote::basic_memory<remote::operations_policy> memory(target().pid());
+    field_reads(state, memory);
+}
+
+BENCHMARK("field_reads/cached")
+{
+    static remote::basic_memory<remote::cached_operations_policy<>> memory(target().pid());
+    memory.max_age(std::numeric_limits<std::uint64_t>::max());
+    field_reads(state, memory);
+}
+
+BENCHMARK("field_reads/cached_per_iteration")
+{
+    // the cache is dropped once per pass, so every page is filled again
+    static remote::basic_memory<remote::cached_operations_policy<>> memory(target().pid());
+    memory.prefetch(16);
+    constexpr std::size_t objects = 16 * 4096 / 64;
+    state.bytes_per_iteration(objects * 8 * 8);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        memory.next_epoch();
+        for (std::size_t object = 0; object < objects; ++object)
+            for (std::size_t field = 0; field < 8; ++field)
+                bench::do_not_optimize(memory.read<std::uint64_t>(target().address() + object * 64 + field * 8));
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef REMOTE_MEMORY_BENCH_CHILD_PROCESS_HPP
+#define REMOTE_MEMORY_BENCH_CHILD_PROCESS_HPP
+
+#if !defined(__linux__)
+    #error child_process is only available on linux
+#endif
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench {
+
+    /// \brief Forks a child that maps size bytes of pseudo random anonymous memory and then sleeps
+    ///        until it is killed, giving benchmarks a real remote target.
+    class child_process {
+        pid_t          _pid     = -1;
+        std::uintptr_t _address = 0;
+        std::size_t    _size;
+
+    public:
+        explicit child_process(std::size_t size) : _size(size)
+        {
+            int fds[2];
+            if (::pipe(fds) == -1)
+                throw std::runtime_error("pipe() failed");
+
+            _pid = ::fork();
+            if (_pid == -1)
+                throw std::runtime_error("fork() failed");
+
+            if (_pid == 0) {
+                ::close(fds[0]);
+                auto memory = static_cast<std::uint64_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE
+                                                                 , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+                // xorshift so the data is not trivially compressible or matchable
+                std::uint64_t state = 0x9E3779B97F4A7C15ull;
+                for (std::size_t i = 0; memory != MAP_FAILED && i < size / sizeof(std::uint64_t); ++i) {
+                    state ^= state << 13;
+                    state ^= state >> 7;
+                    state ^= state << 17;
+                    memory[i] = state;
+                }
+
+                const auto address = memory == MAP_FAILED ? 0 : reinterpret_cast<std::uintptr_t>(memory);
+                if (::write(fds[1], &address, sizeof(address)) != sizeof(address))
+                    ::_exit(1);
+
+                for (;;)
+                    ::pause();
+            }
+
+            ::close(fds[1]);
+            const auto read = ::read(fds[0], &_address, sizeof(_address));
+            ::close(fds[0]);
+            if (read != sizeof(_address) || !_address)
+                throw std::runtime_error("child process failed to start");
+        }
+
+        ~child_process()
+        {
+            if (_pid > 0) {
+                ::kill(_pid, SIGKILL);
+                ::waitpid(_pid, nullptr, 0);
+            }
+        }
+
+        child_process(const child_process&) = delete;
+        child_process& operator=(const child_process&) = delete;
+
+        pid_t pid() const noexcept { return _pid; }
+        std::uintptr_t address() const noexcept { return _address; }
+        std::size_t size() const noexcept { return _size; }
+    };
+
+    /// \brief Forks a child that sleeps until it is killed. The child is a copy of this process, so objects built
+    ///        before the fork can be read from it at their local addresses.
+    class forked_process {
+        pid_t _pid;
+
+    public:
+        forked_process() : _pid(::fork())
+        {
+            if (_pid == -1)
+                throw std::runtime_error("fork() failed");
+
+            if (_pid == 0)
+                for (;;)
+                    ::pause();
+        }
+
+        ~forked_process()
+        {
+            ::kill(_pid, SIGKILL);
+            ::waitpid(_pid, nullptr, 0);
+        }
+
+        forked_process(const forked_process&) = delete;
+        forked_process& operator=(const forked_process&) = delete;
+
+        pid_t pid() const noexcept { return _pid; }
+    };
+
+} // namespace bench
+
+#endif // include guard
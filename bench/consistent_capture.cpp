@@ -0,0 +1,59 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/consistent_capture.hpp>
+
+// a capture of a sleeping child with and without pausing it, the difference is the cost of the freeze itself
+namespace {
+
+    constexpr std::size_t target_size = 16 * 1024 * 1024;
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(target_size);
+        return child;
+    }
+
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+    };
+
+    template<class Capture>
+    void capture(bench::state& state, Capture capture)
+    {
+        const remote::memory mem(target().pid());
+        remote::snapshot     snap;
+        const range          regions[] = {{target().address(), target().address() + state.argument(0)}};
+        state.bytes_per_iteration(state.argument(0));
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            capture(mem, snap, regions);
+    }
+
+} // namespace
+
+BENCHMARK_ARGUMENTS("consistent_capture/running", bench::product({bench::range(4096, target_size, 64)}))
+{
+    capture(state, [](const remote::memory& mem, remote::snapshot& snap, const range(&regions)[1]) {
+        snap.capture(mem, regions);
+    });
+}
+
+BENCHMARK_ARGUMENTS("consistent_capture/signal", bench::product({bench::range(4096, target_size, 64)}))
+{
+    remote::consistent_capture_options options;
+    options.method = remote::freeze_method::signal;
+    capture(state, [&](const remote::memory& mem, remote::snapshot& snap, const range(&regions)[1]) {
+        bench::do_not_optimize(remote::capture_consistent(snap, mem, target().pid(), regions, options).pause);
+    });
+}
+
+BENCHMARK_ARGUMENTS("consistent_capture/signal/no_precopy", bench::product({bench::range(4096, target_size, 64)}))
+{
+    remote::consistent_capture_options options;
+    options.method  = remote::freeze_method::signal;
+    options.precopy = false;
+    capture(state, [&](const remote::memory& mem, remote::snapshot& snap, const range(&regions)[1]) {
+        bench::do_not_optimize(remote::capture_consistent(snap, mem, target().pid(), regions, options).pause);
+    });
+}
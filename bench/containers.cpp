@@ -0,0 +1,84 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/containers.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+    constexpr int nodes = 100000;
+
+    struct target {
+        std::map<int, std::uint64_t>           map;
+        std::unordered_map<int, std::uint64_t> unordered_map;
+        std::vector<std::uint64_t>             vector;
+        bench::forked_process                  child;
+        remote::memory                         memory;
+
+        static std::map<int, std::uint64_t> make_map()
+        {
+            std::map<int, std::uint64_t> m;
+            for (int i = 0; i < nodes; ++i)
+                m[(i * 7919) % 100003] = static_cast<std::uint64_t>(i);
+            return m;
+        }
+
+        target()
+                : map(make_map())
+                , unordered_map(map.begin(), map.end())
+                , vector(nodes, 1)
+                , child()
+                , memory(child.pid())
+        {}
+    };
+
+    target& process()
+    {
+        static target t;
+        return t;
+    }
+
+    // the way it is done without the readers: one read per node
+    std::size_t hop_by_hop(const remote::memory& memory, std::uintptr_t node)
+    {
+        if (!node)
+            return 0;
+
+        std::uintptr_t links[4];
+        memory.read(node, links, sizeof(links));
+        return 1 + hop_by_hop(memory, links[2]) + hop_by_hop(memory, links[3]);
+    }
+
+} // namespace
+
+BENCHMARK("containers/map_100k/hop_by_hop")
+{
+    auto& t = process();
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(hop_by_hop(t.memory, t.memory.read<std::uintptr_t>(
+                reinterpret_cast<std::uintptr_t>(&t.map) + 16)));
+}
+
+BENCHMARK("containers/map_100k/read")
+{
+    auto& t = process();
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(remote::libstdcxx::read<remote::libstdcxx::map<int, std::uint64_t>>(t.memory, &t.map));
+}
+
+BENCHMARK("containers/unordered_map_100k/read")
+{
+    auto& t = process();
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(remote::libstdcxx::read<remote::libstdcxx::unordered_map<int, std::uint64_t>>(
+                t.memory, &t.unordered_map));
+}
+
+BENCHMARK("containers/vector_100k/read")
+{
+    auto& t = process();
+    state.bytes_per_iteration(nodes * sizeof(std::uint64_t));
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(remote::libstdcxx::read<remote::libstdcxx::vector<std::uint64_t>>(t.memory, &t.vector));
+}
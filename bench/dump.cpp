@@ -0,0 +1,79 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/dump.hpp>
+#include <remote_memory/region_map.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+    constexpr std::size_t dump_size = 256 * 1024 * 1024;
+    const char* const     dump_path = "remote_memory_bench.dump";
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(dump_size);
+        return child;
+    }
+
+    struct target_region {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::uint8_t   permissions;
+        const char*    path;
+    };
+
+    void dump(bench::state& state, bool zero_copy)
+    {
+        static const remote::basic_memory<remote::operations_policy> memory(target().pid());
+        const target_region regions[] = {{target().address(), target().address() + target().size()
+                                          , remote::protection::read | remote::protection::write, ""}};
+
+        remote::dump_options options;
+        options.zero_copy = zero_copy;
+        state.bytes_per_iteration(dump_size);
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            bench::do_not_optimize(remote::dump_regions(memory, regions, dump_path, options).bytes);
+
+        std::remove(dump_path);
+    }
+
+} // namespace
+
+BENCHMARK("dump/zero_copy") { dump(state, true); }
+BENCHMARK("dump/double_buffered") { dump(state, false); }
+
+BENCHMARK("dump/read_then_write")
+{
+    // what dumping looked like before: read a chunk, then write it, on one thread
+    static const remote::basic_memory<remote::operations_policy> memory(target().pid());
+    std::vector<std::uint8_t>                                     buffer(REMOTE_MEMORY_DUMP_CHUNK_SIZE);
+    state.bytes_per_iteration(dump_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto file = std::fopen(dump_path, "wb");
+        for (std::size_t offset = 0; offset < dump_size; offset += buffer.size()) {
+            memory.read(target().address() + offset, buffer.data(), buffer.size());
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+        }
+        std::fclose(file);
+    }
+
+    std::remove(dump_path);
+}
+
+BENCHMARK("dump/gcore")
+{
+    // gcore dumps every mapping of the target, which is dominated by the benchmark mapping
+    static const bool installed = std::system("command -v gcore > /dev/null 2>&1") == 0;
+    if (!installed)
+        return;
+
+    const auto command = "gcore -o remote_memory_bench.core " + std::to_string(target().pid()) + " > /dev/null 2>&1";
+    state.bytes_per_iteration(dump_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(std::system(command.c_str()));
+
+    std::remove(("remote_memory_bench.core." + std::to_string(target().pid())).c_str());
+}
@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/fleet.hpp>
+#include <memory>
+
+// the same handful of variables read from up to 200 forked copies of the benchmark
+namespace {
+
+    struct monitored {
+        std::uint64_t counters[8];
+        char          status[64];
+    } variables;
+
+    const std::vector<remote::fleet_field>& fields()
+    {
+        static const std::vector<remote::fleet_field> f = {
+                remote::make_fleet_field<std::uint64_t>(&variables.counters[0])
+                , remote::make_fleet_field<std::uint64_t>(&variables.counters[5])
+                , {&variables.status, sizeof(variables.status)}};
+        return f;
+    }
+
+    std::vector<std::unique_ptr<bench::forked_process>>& children(std::size_t count)
+    {
+        static std::vector<std::unique_ptr<bench::forked_process>> processes;
+        while (processes.size() < count)
+            processes.emplace_back(new bench::forked_process());
+        return processes;
+    }
+
+} // namespace
+
+BENCHMARK_ARGUMENTS("fleet/serial", bench::product({{8, 64, 200}}))
+{
+    const auto  count = state.argument(0);
+    const auto& procs = children(count);
+
+    std::vector<remote::memory> memories;
+    for (std::size_t p = 0; p < count; ++p)
+        memories.emplace_back(procs[p]->pid());
+
+    std::vector<std::uint8_t>         buffer(count * 80);
+    std::vector<remote::read_request> requests(fields().size());
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t p = 0; p < count; ++p) {
+            std::size_t offset = 0;
+            for (std::size_t f = 0; f < fields().size(); ++f) {
+                requests[f] = remote::read_request(fields()[f].address, buffer.data() + p * 80 + offset
+                                                   , fields()[f].size);
+                offset += fields()[f].size;
+            }
+            memories[p].read_many(requests.data(), requests.size());
+        }
+}
+
+BENCHMARK_ARGUMENTS("fleet/pool", bench::product({{8, 64, 200}, {1, 2, 4}}))
+{
+    const auto  count = state.argument(0);
+    const auto& procs = children(count);
+
+    remote::fleet fleet(state.argument(1));
+    for (std::size_t p = 0; p < count; ++p)
+        fleet.add(procs[p]->pid());
+
+    remote::fleet_result result;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        fleet.read(fields(), result);
+        bench::do_not_optimize(result.column(0)[0]);
+    }
+}
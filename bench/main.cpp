@@ -0,0 +1,151 @@
+#include "bench.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+    std::atomic<std::size_t> allocation_count{0};
+
+    struct result {
+        double      ns_per_iteration;
+        double      allocations_per_iteration;
+        std::size_t bytes_per_iteration;
+        std::size_t iterations;
+    };
+
+    result measure(const bench::benchmark& benchmark, std::size_t iterations)
+    {
+        bench::state state(iterations, benchmark.arguments);
+
+        const auto allocations_before = bench::allocations();
+        const auto start              = std::chrono::steady_clock::now();
+        benchmark.run(state);
+        const auto elapsed            = std::chrono::steady_clock::now() - start;
+        const auto allocations_after  = bench::allocations();
+
+        const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        return {ns / iterations
+                , static_cast<double>(allocations_after - allocations_before) / iterations
+                , state.bytes_per_iteration()
+                , iterations};
+    }
+
+    result run(const bench::benchmark& benchmark)
+    {
+        // a warm up run so lazily built inputs are not measured
+        measure(benchmark, 1);
+
+        // grow the iteration count until a run takes long enough to be measured reliably
+        std::size_t iterations = 1;
+        for (;;) {
+            const auto r = measure(benchmark, iterations);
+            if (r.ns_per_iteration * iterations > 2e8 || iterations >= (std::size_t{1} << 30))
+                return r;
+
+            iterations *= 4;
+        }
+    }
+
+    double megabytes_per_second(const result& r) noexcept
+    {
+        return r.bytes_per_iteration ? r.bytes_per_iteration * 1e3 / r.ns_per_iteration : 0.0;
+    }
+
+    void print_json_string(const std::string& s)
+    {
+        std::putchar('"');
+        for (auto c : s) {
+            if (c == '"' || c == '\\')
+                std::putchar('\\');
+            std::putchar(c);
+        }
+        std::putchar('"');
+    }
+
+    void print_json(const bench::benchmark& benchmark, const result& r, bool first)
+    {
+        std::printf("%s\n    {\"name\": ", first ? "" : ",");
+        print_json_string(benchmark.name);
+        std::printf(", \"arguments\": [");
+        for (std::size_t i = 0; i < benchmark.arguments.size(); ++i)
+            std::printf("%s%zu", i ? ", " : "", benchmark.arguments[i]);
+        std::printf("], \"iterations\": %zu, \"ns_per_op\": %.1f, \"bytes_per_op\": %zu, \"mb_per_s\": %.1f"
+                    ", \"allocs_per_op\": %.3f}"
+                    , r.iterations
+                    , r.ns_per_iteration
+                    , r.bytes_per_iteration
+                    , megabytes_per_second(r)
+                    , r.allocations_per_iteration);
+        std::fflush(stdout);
+    }
+
+} // namespace
+
+namespace bench {
+
+    std::size_t allocations() noexcept { return allocation_count.load(std::memory_order_relaxed); }
+
+    std::vector<benchmark>& registry()
+    {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+} // namespace bench
+
+void* operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// usage: remote_memory_bench [--json] [filter]
+int main(int argc, char* argv[])
+{
+    bool        json   = false;
+    const char* filter = ""; // optional substring filter of benchmark names
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+            filter = argv[i];
+    }
+
+    if (json)
+        std::printf("{\"benchmarks\": [");
+    else
+        std::printf("%-48s %14s %12s %12s\n", "benchmark", "ns/op", "MB/s", "allocs/op");
+
+    bool first = true;
+    for (auto& benchmark : bench::registry()) {
+        if (!std::strstr(benchmark.name.c_str(), filter))
+            continue;
+
+        const auto r = run(benchmark);
+        if (json)
+            print_json(benchmark, r, first);
+        else
+            std::printf("%-48s %14.1f %12.1f %12.3f\n"
+                        , benchmark.name.c_str()
+                        , r.ns_per_iteration
+                        , megabytes_per_second(r)
+                        , r.allocations_per_iteration);
+        first = false;
+    }
+
+    if (json)
+        std::printf("\n]}\n");
+}
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/mapped_operations_policy.hpp>
+#include <sys/mman.h>
+
+// reads of memory a forked child shares with the benchmark, through process_vm_readv and through a local mapping
+namespace {
+
+    constexpr std::size_t size = 16 * 1024 * 1024;
+
+    std::uint8_t* shared()
+    {
+        static const auto memory = static_cast<std::uint8_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE
+                                                                     , MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE
+                                                                     , -1, 0));
+        return memory;
+    }
+
+    bench::forked_process& target()
+    {
+        shared();
+        static bench::forked_process child;
+        return child;
+    }
+
+    const remote::region_map& regions()
+    {
+        static const remote::region_map map(target().pid());
+        return map;
+    }
+
+    std::vector<std::uint8_t> destination(size);
+
+    template<class Memory>
+    void read(bench::state& state, const Memory& mem, std::size_t n)
+    {
+        state.bytes_per_iteration(n);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            mem.read(shared(), destination.data(), n);
+            bench::do_not_optimize(destination[0]);
+        }
+    }
+
+} // namespace
+
+BENCHMARK_ARGUMENTS("mapped/shared/vm_readv", bench::product({{8, 4096, 1024 * 1024}}))
+{
+    static const remote::memory mem(target().pid());
+    read(state, mem, state.argument(0));
+}
+
+BENCHMARK_ARGUMENTS("mapped/shared/mapped", bench::product({{8, 4096, 1024 * 1024}}))
+{
+    static const remote::basic_memory<remote::mapped_operations_policy<>> mem(regions(), target().pid());
+    read(state, mem, state.argument(0));
+}
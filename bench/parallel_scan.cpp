@@ -0,0 +1,38 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/parallel_scan.hpp>
+
+namespace {
+
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+    };
+
+    const bench::child_process& target()
+    {
+        static const bench::child_process child(512 * 1024 * 1024);
+        return child;
+    }
+
+    void parallel_pattern_scan(bench::state& state, std::size_t threads)
+    {
+        const auto&              child   = target();
+        const std::vector<range> regions = {{child.address(), child.address() + child.size()}};
+        const auto               pid     = child.pid();
+
+        remote::parallel_scanner scanner(threads);
+        const remote::pattern_kernel kernel(remote::pattern("48 8B 05 ?? ?? ?? ?? 48 85 C0 74 ??"));
+
+        state.bytes_per_iteration(child.size());
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            bench::do_not_optimize(scanner.scan([pid] { return remote::memory(pid); }, regions, kernel));
+    }
+
+} // namespace
+
+BENCHMARK("parallel_scan/threads:1") { parallel_pattern_scan(state, 1); }
+BENCHMARK("parallel_scan/threads:2") { parallel_pattern_scan(state, 2); }
+BENCHMARK("parallel_scan/threads:4") { parallel_pattern_scan(state, 4); }
+BENCHMARK("parallel_scan/threads:8") { parallel_pattern_scan(state, 8); }
@@ -0,0 +1,88 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/pattern_scan.hpp>
+#include <random>
+
+namespace {
+
+    remote::memory mem;
+
+    // the pattern never occurs in the data, so every benchmark has to look at every byte
+    const remote::pattern needle("48 8B 05 ?? ?? ?? ?? 48 85 C0 74 ??");
+
+    const std::vector<std::uint8_t>& haystack()
+    {
+        static const auto data = [] {
+            std::vector<std::uint8_t>                  bytes(64 * 1024 * 1024);
+            std::mt19937                               random(1337);
+            std::uniform_int_distribution<unsigned>    byte(0, 255);
+            for (auto& b : bytes)
+                b = static_cast<std::uint8_t>(byte(random));
+            return bytes;
+        }();
+        return data;
+    }
+
+    template<class Kernel>
+    void local_scan(bench::state& state, Kernel kernel)
+    {
+        const auto& data = haystack();
+        state.bytes_per_iteration(data.size());
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            std::size_t matches  = 0;
+            auto        callback = [&](std::size_t) { ++matches; return true; };
+            kernel(data.data(), data.size(), callback);
+            bench::do_not_optimize(matches);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("pattern/naive_memcmp")
+{
+    const auto& p = needle.view();
+    local_scan(state, [&](const std::uint8_t* data, std::size_t size, auto& callback) {
+        for (std::size_t pos = 0; pos + p.size <= size; ++pos)
+            if (remote::detail::pattern_matches(data + pos, p))
+                callback(pos);
+    });
+}
+
+BENCHMARK("pattern/scalar")
+{
+    local_scan(state, [](const std::uint8_t* data, std::size_t size, auto& callback) {
+        remote::detail::find_pattern_scalar(data, size, needle.view(), 0, callback);
+    });
+}
+
+#if defined(REMOTE_MEMORY_X86_SIMD)
+
+BENCHMARK("pattern/sse2")
+{
+    local_scan(state, [](const std::uint8_t* data, std::size_t size, auto& callback) {
+        remote::detail::find_pattern_sse2(data, size, needle.view(), callback);
+    });
+}
+
+BENCHMARK("pattern/avx2")
+{
+    if (remote::detail::detected_simd_level() != remote::detail::simd_level::avx2)
+        return;
+
+    local_scan(state, [](const std::uint8_t* data, std::size_t size, auto& callback) {
+        remote::detail::find_pattern_avx2(data, size, needle.view(), callback);
+    });
+}
+
+#endif
+
+BENCHMARK("pattern/remote_scan")
+{
+    const auto& data  = haystack();
+    const auto  begin = reinterpret_cast<std::uintptr_t>(data.data());
+
+    remote::pattern_scanner scanner;
+    state.bytes_per_iteration(data.size());
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(scanner.find_first(mem, begin, begin + data.size(), needle));
+}
@@ -0,0 +1,68 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <memory>
+
+namespace {
+
+    remote::memory mem;
+
+    constexpr std::size_t chain_count = 256;
+
+    // every chain walks base -> object -> component -> value, the shape of a typical entity lookup
+    struct component {
+        std::uint64_t padding[4];
+        std::uint64_t value;
+    };
+
+    struct object {
+        std::uint64_t padding[2];
+        component*    component_;
+    };
+
+    struct targets {
+        std::vector<component>      components = std::vector<component>(chain_count);
+        std::vector<object>         objects    = std::vector<object>(chain_count);
+        std::vector<object*>        roots      = std::vector<object*>(chain_count);
+        std::vector<std::ptrdiff_t> offsets{offsetof(object, component_), offsetof(component, value)};
+
+        targets()
+        {
+            for (std::size_t i = 0; i < chain_count; ++i) {
+                components[i].value   = i;
+                objects[i].component_ = &components[i];
+                roots[i]              = &objects[i];
+            }
+        }
+    };
+
+    targets& data()
+    {
+        static targets t;
+        return t;
+    }
+
+} // namespace
+
+BENCHMARK("pointer_chains/traverse")
+{
+    auto& t = data();
+    state.bytes_per_iteration(chain_count * 8);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t c = 0; c < chain_count; ++c)
+            bench::do_not_optimize(mem.traverse_pointers_chain(reinterpret_cast<std::uintptr_t>(&t.roots[c])
+                                                               , t.offsets[0], t.offsets[1]));
+}
+
+BENCHMARK("pointer_chains/resolve")
+{
+    auto&                              t = data();
+    std::vector<remote::pointer_chain> chains;
+    for (std::size_t c = 0; c < chain_count; ++c)
+        chains.emplace_back(&t.roots[c], t.offsets);
+
+    state.bytes_per_iteration(chain_count * 8);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        mem.resolve_pointer_chains(chains);
+        bench::do_not_optimize(chains[0].result);
+    }
+}
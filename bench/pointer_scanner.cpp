@@ -0,0 +1,102 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/pointer_scanner.hpp>
+#include <cstdio>
+#include <memory>
+
+// the target is a fork of the benchmark, scanning the own process would also find the pointers in the map being built
+namespace {
+
+    // a static root with three levels of 64 children below it, the kind of object graph paths are searched through
+    struct tree_node {
+        std::uint64_t          value;
+        std::vector<tree_node> children;
+    };
+
+    tree_node* root = nullptr;
+
+    void build(tree_node& node, std::size_t depth)
+    {
+        if (depth == 0)
+            return;
+
+        node.children.resize(64);
+        for (auto& child : node.children)
+            build(child, depth - 1);
+    }
+
+    tree_node* tree()
+    {
+        static std::unique_ptr<tree_node> nodes = [] {
+            std::unique_ptr<tree_node> r(new tree_node());
+            build(*r, 3);
+            return r;
+        }();
+        return nodes.get();
+    }
+
+    bench::forked_process& target()
+    {
+        // the tree is built before forking so the child holds it at the same addresses
+        root = tree();
+        static bench::forked_process child;
+        return child;
+    }
+
+    void scan(remote::pointer_scanner& scanner)
+    {
+        const auto pid = target().pid();
+        scanner.scan([pid] { return remote::memory(pid); }, remote::region_map(pid));
+    }
+
+    const remote::pointer_scanner& scanned()
+    {
+        static const remote::pointer_scanner scanner = [] {
+            remote::pointer_scanner s;
+            scan(s);
+            return s;
+        }();
+        return scanner;
+    }
+
+    std::uintptr_t leaf_address()
+    {
+        return reinterpret_cast<std::uintptr_t>(&tree()->children[17].children[33].children[5].value);
+    }
+
+} // namespace
+
+BENCHMARK("pointer_scanner/scan")
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        remote::pointer_scanner scanner;
+        scan(scanner);
+        bench::do_not_optimize(scanner.size());
+    }
+}
+
+BENCHMARK_ARGUMENTS("pointer_scanner/find_paths", bench::product({{2, 4, 6}, {0x100, 0x1000}}))
+{
+    remote::pointer_search_options options;
+    options.max_depth   = state.argument(0);
+    options.max_offset  = state.argument(1);
+    const auto& scanner = scanned();
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(scanner.find_paths(leaf_address(), options).size());
+}
+
+// how much of a rescan loading a saved map saves
+BENCHMARK("pointer_scanner/save_load")
+{
+    const auto& scanner = scanned();
+    const char  path[]  = "/tmp/remote_memory_bench_pointer_map";
+    state.bytes_per_iteration(scanner.size() * 2 * sizeof(std::uintptr_t));
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        scanner.save(path);
+        remote::pointer_scanner loaded;
+        loaded.load(path);
+        bench::do_not_optimize(loaded.size());
+    }
+    std::remove(path);
+}
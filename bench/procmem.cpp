@@ -0,0 +1,45 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/procmem_operations_policy.hpp>
+
+namespace {
+
+    std::vector<std::uint8_t> source(16 * 1024 * 1024, 0xCC);
+    std::vector<std::uint8_t> destination(16 * 1024 * 1024);
+
+    // reads go straight through the policy so both paths skip the staging copy
+    template<class Policy>
+    void policy_read(bench::state& state, const Policy& policy, std::size_t size)
+    {
+        state.bytes_per_iteration(size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            policy.read(source.data(), destination.data(), size);
+            bench::do_not_optimize(destination[0]);
+        }
+    }
+
+    void vm_readv(bench::state& state, std::size_t size)
+    {
+        static const remote::operations_policy policy;
+        policy_read(state, policy, size);
+    }
+
+    void procmem_pread(bench::state& state, std::size_t size)
+    {
+        static const remote::procmem_operations_policy policy;
+        policy_read(state, policy, size);
+    }
+
+} // namespace
+
+BENCHMARK("vm_readv/64") { vm_readv(state, 64); }
+BENCHMARK("vm_readv/4096") { vm_readv(state, 4096); }
+BENCHMARK("vm_readv/65536") { vm_readv(state, 65536); }
+BENCHMARK("vm_readv/1048576") { vm_readv(state, 1048576); }
+BENCHMARK("vm_readv/16777216") { vm_readv(state, 16777216); }
+
+BENCHMARK("procmem_pread/64") { procmem_pread(state, 64); }
+BENCHMARK("procmem_pread/4096") { procmem_pread(state, 4096); }
+BENCHMARK("procmem_pread/65536") { procmem_pread(state, 65536); }
+BENCHMARK("procmem_pread/1048576") { procmem_pread(state, 1048576); }
+BENCHMARK("procmem_pread/16777216") { procmem_pread(state, 16777216); }
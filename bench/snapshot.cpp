@@ -0,0 +1,106 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/snapshot.hpp>
+
+namespace {
+
+    constexpr std::size_t snapshot_size = 256 * 1024 * 1024;
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(snapshot_size);
+        return child;
+    }
+
+    // two copies that differ in one byte every 64 KiB, the shape of a typical before / after pair
+    struct buffers {
+        std::vector<std::uint8_t> before = std::vector<std::uint8_t>(snapshot_size, 0x5A);
+        std::vector<std::uint8_t> after  = before;
+        std::vector<std::uint8_t> same   = before;
+
+        buffers()
+        {
+            for (std::size_t i = 0; i < after.size(); i += 64 * 1024)
+                after[i] ^= 1;
+        }
+    };
+
+    buffers& data()
+    {
+        static buffers b;
+        return b;
+    }
+
+    template<class Kernel>
+    void local_diff(bench::state& state, Kernel kernel)
+    {
+        auto& b = data();
+        state.bytes_per_iteration(snapshot_size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            std::size_t changes  = 0;
+            auto        callback = [&](std::size_t, std::size_t) { ++changes; };
+            kernel(b.before.data(), b.after.data(), b.before.size(), callback);
+            bench::do_not_optimize(changes);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("diff/memcmp")
+{
+    // lower bound on the cost of comparing two identical copies, without locating any differences
+    auto& b = data();
+    state.bytes_per_iteration(snapshot_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(std::memcmp(b.before.data(), b.same.data(), snapshot_size));
+}
+
+BENCHMARK("diff/scalar")
+{
+    local_diff(state, [](const std::uint8_t* a, const std::uint8_t* b, std::size_t size, auto& callback) {
+        remote::detail::find_differences_scalar(a, b, size, callback);
+    });
+}
+
+#if defined(REMOTE_MEMORY_X86_SIMD)
+BENCHMARK("diff/sse2")
+{
+    local_diff(state, [](const std::uint8_t* a, const std::uint8_t* b, std::size_t size, auto& callback) {
+        remote::detail::find_differences_sse2(a, b, size, callback);
+    });
+}
+
+BENCHMARK("diff/avx2")
+{
+    if (remote::detail::detected_simd_level() != remote::detail::simd_level::avx2)
+        return;
+
+    local_diff(state, [](const std::uint8_t* a, const std::uint8_t* b, std::size_t size, auto& callback) {
+        remote::detail::find_differences_avx2(a, b, size, callback);
+    });
+}
+#endif
+
+BENCHMARK("snapshot/capture")
+{
+    static const remote::basic_memory<remote::operations_policy> memory(target().pid());
+    static remote::snapshot                                       s;
+    state.bytes_per_iteration(snapshot_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        s.capture(memory, target().address(), target().address() + target().size());
+        bench::do_not_optimize(s.size());
+    }
+}
+
+BENCHMARK("snapshot/diff_live")
+{
+    static const remote::basic_memory<remote::operations_policy> memory(target().pid());
+    static remote::snapshot                                       s;
+    if (s.empty())
+        s.capture(memory, target().address(), target().address() + target().size());
+
+    state.bytes_per_iteration(snapshot_size);
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(remote::diff(s, memory).size());
+}
@@ -0,0 +1,43 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <memory>
+
+namespace {
+
+    remote::memory mem;
+
+    std::vector<std::uint8_t> source(1024 * 1024, 0xCC);
+    std::vector<std::uint8_t> destination(1024 * 1024);
+
+    void staged_read(bench::state& state, std::size_t size)
+    {
+        state.bytes_per_iteration(size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            mem.read(source.data(), destination.data(), size);
+            bench::do_not_optimize(destination[0]);
+        }
+    }
+
+    // how read(address, T*, size) used to keep its exception guarantee
+    void heap_staged_read(bench::state& state, std::size_t size)
+    {
+        state.bytes_per_iteration(size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            auto temp = std::make_unique<std::uint8_t[]>(size);
+            mem.remote::operations_policy::read(source.data(), temp.get(), size);
+            std::memcpy(destination.data(), temp.get(), size);
+            bench::do_not_optimize(destination[0]);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("staged_read/8") { staged_read(state, 8); }
+BENCHMARK("staged_read/256") { staged_read(state, 256); }
+BENCHMARK("staged_read/4096") { staged_read(state, 4096); }
+BENCHMARK("staged_read/65536") { staged_read(state, 65536); }
+
+BENCHMARK("heap_staged_read/8") { heap_staged_read(state, 8); }
+BENCHMARK("heap_staged_read/256") { heap_staged_read(state, 256); }
+BENCHMARK("heap_staged_read/4096") { heap_staged_read(state, 4096); }
+BENCHMARK("heap_staged_read/65536") { heap_staged_read(state, 65536); }
@@ -0,0 +1,30 @@
+#include "bench.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/stats_operations_policy.hpp>
+
+namespace {
+
+    std::vector<std::uint64_t> source(512, 0xCC);
+
+    // small reads, where the bookkeeping is largest compared to the system call
+    template<class Memory>
+    void small_reads(bench::state& state, const Memory& memory)
+    {
+        state.bytes_per_iteration(sizeof(std::uint64_t));
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            bench::do_not_optimize(memory.template read<std::uint64_t>(&source[i % source.size()]));
+    }
+
+} // namespace
+
+BENCHMARK("stats/read/plain")
+{
+    static const remote::memory memory;
+    small_reads(state, memory);
+}
+
+BENCHMARK("stats/read/counted")
+{
+    static const remote::basic_memory<remote::stats_operations_policy<>> memory;
+    small_reads(state, memory);
+}
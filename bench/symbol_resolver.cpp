@@ -0,0 +1,64 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/symbol_resolver.hpp>
+
+// resolving a libc symbol in a forked child: attaching with and without the build id cache, and a lookup alone
+namespace {
+
+    bench::forked_process& target()
+    {
+        static bench::forked_process child;
+        return child;
+    }
+
+    const remote::memory& mem()
+    {
+        static const remote::memory m(target().pid());
+        return m;
+    }
+
+    const remote::region_map& regions()
+    {
+        static const remote::region_map map(target().pid());
+        return map;
+    }
+
+    using resolver = remote::symbol_resolver<remote::memory>;
+
+} // namespace
+
+BENCHMARK("symbol_resolver/attach/cold")
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        resolver::clear_cache();
+        auto symbols = remote::make_symbol_resolver(mem(), regions());
+        bench::do_not_optimize(symbols.resolve("libc.so.6!malloc"));
+    }
+}
+
+BENCHMARK("symbol_resolver/attach/memory")
+{
+    remote::symbol_resolver_options options;
+    options.read_files = false;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        resolver::clear_cache();
+        auto symbols = remote::make_symbol_resolver(mem(), regions(), options);
+        bench::do_not_optimize(symbols.resolve("libc.so.6!malloc"));
+    }
+}
+
+BENCHMARK("symbol_resolver/attach/cached")
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto symbols = remote::make_symbol_resolver(mem(), regions());
+        bench::do_not_optimize(symbols.resolve("libc.so.6!malloc"));
+    }
+}
+
+BENCHMARK("symbol_resolver/resolve")
+{
+    auto symbols = remote::make_symbol_resolver(mem(), regions());
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        bench::do_not_optimize(symbols.resolve("libc.so.6!malloc+0x10"));
+}
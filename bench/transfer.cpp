@@ -0,0 +1,183 @@
+#include "bench.hpp"
+
+#if defined(__linux__)
+
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/cached_operations_policy.hpp>
+#include <remote_memory/procmem_operations_policy.hpp>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+// every transfer path against the same forked target, so changes in the overhead of basic_memory show up as a
+// difference to the memcpy baseline. run with --json to compare results between builds
+namespace {
+
+    constexpr std::size_t max_size = 64 * 1024 * 1024;
+
+    using vm_readv_memory = remote::basic_memory<remote::operations_policy>;
+    using procmem_memory  = remote::basic_memory<remote::procmem_operations_policy>;
+    using cached_memory   = remote::basic_memory<remote::cached_operations_policy<>>;
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(max_size);
+        return child;
+    }
+
+    // the local copy of the target memory for the memcpy baseline
+    const std::vector<std::uint8_t>& local_source()
+    {
+        static const std::vector<std::uint8_t> source(max_size, 0xCC);
+        return source;
+    }
+
+    std::uint8_t* destination()
+    {
+        static std::vector<std::uint8_t> buffer(max_size);
+        return buffer.data();
+    }
+
+    template<class Memory>
+    const Memory& memory()
+    {
+        static const Memory memory(target().pid());
+        return memory;
+    }
+
+    template<>
+    const cached_memory& memory<cached_memory>()
+    {
+        // repeated reads hit the cache, which is what the path is meant to measure
+        static cached_memory memory = [] {
+            cached_memory m(target().pid());
+            m.max_age(std::numeric_limits<std::uint64_t>::max());
+            return m;
+        }();
+        return memory;
+    }
+
+    bench::argument_sets sizes()
+    {
+        auto sizes = bench::range(8, max_size, 8);
+        if (sizes.back() != max_size)
+            sizes.push_back(max_size);
+        return bench::product({sizes});
+    }
+
+    // reads go through basic_memory so its overhead is part of the measurement
+    template<class Memory>
+    void read(bench::state& state, std::size_t size)
+    {
+        const auto& mem = memory<Memory>();
+        state.bytes_per_iteration(size);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            mem.read(target().address(), destination(), size);
+            bench::do_not_optimize(destination()[0]);
+        }
+    }
+
+    // count 64 byte requests, one per page
+    template<class Memory>
+    void read_many(bench::state& state, std::size_t count)
+    {
+        const auto&                       mem = memory<Memory>();
+        std::vector<remote::read_request> requests(count);
+        state.bytes_per_iteration(count * 64);
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            for (std::size_t j = 0; j < count; ++j)
+                requests[j] = remote::read_request(target().address() + j * 4096, destination() + j * 64, 64);
+
+            mem.read_many(requests.data(), requests.size());
+            bench::do_not_optimize(destination()[0]);
+        }
+    }
+
+    // every thread reads its own range of the target, each iteration is one read by every thread
+    template<class Read>
+    void threaded(bench::state& state, std::size_t threads, std::size_t size, Read read)
+    {
+        state.bytes_per_iteration(threads * size);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&, t] {
+                for (std::size_t i = 0; i < state.iterations(); ++i)
+                    read(t * size, destination() + t * size, size);
+            });
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    template<class Memory>
+    void threaded_read(bench::state& state, std::size_t threads, std::size_t size)
+    {
+        const auto& mem = memory<Memory>();
+        threaded(state, threads, size, [&](std::size_t offset, std::uint8_t* buffer, std::size_t n) {
+            mem.read(target().address() + offset, buffer, n);
+        });
+    }
+
+} // namespace
+
+BENCHMARK_ARGUMENTS("transfer/memcpy", sizes())
+{
+    const auto  size   = state.argument(0);
+    const auto& source = local_source();
+    state.bytes_per_iteration(size);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        std::memcpy(destination(), source.data(), size);
+        bench::do_not_optimize(destination()[0]);
+    }
+}
+
+BENCHMARK_ARGUMENTS("transfer/vm_readv", sizes()) { read<vm_readv_memory>(state, state.argument(0)); }
+BENCHMARK_ARGUMENTS("transfer/procmem", sizes()) { read<procmem_memory>(state, state.argument(0)); }
+BENCHMARK_ARGUMENTS("transfer/cached", sizes()) { read<cached_memory>(state, state.argument(0)); }
+
+BENCHMARK_ARGUMENTS("transfer/batch/memcpy", bench::product({bench::range(1, 1024, 4)}))
+{
+    const auto  count  = state.argument(0);
+    const auto& source = local_source();
+    state.bytes_per_iteration(count * 64);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        for (std::size_t j = 0; j < count; ++j)
+            std::memcpy(destination() + j * 64, source.data() + j * 4096, 64);
+        bench::do_not_optimize(destination()[0]);
+    }
+}
+
+// the procmem policy batches through process_vm_readv as well, so it has no batch benchmark of its own
+BENCHMARK_ARGUMENTS("transfer/batch/vm_readv", bench::product({bench::range(1, 1024, 4)}))
+{
+    read_many<vm_readv_memory>(state, state.argument(0));
+}
+
+BENCHMARK_ARGUMENTS("transfer/batch/cached", bench::product({bench::range(1, 1024, 4)}))
+{
+    read_many<cached_memory>(state, state.argument(0));
+}
+
+// the cache is not thread safe, so only the paths that can share a handle are compared across threads
+BENCHMARK_ARGUMENTS("transfer/threads/memcpy", bench::product({{1, 2, 4, 8}, {4096, 1024 * 1024}}))
+{
+    const auto& source = local_source();
+    threaded(state, state.argument(0), state.argument(1), [&](std::size_t offset, std::uint8_t* buffer
+                                                              , std::size_t n) {
+        std::memcpy(buffer, source.data() + offset, n);
+        bench::do_not_optimize(buffer[0]);
+    });
+}
+
+BENCHMARK_ARGUMENTS("transfer/threads/vm_readv", bench::product({{1, 2, 4, 8}, {4096, 1024 * 1024}}))
+{
+    threaded_read<vm_readv_memory>(state, state.argument(0), state.argument(1));
+}
+
+BENCHMARK_ARGUMENTS("transfer/threads/procmem", bench::product({{1, 2, 4, 8}, {4096, 1024 * 1024}}))
+{
+    threaded_read<procmem_memory>(state, state.argument(0), state.argument(1));
+}
+
+#endif
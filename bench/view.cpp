@@ -0,0 +1,65 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/view.hpp>
+
+namespace {
+
+    constexpr std::size_t entities = 64;
+
+    // a typical entity: eight 8 byte fields
+    struct entity {
+        std::uint64_t fields[8];
+    };
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(entities * sizeof(entity));
+        return child;
+    }
+
+    const remote::memory& memory()
+    {
+        static const remote::memory m(target().pid());
+        return m;
+    }
+
+} // namespace
+
+BENCHMARK("entities/read_per_field")
+{
+    state.bytes_per_iteration(entities * sizeof(entity));
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t e = 0; e < entities; ++e)
+            for (std::size_t f = 0; f < 8; ++f)
+                bench::do_not_optimize(memory().read<std::uint64_t>(target().address() + e * sizeof(entity) + f * 8));
+}
+
+BENCHMARK("entities/view_per_entity")
+{
+    state.bytes_per_iteration(entities * sizeof(entity));
+    const auto array = remote::make_ptr<entity>(memory(), target().address());
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t e = 0; e < entities; ++e) {
+            const auto v = array[static_cast<std::ptrdiff_t>(e)];
+            for (std::size_t f = 0; f < 8; ++f)
+                bench::do_not_optimize(v->fields[f]);
+        }
+}
+
+BENCHMARK("entities/fetch_all_views")
+{
+    state.bytes_per_iteration(entities * sizeof(entity));
+    const auto                                   array = remote::make_ptr<entity>(memory(), target().address());
+    std::vector<remote::view<entity, remote::memory>> views;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        views.clear();
+        for (std::size_t e = 0; e < entities; ++e)
+            views.push_back(array[static_cast<std::ptrdiff_t>(e)]);
+
+        remote::fetch(views.data(), views.size());
+        for (auto& v : views)
+            for (std::size_t f = 0; f < 8; ++f)
+                bench::do_not_optimize(v->fields[f]);
+    }
+}
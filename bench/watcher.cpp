@@ -0,0 +1,49 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/watcher.hpp>
+
+namespace {
+
+    constexpr std::size_t watches = 64;
+
+    bench::child_process& target()
+    {
+        static bench::child_process child(watches * 4096);
+        return child;
+    }
+
+    // one 8 byte value on each of 64 pages, the way a tool keeps an eye on scattered fields
+    std::uintptr_t field(std::size_t i) { return target().address() + i * 4096 + 128; }
+
+} // namespace
+
+BENCHMARK("watch/64_fields/read_per_field")
+{
+    static const remote::memory memory(target().pid());
+    std::uint64_t               shadow[watches] = {};
+    std::size_t                 changes         = 0;
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        for (std::size_t w = 0; w < watches; ++w) {
+            const auto value = memory.read<std::uint64_t>(field(w));
+            changes += value != shadow[w];
+            shadow[w] = value;
+        }
+
+    bench::do_not_optimize(changes);
+}
+
+BENCHMARK("watch/64_fields/watcher_tick")
+{
+    static const remote::memory                  memory(target().pid());
+    static remote::watcher<remote::memory>       watcher(memory);
+    static bool                                  added = false;
+    if (!added) {
+        for (std::size_t w = 0; w < watches; ++w)
+            watcher.add(field(w), sizeof(std::uint64_t), [](const remote::watch_event&) {});
+        added = true;
+    }
+
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        watcher.poll();
+}
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+#include "child_process.hpp"
+#include <remote_memory.hpp>
+#include <remote_memory/write_buffer.hpp>
+
+// a frame of 256 small writes to neighbouring fields of a forked child, applied one by one or buffered
+namespace {
+
+    constexpr std::size_t writes = 256;
+
+    std::uint8_t fields[64 * 1024];
+
+    bench::forked_process& target()
+    {
+        static bench::forked_process child;
+        return child;
+    }
+
+    const remote::memory& mem()
+    {
+        static const remote::memory m(target().pid());
+        return m;
+    }
+
+    // fields 8 bytes apart written 16 bytes at a time, so neighbours overlap, and every 16th frame value changes
+    template<class Write>
+    void frame(std::size_t iteration, Write write)
+    {
+        for (std::size_t i = 0; i < writes; ++i) {
+            std::uint64_t value[2] = {i % 16 == iteration % 16 ? iteration : 0, 0};
+            write(fields + i * 8, value);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("write_buffer/frame/direct")
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i)
+        frame(i, [](std::uint8_t* address, const std::uint64_t* value) { mem().write(address, value, std::size_t{16}); });
+}
+
+BENCHMARK("write_buffer/frame/buffered")
+{
+    auto buffer = remote::make_write_buffer(mem());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        frame(i, [&](std::uint8_t* address, const std::uint64_t* value) { buffer.write(address, value, 16); });
+        buffer.flush();
+    }
+}
+
+BENCHMARK("write_buffer/frame/shadowed")
+{
+    static std::vector<std::uint8_t> shadow(fields, fields + sizeof(fields));
+    auto                             buffer = remote::make_write_buffer(mem());
+    buffer.add_shadow(fields, shadow.data(), shadow.size());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        frame(i, [&](std::uint8_t* address, const std::uint64_t* value) { buffer.write(address, value, 16); });
+        buffer.flush();
+    }
+}
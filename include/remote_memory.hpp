@@ -18,10 +18,10 @@
 #define REMOTE_MEMORY_HPP
 
 #include "remote_memory/operations_policy.hpp"
-
-#ifndef REMOTE_MEMORY_UNSAFE_READS
-    #include <memory>
-#endif
+#include "remote_memory/best_effort_read.hpp"
+#include "remote_memory/pointer_chain.hpp"
+#include "remote_memory/staging_arena.hpp"
+#include <cstring>
 
 #ifndef REMOTE_MEMORY_DISABLE_TRIVIAL_COPY_CHECKS
     #include <type_traits>
@@ -42,31 +42,47 @@ namespace remote {
 
         /// \brief Refer to remote::read_memory.
         ///        The parameters have the same meaning, but does not require a process handle.
+        ///        The data is staged in the calling threads staging_arena so steady state reads do not allocate.
         /// \throw Strong exception safety guarantee - if the function throws the buffer state is left unchanged.
+        ///        This guarantee does not apply if unsafe reads are enabled
         template<class T, class Address, class Size>
         void read(Address address, T* buffer, Size size) const
+        {
+            read(address, buffer, size, staging_arena::thread_local_arena());
+        }
+        template<class T, class Address, class Size>
+        void read(Address address, T* buffer, Size size, std::error_code& ec) const
+        {
+            read(address, buffer, size, staging_arena::thread_local_arena(), ec);
+        }
+
+        /// \brief Same as read(address, buffer, size), but stages the data in the given arena.
+        template<class T, class Address, class Size>
+        void read(Address address, T* buffer, Size size, staging_arena& arena) const
         {
             REMOTE_MEMORY_TRIVIAL_COPY_CHECK
             // if the read fails we don't want to leave the object in an invalid state
 #ifndef REMOTE_MEMORY_UNSAFE_READS
-            auto temp = std::make_unique<std::uint8_t[]>(size);
-            OperationsPolicy::read(address, temp.get(), sizeof(T));
-            std::memcpy(buffer, temp.get(), sizeof(T));
+            const detail::staging_buffer temp(static_cast<std::size_t>(size), arena);
+            OperationsPolicy::read(address, temp.data(), size);
+            std::memcpy(buffer, temp.data(), static_cast<std::size_t>(size));
 #else
-            OperationsPolicy::read(address, temp.get(), sizeof(T));
+            (void)arena;
+            OperationsPolicy::read(address, buffer, size);
 #endif
         }
         template<class T, class Address, class Size>
-        void read(Address address, T* buffer, Size size, std::error_code& ec) const
+        void read(Address address, T* buffer, Size size, staging_arena& arena, std::error_code& ec) const
         {
             REMOTE_MEMORY_TRIVIAL_COPY_CHECK
 #ifndef REMOTE_MEMORY_UNSAFE_READS
-            auto temp = std::make_unique<std::uint8_t[]>(size);
-            OperationsPolicy::read(address, temp.get(), sizeof(T), ec);
+            const detail::staging_buffer temp(static_cast<std::size_t>(size), arena);
+            OperationsPolicy::read(address, temp.data(), size, ec);
             if (!ec)
-                std::memcpy(buffer, temp.get(), sizeof(T));
+                std::memcpy(buffer, temp.data(), static_cast<std::size_t>(size));
 #else
-            OperationsPolicy::read(address, temp.get(), sizeof(T), ec);
+            (void)arena;
+            OperationsPolicy::read(address, buffer, size, ec);
 #endif
         }
 
@@ -84,7 +100,7 @@ namespace remote {
             OperationsPolicy::read(address, &storage, sizeof(T));
             std::memcpy(std::addressof(buffer), &storage, sizeof(T));
 #else
-            OperationsPolicy::read(address, &temp, sizeof(T));
+            OperationsPolicy::read(address, std::addressof(buffer), sizeof(T));
 #endif
         }
         template<class T, class Address>
@@ -97,7 +113,7 @@ namespace remote {
             if (!ec)
                 std::memcpy(::std::addressof(buffer), &storage, sizeof(T));
 #else
-            OperationsPolicy::read(address, &temp, sizeof(T), ec);
+            OperationsPolicy::read(address, std::addressof(buffer), sizeof(T), ec);
 #endif
         }
 
@@ -127,6 +143,78 @@ namespace remote {
             return storage;
         }
 
+        /// \brief Refer to remote::read_batch.
+        ///        Reads every request using as few system calls as the operations policy allows.
+        /// \return The number of requests that were read completely.
+        /// \throw Only throws if the whole batch failed. Check read_request::succeeded for individual results.
+        std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return OperationsPolicy::read_many(requests, count);
+        }
+        std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return OperationsPolicy::read_many(requests, count, ec);
+        }
+
+        /// \brief Reads every request stored in a contiguous container such as std::vector<read_request>.
+        template<class Requests>
+        std::size_t read_many(Requests& requests) const
+        {
+            return OperationsPolicy::read_many(requests.data(), requests.size());
+        }
+        template<class Requests>
+        std::size_t read_many(Requests& requests, std::error_code& ec) const noexcept
+        {
+            return OperationsPolicy::read_many(requests.data(), requests.size(), ec);
+        }
+
+        /// \brief Reads as much of [address; address + size] as is readable instead of failing at the first
+        ///        unreadable page. Only the area around a fault is probed page by page, the readable parts are
+        ///        read with as few reads as possible. Refer to detail::read_best_effort.
+        /// \param result Receives the number of bytes read and which pages were readable.
+        ///        Reusing it across calls avoids reallocating the page bitmap.
+        /// \throw Only throws if a whole batch failed. Refer to read_many.
+        template<class T, class Address, class Size>
+        void read_best_effort(Address address, T* buffer, Size size, best_effort_result& result) const
+        {
+            REMOTE_MEMORY_TRIVIAL_COPY_CHECK
+            detail::read_best_effort(jm::detail::pointer_cast<std::uintptr_t>(address)
+                                     , reinterpret_cast<std::uint8_t*>(buffer), static_cast<std::size_t>(size)
+                                     , result, [this](read_request* r, std::size_t n) {
+                                         read_many(r, n);
+                                         return true;
+                                     });
+        }
+        /// \brief error_code version of read_best_effort.
+        ///        If a batch fails ec is set and result only describes the part that was read before it.
+        template<class T, class Address, class Size>
+        void read_best_effort(Address address, T* buffer, Size size, best_effort_result& result
+                              , std::error_code& ec) const
+        {
+            REMOTE_MEMORY_TRIVIAL_COPY_CHECK
+            detail::read_best_effort(jm::detail::pointer_cast<std::uintptr_t>(address)
+                                     , reinterpret_cast<std::uint8_t*>(buffer), static_cast<std::size_t>(size)
+                                     , result, [this, &ec](read_request* r, std::size_t n) {
+                                         read_many(r, n, ec);
+                                         return !ec;
+                                     });
+        }
+
+        template<class T, class Address, class Size>
+        best_effort_result read_best_effort(Address address, T* buffer, Size size) const
+        {
+            best_effort_result result;
+            read_best_effort(address, buffer, size, result);
+            return result;
+        }
+        template<class T, class Address, class Size>
+        best_effort_result read_best_effort(Address address, T* buffer, Size size, std::error_code& ec) const
+        {
+            best_effort_result result;
+            read_best_effort(address, buffer, size, result, ec);
+            return result;
+        }
+
         /// \brief refer to remote::write_memory.
         template<class T, class Address, class Size>
         void write(Address address, const T* buffer, Size size) const
@@ -157,6 +245,31 @@ namespace remote {
             OperationsPolicy::write(address, std::addressof(buffer), sizeof(T), ec);
         }
 
+        /// \brief Refer to remote::write_batch.
+        ///        Writes every request using as few system calls as the operations policy allows.
+        /// \return The number of requests that were written completely.
+        /// \throw Only throws if the whole batch failed. Check write_request::transferred for individual results.
+        std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return OperationsPolicy::write_many(requests, count);
+        }
+        std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return OperationsPolicy::write_many(requests, count, ec);
+        }
+
+        /// \brief Writes every request stored in a contiguous container such as std::vector<write_request>.
+        template<class Requests>
+        std::size_t write_many(Requests& requests) const
+        {
+            return OperationsPolicy::write_many(requests.data(), requests.size());
+        }
+        template<class Requests>
+        std::size_t write_many(Requests& requests, std::error_code& ec) const noexcept
+        {
+            return OperationsPolicy::write_many(requests.data(), requests.size(), ec);
+        }
+
         /// \brief Traverses a pointers chain.
         /// \param base The address of next pointer that will be dereferenced.
         /// \param offset The offset that will be added to the derefenenced pointer.
@@ -180,6 +293,41 @@ namespace remote {
             read(base, next);
             return read<Ptr>(next + offset);
         };
+
+        /// \brief Resolves many pointer chains together. Every level of every chain is read with a single
+        ///        read_many call, so the number of system calls grows with the depth of the longest chain
+        ///        instead of the number of chains.
+        ///        Chains that can not be read are marked as not resolved and dropped without throwing.
+        /// \tparam Ptr The pointer type of the remote process. Every read is sizeof(Ptr) bytes.
+        /// \param chains Pointer to the first chain. Their result, resolved and failed_level members are overwritten.
+        /// \param count The number of chains.
+        /// \return The number of resolved chains.
+        /// \throw Only throws if a whole batch failed. Refer to read_many.
+        template<class Ptr = std::uintptr_t>
+        std::size_t resolve_pointer_chains(pointer_chain* chains, std::size_t count) const
+        {
+            return detail::resolve_pointer_chains<Ptr>(chains, count, [this](read_request* r, std::size_t n) {
+                read_many(r, n);
+                return true;
+            });
+        }
+        /// \brief error_code version of resolve_pointer_chains.
+        ///        If a whole batch fails ec is set and every chain that was still being resolved fails.
+        template<class Ptr = std::uintptr_t>
+        std::size_t resolve_pointer_chains(pointer_chain* chains, std::size_t count, std::error_code& ec) const
+        {
+            return detail::resolve_pointer_chains<Ptr>(chains, count, [this, &ec](read_request* r, std::size_t n) {
+                read_many(r, n, ec);
+                return !ec;
+            });
+        }
+
+        /// \brief Resolves every chain stored in a contiguous container such as std::vector<pointer_chain>.
+        template<class Ptr = std::uintptr_t, class Chains>
+        std::size_t resolve_pointer_chains(Chains& chains) const
+        {
+            return resolve_pointer_chains<Ptr>(chains.data(), chains.size());
+        }
     };
 
     using memory = basic_memory<operations_policy>;
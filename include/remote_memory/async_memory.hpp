@@ -0,0 +1,415 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_ASYNC_MEMORY_HPP
+#define REMOTE_MEMORY_ASYNC_MEMORY_HPP
+
+#if !defined(__linux__)
+    #error async_memory is only available on linux
+#endif
+
+#include "detail/utils.hpp"
+#include "detail/linux/procmem.hpp"
+#include "detail/linux/io_uring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace remote {
+
+    struct async_options {
+        /// the number of submission queue entries of the io_uring instance
+        unsigned    queue_depth  = 256;
+        /// operations are handed to the kernel once this many are queued, or by submit() and drain()
+        std::size_t submit_batch = 1;
+        /// use the thread pool even if io_uring is available
+        bool        thread_pool  = false;
+        /// the number of threads of the thread pool
+        std::size_t threads      = 4;
+    };
+
+    /// \brief Asynchronous reads and writes of the memory of a process through /proc/<pid>/mem.
+    ///        Operations are executed by io_uring, or by a pool of threads calling pread / pwrite
+    ///        if io_uring is not available.
+    ///
+    ///        Completions carry the error code and the number of transferred bytes. Short transfers are
+    ///        continued until no more progress can be made. A transfer that stopped part way completes with
+    ///        std::errc::result_out_of_range and one that transferred nothing with the error of the system call.
+    /// \note Callbacks run on an internal thread and must not throw or block for long.
+    ///       Buffers must stay valid until the operation completes.
+    class async_memory {
+    public:
+        /// \brief Called with the result of an operation and the number of transferred bytes.
+        using callback = std::function<void(const std::error_code&, std::size_t)>;
+
+    private:
+        struct operation {
+            std::uintptr_t address;
+            std::uint8_t*  buffer;
+            std::size_t    size;
+            std::size_t    done;
+            bool           write;
+            callback       on_complete;
+        };
+
+        detail::unique_fd _fd;
+        async_options     _options;
+
+        std::mutex              _lock;
+        std::condition_variable _space;
+        std::condition_variable _idle;
+        std::size_t             _in_flight = 0;
+        std::size_t             _capacity  = 0;
+        bool                    _stop      = false;
+
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+        std::unique_ptr<detail::io_uring_queue> _ring;
+        // the operations handed to the ring. They are failed together if the ring stops working
+        std::unordered_set<operation*>          _submitted;
+        // set once the completion thread gave up on the ring, operations fail immediately from then on
+        std::error_code                         _ring_error;
+#endif
+
+        // thread pool fallback
+        std::deque<operation*>   _queue;
+        std::condition_variable  _work;
+        std::vector<std::thread> _threads;
+
+        void finish(operation* op, int error)
+        {
+            std::error_code ec;
+            if (op->done != op->size)
+                ec = op->done ? std::make_error_code(std::errc::result_out_of_range)
+                              : std::error_code(error ? error : EIO, std::system_category());
+
+            op->on_complete(ec, op->done);
+            delete op;
+
+            std::lock_guard<std::mutex> lock(_lock);
+            if (--_in_flight < _capacity)
+                _space.notify_one();
+            if (_in_flight == 0)
+                _idle.notify_all();
+        }
+
+        void pool_work()
+        {
+            for (;;) {
+                operation* op;
+                {
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _work.wait(lock, [&] { return _stop || !_queue.empty(); });
+                    if (_queue.empty())
+                        return;
+
+                    op = _queue.front();
+                    _queue.pop_front();
+                }
+
+                std::error_code ec;
+                op->done = op->write ? detail::procmem_write(_fd.get(), op->address, op->buffer, op->size, ec)
+                                     : detail::procmem_read(_fd.get(), op->address, op->buffer, op->size, ec);
+                finish(op, ec.value());
+            }
+        }
+
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+        // queues the remaining part of op. _lock must be held
+        // returns false if the operation could not be queued, ec may also be set by a failed submission of the batch
+        bool push(operation* op, std::error_code& ec)
+        {
+            const auto opcode = op->write ? IORING_OP_WRITE : IORING_OP_READ;
+            _submitted.insert(op);
+            while (!_ring->push(opcode, _fd.get(), op->address + op->done, op->buffer + op->done
+                                , op->size - op->done, reinterpret_cast<std::uintptr_t>(op))) {
+                _ring->submit(ec);
+                if (ec)
+                    return false;
+            }
+
+            if (_ring->unsubmitted() >= _options.submit_batch)
+                _ring->submit(ec);
+
+            return true;
+        }
+
+        // completes every submitted operation with error once the ring can no longer be used
+        void fail_submitted(const std::error_code& error)
+        {
+            std::vector<operation*> failed;
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _ring_error = error;
+                failed.assign(_submitted.begin(), _submitted.end());
+                _submitted.clear();
+            }
+
+            for (auto op : failed)
+                finish(op, error.value());
+        }
+
+        void ring_work()
+        {
+            for (;;) {
+                std::error_code ec;
+                _ring->wait(ec);
+                if (ec) {
+                    fail_submitted(ec);
+                    return;
+                }
+
+                bool stop = false;
+                _ring->reap([&](std::uint64_t user_data, int result) {
+                    if (user_data == 0) {
+                        stop = true;
+                        return;
+                    }
+
+                    auto                         op = reinterpret_cast<operation*>(user_data);
+                    std::unique_lock<std::mutex> lock(_lock);
+                    if (result > 0) {
+                        op->done += static_cast<std::size_t>(result);
+                        if (op->done < op->size) {
+                            // an operation that can not be queued again stays submitted and fails with the rest
+                            if (!ec && push(op, ec) && !ec)
+                                _ring->submit(ec);
+                            return;
+                        }
+                    }
+
+                    _submitted.erase(op);
+                    lock.unlock();
+                    // unmapped memory fails with EIO, reported as bad_address like the thread pool does
+                    finish(op, result == -EIO ? EFAULT : result < 0 ? -result : 0);
+                });
+
+                if (ec) {
+                    fail_submitted(ec);
+                    return;
+                }
+
+                if (stop)
+                    return;
+            }
+        }
+#endif
+
+        void start(pid_t pid, std::error_code& ec)
+        {
+            _fd = detail::open_procmem(pid, ec);
+            if (ec)
+                return;
+
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+            if (!_options.thread_pool) {
+                std::error_code ring_error;
+                _ring.reset(new detail::io_uring_queue);
+                _ring->open(_options.queue_depth, ring_error);
+                if (!ring_error) {
+                    // every operation in flight needs room for its completion
+                    _capacity = _ring->cq_entries() - 1;
+                    _threads.emplace_back([this] { ring_work(); });
+                    return;
+                }
+
+                _ring.reset();
+            }
+#endif
+
+            _capacity = _options.queue_depth;
+            for (std::size_t i = 0; i < std::max<std::size_t>(_options.threads, 1); ++i)
+                _threads.emplace_back([this] { pool_work(); });
+        }
+
+        void enqueue(std::uintptr_t address, std::uint8_t* buffer, std::size_t size, bool write, callback cb)
+        {
+            std::unique_ptr<operation> op(new operation{address, buffer, size, 0, write, std::move(cb)});
+
+            std::unique_lock<std::mutex> lock(_lock);
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+            // operations still waiting for a batch to fill up would never make room
+            if (_ring && _in_flight >= _capacity) {
+                std::error_code ec;
+                _ring->submit(ec);
+            }
+#endif
+            _space.wait(lock, [&] { return _in_flight < _capacity; });
+            ++_in_flight;
+
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+            if (_ring) {
+                std::error_code ec = _ring_error;
+                if (!ec && push(op.get(), ec)) {
+                    op.release();
+                    return;
+                }
+
+                _submitted.erase(op.get());
+                lock.unlock();
+                finish(op.release(), ec.value());
+                return;
+            }
+#endif
+            _queue.push_back(op.release());
+            _work.notify_one();
+        }
+
+        template<class Buffer>
+        std::future<std::size_t> enqueue_future(std::uintptr_t address, Buffer* buffer, std::size_t size, bool write)
+        {
+            auto promise = std::make_shared<std::promise<std::size_t>>();
+            auto future  = promise->get_future();
+            enqueue(address, const_cast<std::uint8_t*>(reinterpret_cast<const std::uint8_t*>(buffer)), size, write
+                    , [promise](const std::error_code& ec, std::size_t transferred) {
+                        if (ec)
+                            promise->set_exception(std::make_exception_ptr(std::system_error(ec)));
+                        else
+                            promise->set_value(transferred);
+                    });
+            if (_options.submit_batch > 1)
+                submit();
+
+            return future;
+        }
+
+    public:
+        /// \brief Opens the memory of the given process.
+        /// \throw Throws an std::system_error if /proc/<pid>/mem could not be opened.
+        explicit async_memory(pid_t pid, const async_options& options = async_options{}) : _options(options)
+        {
+            std::error_code ec;
+            start(pid, ec);
+            if (ec)
+                throw std::system_error(ec, "open() of /proc/<pid>/mem failed");
+        }
+
+        /// \brief Opens the memory of the given process.
+        /// \param ec The error code that will be set if /proc/<pid>/mem could not be opened.
+        async_memory(pid_t pid, const async_options& options, std::error_code& ec) : _options(options)
+        {
+            start(pid, ec);
+        }
+
+        /// \brief Waits for every operation to complete.
+        ~async_memory()
+        {
+            drain();
+
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _stop = true;
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+                if (_ring && !_ring_error) {
+                    // a no-op with no user data wakes the completion thread up and stops it
+                    std::error_code ec;
+                    while (!ec && !_ring->push(IORING_OP_NOP, -1, 0, nullptr, 0, 0))
+                        _ring->submit(ec);
+                    _ring->submit(ec);
+                }
+#endif
+            }
+
+            _work.notify_all();
+            for (auto& thread : _threads)
+                thread.join();
+        }
+
+        async_memory(const async_memory&) = delete;
+        async_memory& operator=(const async_memory&) = delete;
+
+        /// \brief Whether operations are executed by io_uring instead of the thread pool.
+        bool uses_io_uring() const noexcept
+        {
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+            return _ring != nullptr;
+#else
+            return false;
+#endif
+        }
+
+        /// \brief The number of operations that have not completed yet.
+        std::size_t pending()
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            return _in_flight;
+        }
+
+        /// \brief Reads size bytes at address into buffer and calls on_complete once done.
+        ///        Blocks if the maximum number of operations is already in flight.
+        template<class Address>
+        void read(Address address, void* buffer, std::size_t size, callback on_complete)
+        {
+            enqueue(jm::detail::pointer_cast<std::uintptr_t>(address), static_cast<std::uint8_t*>(buffer), size
+                    , false, std::move(on_complete));
+        }
+
+        /// \brief Writes size bytes of buffer to address and calls on_complete once done.
+        template<class Address>
+        void write(Address address, const void* buffer, std::size_t size, callback on_complete)
+        {
+            enqueue(jm::detail::pointer_cast<std::uintptr_t>(address)
+                    , const_cast<std::uint8_t*>(static_cast<const std::uint8_t*>(buffer)), size, true
+                    , std::move(on_complete));
+        }
+
+        /// \brief Reads size bytes at address into buffer. The operation is submitted immediately.
+        /// \return A future holding the number of transferred bytes or an std::system_error.
+        template<class Address>
+        std::future<std::size_t> read(Address address, void* buffer, std::size_t size)
+        {
+            return enqueue_future(jm::detail::pointer_cast<std::uintptr_t>(address), buffer, size, false);
+        }
+
+        /// \brief Writes size bytes of buffer to address. The operation is submitted immediately.
+        /// \return A future holding the number of transferred bytes or an std::system_error.
+        template<class Address>
+        std::future<std::size_t> write(Address address, const void* buffer, std::size_t size)
+        {
+            return enqueue_future(jm::detail::pointer_cast<std::uintptr_t>(address), buffer, size, true);
+        }
+
+        /// \brief Hands every queued operation to the kernel.
+        void submit()
+        {
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+            if (_ring) {
+                std::error_code             ec;
+                std::lock_guard<std::mutex> lock(_lock);
+                _ring->submit(ec);
+            }
+#endif
+        }
+
+        /// \brief Submits every queued operation and waits for all of them to complete.
+        void drain()
+        {
+            submit();
+            std::unique_lock<std::mutex> lock(_lock);
+            _idle.wait(lock, [&] { return _in_flight == 0; });
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,149 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_BEST_EFFORT_READ_HPP
+#define REMOTE_MEMORY_BEST_EFFORT_READ_HPP
+
+#include "read_batch.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace remote {
+
+    /// \brief The outcome of basic_memory::read_best_effort.
+    ///        Page i covers [first_page + i * page_size; first_page + (i + 1) * page_size) clamped to the read range.
+    struct best_effort_result {
+        static constexpr std::size_t page_size = 4096;
+
+        /// \brief The number of bytes that were read. The bytes of unreadable pages are zeroed.
+        std::size_t                transferred = 0;
+        /// \brief The address of the page holding the first byte of the range.
+        std::uintptr_t             first_page  = 0;
+        std::size_t                page_count  = 0;
+        /// \brief One bit per page, set if every byte of the page within the range was read.
+        std::vector<std::uint64_t> readable_pages;
+
+        bool readable(std::size_t page) const noexcept
+        {
+            return (readable_pages[page / 64] >> (page % 64)) & 1;
+        }
+
+        /// \brief Whether the whole range was read.
+        bool complete() const noexcept
+        {
+            for (std::size_t i = 0; i < page_count; ++i)
+                if (!readable(i))
+                    return false;
+            return true;
+        }
+    };
+
+    namespace detail {
+
+        /// \brief Reads [address; address + size] with as few reads as possible while skipping unreadable pages.
+        ///        The range is read with one request until it stops at a fault. Pages after the fault are probed
+        ///        at exponentially growing distances until a readable one is found, the first readable page is
+        ///        bisected between the last two probes and the rest of the range is again read with one request.
+        ///        A hole of n pages therefore costs about 2 * log2(n) reads of a single page.
+        /// \note Probing assumes unreadable pages form contiguous holes. A readable page enclosed by unreadable
+        ///       pages that lies between two failed probes is reported as unreadable.
+        /// \param read_many Callable with signature bool(read_request*, std::size_t) returning false
+        ///        if the whole batch failed.
+        /// \return false if a batch failed. The result then only describes the part read before it.
+        template<class ReadMany>
+        inline bool read_best_effort(std::uintptr_t address, std::uint8_t* buffer, std::size_t size
+                                     , best_effort_result& result, ReadMany read_many)
+        {
+            constexpr auto page_size = best_effort_result::page_size;
+
+            const auto end      = address + size;
+            result.transferred  = 0;
+            result.first_page   = address & ~(page_size - 1);
+            result.page_count   = size ? (end - result.first_page + page_size - 1) / page_size : 0;
+            result.readable_pages.assign((result.page_count + 63) / 64, 0);
+
+            // reads [from; to) into its place in the buffer and returns how much was read or npos if the batch failed
+            constexpr auto npos = ~std::size_t{0};
+            const auto read = [&](std::uintptr_t from, std::uintptr_t to) {
+                read_request request(from, buffer + (from - address), to - from);
+                return read_many(&request, 1) ? request.transferred : npos;
+            };
+
+            // pages overlapping [from; to) are readable if the range covers all of their bytes within the read
+            const auto mark = [&](std::uintptr_t from, std::uintptr_t to) {
+                result.transferred += to - from;
+                auto first = (from - result.first_page + page_size - 1) / page_size;
+                if (from == address)
+                    first = 0;
+                const auto last = to == end ? result.page_count : (to - result.first_page) / page_size;
+                for (auto page = first; page < last; ++page)
+                    result.readable_pages[page / 64] |= std::uint64_t{1} << (page % 64);
+            };
+
+            for (auto position = address; position < end;) {
+                const auto transferred = read(position, end);
+                if (transferred == npos)
+                    return false;
+
+                mark(position, position + transferred);
+                position += transferred;
+                if (position == end)
+                    break;
+
+                // gallop over the pages following the faulting one until one of them can be read
+                // the last probe is clamped to the last page so the end of the range is always probed
+                const auto fault     = position & ~(page_size - 1);
+                const auto last_page = (end - 1) & ~(page_size - 1);
+                auto       bad       = fault;
+                auto       good      = end;
+                for (std::size_t step = page_size; bad < last_page; step *= 2) {
+                    const auto probe  = std::min(fault + step, last_page);
+                    const auto probed = read(probe, std::min(probe + page_size, end));
+                    if (probed == npos)
+                        return false;
+                    if (probed) {
+                        good = probe;
+                        break;
+                    }
+
+                    bad = probe;
+                }
+
+                // the first readable page lies in (bad; good]
+                while (good != end && good - bad > page_size) {
+                    const auto middle = bad + (good - bad) / page_size / 2 * page_size;
+                    const auto probed = read(middle, middle + page_size);
+                    if (probed == npos)
+                        return false;
+
+                    (probed ? good : bad) = middle;
+                }
+
+                std::memset(buffer + (position - address), 0, good - position);
+                position = good;
+            }
+
+            return true;
+        }
+
+    } // namespace detail
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,500 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_CACHED_OPERATIONS_POLICY_HPP
+#define REMOTE_MEMORY_CACHED_OPERATIONS_POLICY_HPP
+
+#include "operations_policy.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <vector>
+
+// the default number of pages kept by remote::cached_operations_policy
+#ifndef REMOTE_MEMORY_CACHE_PAGES
+    #define REMOTE_MEMORY_CACHE_PAGES 256
+#endif
+
+namespace remote {
+
+    /// \brief Counters of a cached_operations_policy. Hits and misses are counted per page.
+    struct cache_statistics {
+        std::uint64_t hits      = 0;
+        std::uint64_t misses    = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    /// \brief Operations policy decorator that keeps a bounded LRU cache of remote pages.
+    ///        A miss fills the page, and optionally the pages after it, with one batched read.
+    ///        Later reads touching only cached pages are served with memcpy.
+    ///
+    ///        Cached pages are valid for max_age epochs after the one they were filled in. The default max age of 0
+    ///        makes every call to next_epoch() invalidate the whole cache in constant time, so a tool can call it
+    ///        once per update tick. Writes through the policy keep the cached pages up to date.
+    /// \note The cache can not see writes made by the target or by other handles - use epochs or invalidate().
+    ///       The policy must not be used by multiple threads at once.
+    template<class OperationsPolicy = operations_policy>
+    class cached_operations_policy : public OperationsPolicy {
+    public:
+        static constexpr std::size_t page_size = 4096;
+
+    private:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        struct entry {
+            std::uintptr_t page;
+            std::uint64_t  epoch;
+            std::uint32_t  prev;
+            std::uint32_t  next;
+            bool           live;
+        };
+
+        // page data, LRU list and an open addressing table of the live entries
+        mutable std::vector<std::uint8_t>  _data;
+        mutable std::vector<entry>         _entries;
+        mutable std::vector<std::uint32_t> _table;
+        mutable std::vector<read_request>  _fills;
+        mutable std::vector<read_request>  _misses;
+        mutable std::vector<std::size_t>   _miss_indices;
+        mutable std::uint32_t              _head = npos; // most recently used
+        mutable std::uint32_t              _tail = npos; // least recently used
+        mutable cache_statistics           _stats;
+        std::uint64_t                      _epoch    = 0;
+        std::uint64_t                      _max_age  = 0;
+        std::size_t                        _prefetch = 1;
+
+        std::size_t home(std::uintptr_t page) const noexcept
+        {
+            return static_cast<std::size_t>(((page / page_size) * 0x9E3779B97F4A7C15ull) >> 32) & (_table.size() - 1);
+        }
+
+        void unlink(std::uint32_t index) const noexcept
+        {
+            auto& e = _entries[index];
+            (e.prev == npos ? _head : _entries[e.prev].next) = e.next;
+            (e.next == npos ? _tail : _entries[e.next].prev) = e.prev;
+        }
+
+        void push_front(std::uint32_t index) const noexcept
+        {
+            auto& e = _entries[index];
+            e.prev  = npos;
+            e.next  = _head;
+            (_head == npos ? _tail : _entries[_head].prev) = index;
+            _head = index;
+        }
+
+        void push_back(std::uint32_t index) const noexcept
+        {
+            auto& e = _entries[index];
+            e.next  = npos;
+            e.prev  = _tail;
+            (_tail == npos ? _head : _entries[_tail].next) = index;
+            _tail = index;
+        }
+
+        std::size_t find_slot(std::uintptr_t page) const noexcept
+        {
+            const auto mask = _table.size() - 1;
+            for (auto i = home(page);; i = (i + 1) & mask)
+                if (_table[i] == npos || _entries[_table[i]].page == page)
+                    return i;
+        }
+
+        // removes a live entry from the table and moves it to the back of the LRU list
+        void erase(std::uint32_t index) const noexcept
+        {
+            const auto mask = _table.size() - 1;
+            auto       i    = find_slot(_entries[index].page);
+            // backward shift deletion keeps the probe sequences intact without tombstones
+            for (auto j = i;;) {
+                j = (j + 1) & mask;
+                if (_table[j] == npos)
+                    break;
+
+                const auto k = home(_entries[_table[j]].page);
+                if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+                    continue;
+
+                _table[i] = _table[j];
+                i         = j;
+            }
+            _table[i] = npos;
+
+            _entries[index].live = false;
+            unlink(index);
+            push_back(index);
+        }
+
+        bool fresh(const entry& e) const noexcept { return _epoch - e.epoch <= _max_age; }
+
+        // returns the entry of a fresh cached page or npos. Stale pages are dropped
+        std::uint32_t lookup(std::uintptr_t page) const noexcept
+        {
+            const auto index = _table[find_slot(page)];
+            if (index == npos)
+                return npos;
+
+            if (!fresh(_entries[index])) {
+                erase(index);
+                return npos;
+            }
+
+            return index;
+        }
+
+        // takes the least recently used entry and evicts its page
+        std::uint32_t acquire() const noexcept
+        {
+            const auto index = _tail;
+            if (_entries[index].live) {
+                erase(index);
+                ++_stats.evictions;
+            }
+
+            unlink(index);
+            push_front(index);
+            return index;
+        }
+
+        // reads page and up to prefetch - 1 following uncached pages with one batch.
+        // returns the entry of page or npos if it could not be read
+        std::uint32_t fill(std::uintptr_t page, std::size_t pages) const noexcept
+        {
+            pages = std::min(std::max(pages, _prefetch), _entries.size() / 2 + 1);
+
+            _fills.clear();
+            for (std::size_t i = 0; i < pages; ++i) {
+                const auto address = page + i * page_size;
+                if (i != 0 && lookup(address) != npos)
+                    continue;
+
+                const auto index   = acquire();
+                _entries[index].page = address;
+                read_request request;
+                request.address = address;
+                request.buffer  = _data.data() + std::size_t{index} * page_size;
+                request.size    = page_size;
+                _fills.push_back(request);
+            }
+
+            std::error_code ec;
+            OperationsPolicy::read_many(_fills.data(), _fills.size(), ec);
+
+            std::uint32_t result = npos;
+            for (auto& request : _fills) {
+                const auto index = static_cast<std::uint32_t>(
+                        (static_cast<std::uint8_t*>(request.buffer) - _data.data()) / page_size);
+                auto& e = _entries[index];
+                if (!request.succeeded()) {
+                    unlink(index);
+                    push_back(index);
+                    continue;
+                }
+
+                e.epoch = _epoch;
+                e.live  = true;
+                _table[find_slot(e.page)] = index;
+                if (e.page == page)
+                    result = index;
+            }
+
+            return result;
+        }
+
+        // copies [address; address + size] out of the cache, filling missing pages if fill_missing is set
+        bool cached_read(std::uintptr_t address, void* buffer, std::size_t size, bool fill_missing) const noexcept
+        {
+            if (size == 0 || size > _entries.size() / 2 * page_size)
+                return false;
+
+            const auto first = address & ~std::uintptr_t{page_size - 1};
+            const auto last  = (address + size - 1) & ~std::uintptr_t{page_size - 1};
+            auto       out   = static_cast<std::uint8_t*>(buffer);
+            for (auto page = first; page <= last; page += page_size) {
+                auto index = lookup(page);
+                if (index != npos) {
+                    ++_stats.hits;
+                    unlink(index);
+                    push_front(index);
+                }
+                else {
+                    ++_stats.misses;
+                    if (!fill_missing)
+                        return false;
+
+                    index = fill(page, (last - page) / page_size + 1);
+                    if (index == npos)
+                        return false;
+                }
+
+                const auto begin = std::max(address, page);
+                const auto end   = std::min(address + size, page + page_size);
+                std::memcpy(out, _data.data() + std::size_t{index} * page_size + (begin - page), end - begin);
+                out += end - begin;
+            }
+
+            return true;
+        }
+
+        // copies written bytes into the cached pages they touch
+        void update(std::uintptr_t address, const void* buffer, std::size_t size) const noexcept
+        {
+            if (size == 0)
+                return;
+
+            const auto first = address & ~std::uintptr_t{page_size - 1};
+            const auto last  = (address + size - 1) & ~std::uintptr_t{page_size - 1};
+            auto       in    = static_cast<const std::uint8_t*>(buffer);
+            for (auto page = first; page <= last; page += page_size) {
+                const auto begin = std::max(address, page);
+                const auto end   = std::min(address + size, page + page_size);
+                const auto index = _table[find_slot(page)];
+                if (index != npos)
+                    std::memcpy(_data.data() + std::size_t{index} * page_size + (begin - page), in, end - begin);
+
+                in += end - begin;
+            }
+        }
+
+        void invalidate_range(std::uintptr_t address, std::size_t size) const noexcept
+        {
+            if (size == 0)
+                return;
+
+            const auto last = (address + size - 1) & ~std::uintptr_t{page_size - 1};
+            for (auto page = address & ~std::uintptr_t{page_size - 1}; page <= last; page += page_size) {
+                const auto index = _table[find_slot(page)];
+                if (index != npos)
+                    erase(index);
+            }
+        }
+
+        template<class Request>
+        void after_write_many(const Request* requests, std::size_t count) const noexcept
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto& r = requests[i];
+                update(r.address, r.buffer, r.transferred);
+                invalidate_range(r.address + r.transferred, r.size - r.transferred);
+            }
+        }
+
+    public:
+        /// \brief Forwards all arguments to the underlying policy.
+        template<class... Args>
+        explicit cached_operations_policy(Args&&... args) : OperationsPolicy(std::forward<Args>(args)...)
+        {
+            capacity(REMOTE_MEMORY_CACHE_PAGES);
+        }
+
+        /// \brief The maximum number of cached pages.
+        std::size_t capacity() const noexcept { return _entries.size(); }
+
+        /// \brief Changes the maximum number of cached pages. Clears the cache.
+        void capacity(std::size_t pages)
+        {
+            pages = std::max<std::size_t>(pages, 2);
+            _data.assign(pages * page_size, 0);
+            _entries.assign(pages, entry{0, 0, npos, npos, false});
+
+            std::size_t table_size = 1;
+            while (table_size < pages * 2)
+                table_size *= 2;
+            _table.assign(table_size, npos);
+
+            _fills.reserve(pages);
+            _head = _tail = npos;
+            for (std::uint32_t i = 0; i < pages; ++i)
+                push_back(i);
+        }
+
+        /// \brief The number of pages read by a miss, including the missing page.
+        std::size_t prefetch() const noexcept { return _prefetch; }
+        void prefetch(std::size_t pages) noexcept { _prefetch = std::max<std::size_t>(pages, 1); }
+
+        /// \brief The number of epochs a cached page stays valid for after the epoch it was filled in.
+        std::uint64_t max_age() const noexcept { return _max_age; }
+        void max_age(std::uint64_t epochs) noexcept { _max_age = epochs; }
+
+        std::uint64_t epoch() const noexcept { return _epoch; }
+
+        /// \brief Starts a new epoch. Pages older than max_age epochs are dropped on their next access.
+        void next_epoch() noexcept { ++_epoch; }
+
+        /// \brief Drops every cached page.
+        void invalidate() const noexcept
+        {
+            std::fill(_table.begin(), _table.end(), npos);
+            for (auto& e : _entries)
+                e.live = false;
+        }
+
+        /// \brief Drops the cached pages overlapping [address; address + size].
+        template<class Address>
+        void invalidate(Address address, std::size_t size) const noexcept(!jm::detail::checked_pointers)
+        {
+            invalidate_range(jm::detail::pointer_cast<std::uintptr_t>(address), size);
+        }
+
+        const cache_statistics& statistics() const noexcept { return _stats; }
+        void reset_statistics() noexcept { _stats = cache_statistics{}; }
+
+        /// \brief Reads through the cache. Reads larger than half of the cache and reads of memory that
+        ///        can not be cached are passed to the underlying policy.
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size) const
+        {
+            if (!cached_read(jm::detail::pointer_cast<std::uintptr_t>(address), buffer, static_cast<std::size_t>(size)
+                             , true))
+                OperationsPolicy::read(address, buffer, size);
+        }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            if (!cached_read(jm::detail::pointer_cast<std::uintptr_t>(address), buffer, static_cast<std::size_t>(size)
+                             , true))
+                OperationsPolicy::read(address, buffer, size, ec);
+        }
+
+        /// \brief Serves the requests whose pages are cached and passes the rest to the underlying
+        ///        policy in one batch. The batch does not fill the cache.
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return cached_many(requests, count, [this](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n);
+            });
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            // with room for every request reserved up front the batch itself can not throw
+            try {
+                _misses.reserve(count);
+                _miss_indices.reserve(count);
+            }
+            catch (const std::bad_alloc&) {
+                for (std::size_t i = 0; i < count; ++i)
+                    requests[i].transferred = 0;
+
+                ec = std::make_error_code(std::errc::not_enough_memory);
+                return 0;
+            }
+
+            return cached_many(requests, count, [this, &ec](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n, ec);
+            });
+        }
+
+        template<typename T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size) const
+        {
+            const auto a = jm::detail::pointer_cast<std::uintptr_t>(address);
+            try {
+                OperationsPolicy::write(address, buffer, size);
+            } catch (...) {
+                invalidate_range(a, static_cast<std::size_t>(size));
+                throw;
+            }
+
+            update(a, buffer, static_cast<std::size_t>(size));
+        }
+
+        template<class T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            const auto a = jm::detail::pointer_cast<std::uintptr_t>(address);
+            OperationsPolicy::write(address, buffer, size, ec);
+            if (ec)
+                invalidate_range(a, static_cast<std::size_t>(size));
+            else
+                update(a, buffer, static_cast<std::size_t>(size));
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            std::size_t written;
+            try {
+                written = OperationsPolicy::write_many(requests, count);
+            } catch (...) {
+                invalidate_many(requests, count);
+                throw;
+            }
+
+            after_write_many(requests, count);
+            return written;
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            const auto written = OperationsPolicy::write_many(requests, count, ec);
+            if (ec)
+                invalidate_many(requests, count);
+            else
+                after_write_many(requests, count);
+
+            return written;
+        }
+
+    private:
+        void invalidate_many(const write_request* requests, std::size_t count) const noexcept
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                invalidate_range(requests[i].address, requests[i].size);
+        }
+
+        template<class Transfer>
+        std::size_t cached_many(read_request* requests, std::size_t count, Transfer transfer) const
+        {
+            _misses.clear();
+            _miss_indices.clear();
+            std::size_t succeeded = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                auto& r = requests[i];
+                if (cached_read(r.address, r.buffer, r.size, false)) {
+                    r.transferred = r.size;
+                    ++succeeded;
+                }
+                else {
+                    _misses.push_back(r);
+                    _miss_indices.push_back(i);
+                }
+            }
+
+            if (_misses.empty())
+                return succeeded;
+
+            succeeded += transfer(_misses.data(), _misses.size());
+            for (std::size_t i = 0; i < _miss_indices.size(); ++i)
+                requests[_miss_indices[i]].transferred = _misses[i].transferred;
+
+            return succeeded;
+        }
+    };
+
+    template<class OperationsPolicy>
+    constexpr std::size_t cached_operations_policy<OperationsPolicy>::page_size;
+
+    template<class OperationsPolicy>
+    constexpr std::uint32_t cached_operations_policy<OperationsPolicy>::npos;
+
+} // namespace remote
+
+#endif // include guard
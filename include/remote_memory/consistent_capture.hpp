@@ -0,0 +1,451 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_CONSISTENT_CAPTURE_HPP
+#define REMOTE_MEMORY_CONSISTENT_CAPTURE_HPP
+
+#if !defined(__linux__)
+    #error consistent_capture is only available on linux
+#endif
+
+#include "snapshot.hpp"
+#include "detail/error.hpp"
+#include "detail/linux/unique_fd.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace remote {
+
+    /// \brief How the target is paused while it is copied.
+    enum class freeze_method : std::uint8_t {
+        /// the cgroup v2 freezer if the target is alone in a cgroup it can be frozen through, otherwise SIGSTOP
+        automatic,
+        /// the cgroup v2 freezer. Every process of the cgroup of the target is frozen
+        cgroup,
+        /// SIGSTOP followed by SIGCONT. The parent of the target can observe both
+        signal
+    };
+
+    struct consistent_capture_options {
+        freeze_method             method  = freeze_method::automatic;
+        /// copies everything while the target runs first and only the pages it wrote since while it is frozen.
+        /// Needs soft dirty page tracking, without it everything is copied while frozen
+        bool                      precopy = true;
+        /// how long the target may take to stop
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(1000);
+    };
+
+    /// \brief What capture_consistent did.
+    struct consistent_capture_result {
+        /// the method the target was paused with
+        freeze_method            method         = freeze_method::signal;
+        /// whether the pre-copy was used and only the pages written since were copied while frozen
+        bool                     dirty_tracking = false;
+        /// from requesting the freeze until the target was resumed
+        std::chrono::nanoseconds pause{0};
+        /// from requesting the freeze until every thread of the target stopped
+        std::chrono::nanoseconds freeze{0};
+        /// the number of bytes copied before the freeze
+        std::size_t              precopied      = 0;
+        /// the number of bytes copied while frozen
+        std::size_t              copied         = 0;
+    };
+
+    namespace detail {
+
+        inline bool read_text(const std::string& path, std::string& text)
+        {
+            std::ifstream file(path);
+            if (!file)
+                return false;
+
+            text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        inline bool write_text(const std::string& path, const char* text) noexcept
+        {
+            unique_fd  fd(::open(path.c_str(), O_WRONLY | O_CLOEXEC));
+            const auto size = std::strlen(text);
+            return fd && ::write(fd.get(), text, size) == static_cast<::ssize_t>(size);
+        }
+
+        /// \brief Where the unified cgroup hierarchy is mounted, or an empty string if it is not.
+        inline std::string cgroup2_mount()
+        {
+            std::ifstream mounts("/proc/self/mountinfo");
+            for (std::string line; std::getline(mounts, line);) {
+                // mount id, parent, device, root, mount point, options, optional fields, -, type, source, options
+                const auto separator = line.find(" - ");
+                if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0)
+                    continue;
+
+                std::size_t field = 0, begin = 0;
+                while (field < 4 && begin != std::string::npos) {
+                    begin = line.find(' ', begin) + 1;
+                    ++field;
+                }
+
+                return line.substr(begin, line.find(' ', begin) - begin);
+            }
+
+            return {};
+        }
+
+        /// \brief The path of the cgroup v2 a process is in, relative to the hierarchy.
+        inline std::string cgroup2_of(const std::string& process)
+        {
+            std::ifstream groups("/proc/" + process + "/cgroup");
+            for (std::string line; std::getline(groups, line);)
+                if (line.compare(0, 3, "0::") == 0)
+                    return line.substr(3);
+
+            return {};
+        }
+
+        /// \brief Checks once whether the kernel tracks soft dirty pages, by writing to a page of this process.
+        inline bool soft_dirty_supported() noexcept
+        {
+            static const bool supported = [] {
+                const auto page   = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                const auto memory = ::mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (memory == MAP_FAILED)
+                    return false;
+
+                // bit 55 of a pagemap entry is the soft dirty bit, writing 4 to clear_refs clears it
+                unique_fd  pagemap(::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC));
+                const auto entry = [&] {
+                    std::uint64_t value = 0;
+                    ::pread(pagemap.get(), &value, sizeof(value)
+                            , static_cast<::off_t>(reinterpret_cast<std::uintptr_t>(memory) / page * sizeof(value)));
+                    return value;
+                };
+
+                *static_cast<volatile char*>(memory) = 1;
+                const auto cleared = write_text("/proc/self/clear_refs", "4") && !(entry() >> 55 & 1);
+                *static_cast<volatile char*>(memory) = 2;
+                const auto result = pagemap && cleared && (entry() >> 55 & 1);
+                ::munmap(memory, page);
+                return result;
+            }();
+
+            return supported;
+        }
+
+        /// \brief Finds the pages of the snapshot that the target wrote since its soft dirty bits were cleared.
+        inline bool dirty_pages(pid_t pid, const snapshot& snap, std::vector<changed_range>& dirty)
+        {
+            unique_fd pagemap(::open(("/proc/" + std::to_string(pid) + "/pagemap").c_str(), O_RDONLY | O_CLOEXEC));
+            if (!pagemap)
+                return false;
+
+            const auto                 page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+            std::vector<std::uint64_t> entries(4096);
+            for (const auto& r : snap.ranges()) {
+                const auto end   = r.address + r.size;
+                auto       first = r.address / page;
+                const auto last  = (end - 1) / page;
+                while (first <= last) {
+                    const auto count  = static_cast<std::size_t>(std::min<std::uintptr_t>(entries.size()
+                                                                                          , last - first + 1));
+                    const auto bytes  = count * sizeof(std::uint64_t);
+                    const auto offset = static_cast<::off_t>(first * sizeof(std::uint64_t));
+                    if (::pread(pagemap.get(), entries.data(), bytes, offset) != static_cast<::ssize_t>(bytes))
+                        return false;
+
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (!(entries[i] >> 55 & 1))
+                            continue;
+
+                        const auto from = std::max(r.address, (first + i) * page);
+                        const auto to   = std::min(end, (first + i + 1) * page);
+                        if (!dirty.empty() && dirty.back().address + dirty.back().size == from)
+                            dirty.back().size += to - from;
+                        else
+                            dirty.push_back({from, static_cast<std::size_t>(to - from)});
+                    }
+
+                    first += count;
+                }
+            }
+
+            return true;
+        }
+
+        /// \brief Pauses a process and resumes it when destroyed.
+        class process_freezer {
+            pid_t         _pid;
+            freeze_method _method = freeze_method::signal;
+            std::string   _freeze_file;
+            bool          _frozen = false;
+
+            // the state letter of every thread, T or t once it stopped
+            bool all_threads_stopped(bool& alive) const
+            {
+                const auto tasks = "/proc/" + std::to_string(_pid) + "/task";
+                const auto dir   = ::opendir(tasks.c_str());
+                alive            = dir != nullptr;
+                if (!dir)
+                    return false;
+
+                bool        stopped = true;
+                std::string stat;
+                while (const auto entry = ::readdir(dir)) {
+                    if (entry->d_name[0] == '.')
+                        continue;
+
+                    if (!read_text(tasks + '/' + entry->d_name + "/stat", stat))
+                        continue;
+
+                    const auto state = stat.rfind(')');
+                    if (state != std::string::npos && state + 2 < stat.size() && stat[state + 2] != 'T'
+                        && stat[state + 2] != 't') {
+                        stopped = false;
+                        break;
+                    }
+                }
+
+                ::closedir(dir);
+                return stopped;
+            }
+
+            bool freeze_cgroup(std::chrono::steady_clock::time_point deadline, std::error_code& ec)
+            {
+                std::string state;
+                if (read_text(_freeze_file, state) && state.compare(0, 1, "1") == 0)
+                    return true; // frozen by someone else, who also thaws it
+
+                if (!write_text(_freeze_file, "1")) {
+                    ec = get_last_error();
+                    return false;
+                }
+
+                _frozen = true;
+
+                // cgroup.events is modified once the whole cgroup is frozen
+                const auto events = _freeze_file.substr(0, _freeze_file.rfind('/')) + "/cgroup.events";
+                unique_fd  fd(::open(events.c_str(), O_RDONLY | O_CLOEXEC));
+                for (;;) {
+                    char       buffer[256];
+                    const auto size = fd ? ::pread(fd.get(), buffer, sizeof(buffer) - 1, 0) : -1;
+                    if (size > 0) {
+                        buffer[size] = 0;
+                        if (std::strstr(buffer, "frozen 1"))
+                            return true;
+                    }
+
+                    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            deadline - std::chrono::steady_clock::now());
+                    if (left.count() <= 0) {
+                        ec = std::make_error_code(std::errc::timed_out);
+                        return false;
+                    }
+
+                    pollfd wait = {fd.get(), POLLPRI, 0};
+                    ::poll(&wait, 1, static_cast<int>(std::min<std::chrono::milliseconds::rep>(left.count(), 10)));
+                }
+            }
+
+            bool freeze_signal(std::chrono::steady_clock::time_point deadline, std::error_code& ec)
+            {
+                bool alive;
+                if (all_threads_stopped(alive))
+                    return true; // stopped by someone else, who also continues it
+
+                if (!alive || ::kill(_pid, SIGSTOP) != 0) {
+                    ec = alive ? get_last_error() : std::make_error_code(std::errc::no_such_process);
+                    return false;
+                }
+
+                _frozen = true;
+                while (!all_threads_stopped(alive)) {
+                    if (!alive) {
+                        ec = std::make_error_code(std::errc::no_such_process);
+                        return false;
+                    }
+
+                    if (std::chrono::steady_clock::now() >= deadline) {
+                        ec = std::make_error_code(std::errc::timed_out);
+                        return false;
+                    }
+
+                    std::this_thread::yield();
+                }
+
+                return true;
+            }
+
+        public:
+            explicit process_freezer(pid_t pid) noexcept : _pid(pid) {}
+
+            process_freezer(const process_freezer&) = delete;
+            process_freezer& operator=(const process_freezer&) = delete;
+
+            ~process_freezer() { thaw(); }
+
+            /// \brief Chooses how the process will be paused.
+            bool prepare(freeze_method method, std::error_code& ec)
+            {
+                if (_pid == ::getpid()) {
+                    ec = std::make_error_code(std::errc::invalid_argument);
+                    return false;
+                }
+
+                _method = freeze_method::signal;
+                if (method == freeze_method::signal)
+                    return true;
+
+                // the root cgroup can not be frozen and the cgroup of this process must stay running
+                const auto mount  = cgroup2_mount();
+                const auto target = cgroup2_of(std::to_string(_pid));
+                const auto self   = cgroup2_of("self");
+                const auto usable = !mount.empty() && !target.empty() && target != "/"
+                                    && (self.compare(0, target.size(), target) != 0
+                                        || (self.size() > target.size() && self[target.size()] != '/'))
+                                    && ::access((mount + target + "/cgroup.freeze").c_str(), W_OK) == 0;
+
+                if (usable && method == freeze_method::automatic) {
+                    // other processes are only frozen along when asked for explicitly
+                    std::string procs;
+                    if (!read_text(mount + target + "/cgroup.procs", procs) || procs != std::to_string(_pid) + '\n')
+                        return true;
+                }
+
+                if (!usable) {
+                    if (method == freeze_method::cgroup) {
+                        ec = std::make_error_code(std::errc::operation_not_supported);
+                        return false;
+                    }
+
+                    return true;
+                }
+
+                _method      = freeze_method::cgroup;
+                _freeze_file = mount + target + "/cgroup.freeze";
+                return true;
+            }
+
+            freeze_method method() const noexcept { return _method; }
+
+            /// \brief Pauses the process and waits until every thread of it stopped.
+            bool freeze(std::chrono::milliseconds timeout, std::error_code& ec)
+            {
+                const auto deadline = std::chrono::steady_clock::now() + timeout;
+                return _method == freeze_method::cgroup ? freeze_cgroup(deadline, ec) : freeze_signal(deadline, ec);
+            }
+
+            /// \brief Resumes the process unless it was already paused before freeze.
+            void thaw() noexcept
+            {
+                if (!_frozen)
+                    return;
+
+                if (_method == freeze_method::cgroup)
+                    write_text(_freeze_file, "0");
+                else
+                    ::kill(_pid, SIGCONT);
+
+                _frozen = false;
+            }
+        };
+
+    } // namespace detail
+
+    /// \brief Captures regions of a running process into a snapshot that is consistent,
+    ///        as if every byte was read at the same moment.
+    ///        The target is paused while it is copied and resumed before returning, even if the copy throws.
+    ///        With pre-copy and soft dirty page tracking the regions are copied while the target runs and only the
+    ///        pages it wrote in the meantime are copied again while it is paused, which keeps the pause short
+    ///        for targets that only write to a small part of their memory.
+    /// \param regions Range of objects with begin and end members, such as region_map::filter(...).
+    ///        Memory mapped by the target after the call started is not captured.
+    /// \param ec The error code that will be set if the target could not be paused or was not found.
+    /// \note Tracking dirty pages clears the soft dirty bits of the target, which disturbs other users of them.
+    /// \throw Throws if the underlying read_many throws.
+    template<class Memory, class Regions>
+    inline consistent_capture_result capture_consistent(snapshot& snap, const Memory& memory, pid_t pid
+                                                        , const Regions& regions
+                                                        , const consistent_capture_options& options
+                                                        , std::error_code& ec)
+    {
+        consistent_capture_result result;
+        detail::process_freezer   freezer(pid);
+        if (!freezer.prepare(options.method, ec))
+            return result;
+
+        result.method         = freezer.method();
+        result.dirty_tracking = options.precopy && detail::soft_dirty_supported()
+                                && detail::write_text("/proc/" + std::to_string(pid) + "/clear_refs", "4");
+        if (result.dirty_tracking) {
+            snap.capture(memory, regions);
+            result.precopied = snap.size();
+        }
+
+        std::vector<changed_range> dirty;
+        const auto                 start = std::chrono::steady_clock::now();
+        if (!freezer.freeze(options.timeout, ec)) {
+            freezer.thaw();
+            return result;
+        }
+
+        result.freeze = std::chrono::steady_clock::now() - start;
+
+        // a pagemap that can not be read leaves no way to tell what changed
+        if (result.dirty_tracking && !detail::dirty_pages(pid, snap, dirty))
+            result.dirty_tracking = false;
+
+        if (result.dirty_tracking)
+            result.copied = snap.recapture(memory, dirty);
+        else {
+            snap.capture(memory, regions);
+            result.copied = snap.size();
+        }
+
+        freezer.thaw();
+        result.pause = std::chrono::steady_clock::now() - start;
+        return result;
+    }
+
+    /// \throw Throws an std::system_error if the target could not be paused.
+    template<class Memory, class Regions>
+    inline consistent_capture_result capture_consistent(snapshot& snap, const Memory& memory, pid_t pid
+                                                        , const Regions& regions
+                                                        , const consistent_capture_options& options = {})
+    {
+        std::error_code ec;
+        const auto      result = capture_consistent(snap, memory, pid, regions, options, ec);
+        if (ec)
+            throw std::system_error(ec, "capture_consistent() failed");
+
+        return result;
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,832 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_CONTAINERS_HPP
+#define REMOTE_MEMORY_CONTAINERS_HPP
+
+#include "read_batch.hpp"
+#include "view.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace remote {
+
+    /// \brief Same layout as the std::pair<const K, V> stored by maps, but trivially copyable.
+    template<class K, class V>
+    struct map_entry {
+        K first;
+        V second;
+    };
+
+    /// \brief Remote elements that are only read when touched. Iterating yields a remote::view per element.
+    template<class T, class Memory>
+    class element_range {
+        const Memory*               _memory = nullptr;
+        // contiguous elements start at _base, node based ones are listed in _addresses
+        std::uintptr_t              _base   = 0;
+        std::size_t                 _size   = 0;
+        std::vector<std::uintptr_t> _addresses;
+
+    public:
+        class iterator {
+            const element_range* _range;
+            std::size_t          _index;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type        = view<T, Memory>;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = void;
+            using reference         = view<T, Memory>;
+
+            iterator(const element_range* range, std::size_t index) noexcept : _range(range), _index(index) {}
+
+            view<T, Memory> operator*() const noexcept { return (*_range)[_index]; }
+            iterator&       operator++() noexcept { return ++_index, *this; }
+            iterator        operator++(int) noexcept { return iterator(_range, _index++); }
+
+            friend bool operator==(const iterator& a, const iterator& b) noexcept { return a._index == b._index; }
+            friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a._index != b._index; }
+        };
+
+        element_range() = default;
+
+        element_range(const Memory& memory, std::uintptr_t base, std::size_t size) noexcept
+                : _memory(&memory), _base(base), _size(size)
+        {}
+
+        element_range(const Memory& memory, std::vector<std::uintptr_t> addresses) noexcept
+                : _memory(&memory), _size(addresses.size()), _addresses(std::move(addresses))
+        {}
+
+        std::size_t size() const noexcept { return _size; }
+        bool        empty() const noexcept { return _size == 0; }
+
+        /// \brief The remote address of element i.
+        std::uintptr_t address(std::size_t i) const noexcept
+        {
+            return _addresses.empty() ? _base + i * sizeof(T) : _addresses[i];
+        }
+
+        view<T, Memory> operator[](std::size_t i) const noexcept { return view<T, Memory>(*_memory, address(i)); }
+
+        iterator begin() const noexcept { return iterator(this, 0); }
+        iterator end() const noexcept { return iterator(this, _size); }
+
+        /// \brief Reads every element. Contiguous elements take a single read, node based ones a single read_many.
+        ///        Fails with std::errc::not_enough_memory if there is no room for the local copy.
+        std::vector<T> read(std::error_code& ec) const
+        {
+            std::vector<T>            elements;
+            std::vector<read_request> requests;
+            try {
+                elements.resize(_size);
+                requests.resize(_addresses.size());
+            }
+            catch (const std::exception&) {
+                // either bad_alloc or length_error
+                ec = std::make_error_code(std::errc::not_enough_memory);
+                return {};
+            }
+
+            if (_size == 0)
+                return elements;
+
+            if (_addresses.empty()) {
+                _memory->read(_base, elements.data(), _size * sizeof(T), ec);
+                return elements;
+            }
+
+            for (std::size_t i = 0; i < _size; ++i)
+                requests[i] = read_request(_addresses[i], &elements[i], sizeof(T));
+
+            if (_memory->read_many(requests, ec) != _size && !ec)
+                ec = std::make_error_code(std::errc::bad_address);
+
+            return elements;
+        }
+
+        std::vector<T> read() const
+        {
+            std::error_code ec;
+            auto            elements = read(ec);
+            if (ec)
+                throw std::system_error(ec, "failed to read the elements");
+
+            return elements;
+        }
+    };
+
+    /// \brief Readers of the containers of libstdc++ in a process with the same data model as this one.
+    ///        Node based containers are walked with batched reads: every level of a tree, every bucket round of
+    ///        a hash table and both ends of a list at once, instead of one read per node.
+    ///        Element types must be trivially copyable and maps must use comparators without state.
+    ///
+    ///        read<Container> returns a local copy of the elements and elements<Container> returns an
+    ///        element_range for which only the links between nodes were read.
+    ///        Unreadable nodes fail with std::errc::bad_address and structures that do not match the size
+    ///        recorded in the container with std::errc::bad_message.
+    namespace libstdcxx {
+
+        namespace detail {
+
+            constexpr std::size_t align_up(std::size_t value, std::size_t alignment) noexcept
+            {
+                return (value + alignment - 1) / alignment * alignment;
+            }
+
+            struct vector_layout {
+                std::uintptr_t start;
+                std::uintptr_t finish;
+                std::uintptr_t end_of_storage;
+            };
+
+            struct list_node_base {
+                std::uintptr_t next;
+                std::uintptr_t prev;
+            };
+
+            struct list_layout {
+                list_node_base header;
+                std::size_t    size;
+            };
+
+            struct tree_node_base {
+                int            color;
+                std::uintptr_t parent;
+                std::uintptr_t left;
+                std::uintptr_t right;
+            };
+
+            // the empty comparator still takes up a pointer sized slot in front of the header
+            struct tree_layout {
+                std::uintptr_t compare;
+                tree_node_base header;
+                std::size_t    node_count;
+            };
+
+            struct hashtable_layout {
+                std::uintptr_t buckets;
+                std::size_t    bucket_count;
+                std::uintptr_t before_begin;
+                std::size_t    element_count;
+                float          max_load_factor;
+                std::size_t    next_resize;
+                std::uintptr_t single_bucket;
+            };
+
+            template<class T>
+            constexpr std::size_t list_value_offset() noexcept { return align_up(sizeof(list_node_base), alignof(T)); }
+
+            template<class T>
+            constexpr std::size_t tree_value_offset() noexcept { return align_up(sizeof(tree_node_base), alignof(T)); }
+
+            template<class T>
+            constexpr std::size_t hash_value_offset() noexcept
+            {
+                return align_up(sizeof(std::uintptr_t), alignof(T));
+            }
+
+            // sizes read from the target only limit how much is reserved up front, so a corrupt size fails the walk
+            // once the nodes run out instead of failing the allocation
+            constexpr std::size_t max_reserve = 64 * 1024;
+
+            template<class T>
+            inline void check_element() noexcept
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "remote elements must be trivially copyable");
+            }
+
+            struct page_slot {
+                std::uintptr_t page;
+                std::size_t    offset;
+            };
+
+            // buffers of node_reader, kept per thread so repeated walks do not fault in fresh memory
+            struct node_reader_scratch {
+                std::vector<page_slot>      pages;
+                std::vector<unsigned char>  storage;
+                std::vector<std::uintptr_t> missing;
+                std::vector<read_request>   requests;
+            };
+
+            /// \brief Reads nodes through a local copy of the pages holding them.
+            ///        Allocators pack nodes densely, so reading the pages of a level as merged contiguous ranges
+            ///        costs far fewer and cheaper iovecs than one per node, and later levels mostly hit pages
+            ///        that were already read.
+            template<class Memory>
+            class node_reader {
+                static constexpr std::size_t page_size = 4096;
+                static constexpr std::size_t npos      = ~std::size_t{0};
+
+                const Memory&        _memory;
+                node_reader_scratch& _scratch;
+                // open addressing table of the pages that were read, mapping them to their offset in storage
+                std::vector<page_slot>& _pages;
+                std::size_t             _page_count = 0;
+
+                static node_reader_scratch& thread_scratch()
+                {
+                    thread_local node_reader_scratch scratch;
+                    return scratch;
+                }
+
+                std::size_t home(std::uintptr_t page) const noexcept
+                {
+                    return static_cast<std::size_t>((page / page_size) * 0x9E3779B97F4A7C15ull) & (_pages.size() - 1);
+                }
+
+                std::size_t find(std::uintptr_t page) const noexcept
+                {
+                    for (auto i = home(page);; i = (i + 1) & (_pages.size() - 1)) {
+                        if (_pages[i].offset == npos)
+                            return npos;
+                        if (_pages[i].page == page)
+                            return _pages[i].offset;
+                    }
+                }
+
+                void insert_slot(std::uintptr_t page, std::size_t offset) noexcept
+                {
+                    auto i = home(page);
+                    while (_pages[i].offset != npos)
+                        i = (i + 1) & (_pages.size() - 1);
+                    _pages[i] = {page, offset};
+                }
+
+                void insert(std::uintptr_t page, std::size_t offset)
+                {
+                    if ((_page_count + 1) * 2 > _pages.size()) {
+                        std::vector<page_slot> old(_pages.size() * 2, page_slot{0, npos});
+                        old.swap(_pages);
+                        for (const auto& s : old)
+                            if (s.offset != npos)
+                                insert_slot(s.page, s.offset);
+                    }
+
+                    insert_slot(page, offset);
+                    ++_page_count;
+                }
+
+                bool fetch_missing(std::error_code& ec)
+                {
+                    auto& missing  = _scratch.missing;
+                    auto& requests = _scratch.requests;
+                    auto& storage  = _scratch.storage;
+                    std::sort(missing.begin(), missing.end());
+                    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+                    const auto base = storage.size();
+                    storage.resize(base + missing.size() * page_size);
+                    requests.clear();
+                    for (std::size_t i = 0, j; i < missing.size(); i = j) {
+                        for (j = i + 1; j < missing.size() && missing[j] == missing[j - 1] + page_size; ++j) {}
+                        requests.push_back(read_request(missing[i], storage.data() + base + i * page_size
+                                                        , (j - i) * page_size));
+                    }
+
+                    _memory.read_many(requests.data(), requests.size(), ec);
+                    if (ec)
+                        return false;
+
+                    // pages past the readable prefix of a range stay missing and fail when a node touches them
+                    std::size_t page = 0;
+                    for (const auto& request : requests)
+                        for (std::size_t offset = 0; offset < request.size; offset += page_size, ++page)
+                            if (offset + page_size <= request.transferred)
+                                insert(missing[page], base + page * page_size);
+
+                    return true;
+                }
+
+            public:
+                explicit node_reader(const Memory& memory)
+                        : _memory(memory), _scratch(thread_scratch()), _pages(_scratch.pages)
+                {
+                    _scratch.storage.clear();
+                    _pages.assign(std::max<std::size_t>(_pages.size(), 64), page_slot{0, npos});
+                }
+
+                /// \brief Copies size bytes at address out of pages that were already read.
+                bool copy(std::uintptr_t address, unsigned char* destination, std::size_t size
+                          , std::error_code& ec) const
+                {
+                    for (std::size_t done = 0; done < size;) {
+                        const auto page   = (address + done) & ~(page_size - 1);
+                        const auto offset = find(page);
+                        if (offset == npos) {
+                            ec = std::make_error_code(std::errc::bad_address);
+                            return false;
+                        }
+
+                        const auto n = std::min(size - done, page_size - (address + done - page));
+                        std::memcpy(destination + done, _scratch.storage.data() + offset + (address + done - page), n);
+                        done += n;
+                    }
+
+                    return true;
+                }
+
+                template<class T>
+                bool load(std::uintptr_t address, T& value, std::error_code& ec) const
+                {
+                    return copy(address, reinterpret_cast<unsigned char*>(&value), sizeof(T), ec);
+                }
+
+                /// \brief Reads count nodes of node_size bytes each, node i into buffer + i * node_size.
+                bool read(const std::uintptr_t* nodes, std::size_t count, std::size_t node_size
+                          , std::vector<unsigned char>& buffer, std::error_code& ec)
+                {
+                    _scratch.missing.clear();
+                    for (std::size_t i = 0; i < count; ++i)
+                        for (auto page = nodes[i] & ~(page_size - 1); page < nodes[i] + node_size; page += page_size)
+                            if (find(page) == npos)
+                                _scratch.missing.push_back(page);
+
+                    if (!_scratch.missing.empty() && !fetch_missing(ec))
+                        return false;
+
+                    buffer.resize(count * node_size);
+                    for (std::size_t i = 0; i < count; ++i)
+                        if (!copy(nodes[i], buffer.data() + i * node_size, node_size, ec))
+                            return false;
+
+                    return true;
+                }
+            };
+
+            template<class Memory>
+            constexpr std::size_t node_reader<Memory>::page_size;
+            template<class Memory>
+            constexpr std::size_t node_reader<Memory>::npos;
+
+            template<class T>
+            inline T load(const unsigned char* data) noexcept
+            {
+                T value;
+                std::memcpy(&value, data, sizeof(T));
+                return value;
+            }
+
+            // walks a red black tree level by level. Node addresses are returned in key order
+            template<class T, class Memory>
+            inline void walk_tree(const Memory& memory, std::uintptr_t address, bool read_values
+                                  , std::vector<std::uintptr_t>& nodes, std::vector<T>& values, std::error_code& ec)
+            {
+                tree_layout tree;
+                memory.read(address, tree, ec);
+                if (ec || tree.node_count == 0)
+                    return;
+
+                struct node {
+                    std::uintptr_t address;
+                    std::size_t    left;
+                    std::size_t    right;
+                };
+
+                constexpr auto npos      = ~std::size_t{0};
+                const auto     node_size = read_values ? tree_value_offset<T>() + sizeof(T) : sizeof(tree_node_base);
+
+                std::vector<node>           walked;
+                std::vector<std::uintptr_t> frontier{tree.header.parent};
+                std::vector<std::size_t>    parents{npos};
+                std::vector<std::uintptr_t> next_frontier;
+                std::vector<std::size_t>    next_parents;
+                std::vector<unsigned char>  buffer;
+                node_reader<Memory>         reader(memory);
+                walked.reserve(std::min(tree.node_count, max_reserve));
+
+                while (!frontier.empty()) {
+                    if (walked.size() + frontier.size() > tree.node_count) {
+                        ec = std::make_error_code(std::errc::bad_message);
+                        return;
+                    }
+
+                    if (!reader.read(frontier.data(), frontier.size(), node_size, buffer, ec))
+                        return;
+
+                    next_frontier.clear();
+                    next_parents.clear();
+                    for (std::size_t i = 0; i < frontier.size(); ++i) {
+                        const auto data  = buffer.data() + i * node_size;
+                        const auto base  = load<tree_node_base>(data);
+                        const auto index = walked.size();
+                        walked.push_back({frontier[i], npos, npos});
+
+                        // the low bit of the parent slot records which side of the parent the node is on
+                        if (parents[i] != npos)
+                            (parents[i] & 1 ? walked[parents[i] >> 1].right : walked[parents[i] >> 1].left) = index;
+
+                        if (base.left) {
+                            next_frontier.push_back(base.left);
+                            next_parents.push_back(index << 1);
+                        }
+                        if (base.right) {
+                            next_frontier.push_back(base.right);
+                            next_parents.push_back(index << 1 | 1);
+                        }
+                    }
+
+                    frontier.swap(next_frontier);
+                    parents.swap(next_parents);
+                }
+
+                if (walked.size() != tree.node_count) {
+                    ec = std::make_error_code(std::errc::bad_message);
+                    return;
+                }
+
+                // in order traversal of the local copy of the links. values are copied out of the cached pages
+                std::vector<std::size_t> stack;
+                nodes.reserve(walked.size());
+                if (read_values)
+                    values.resize(walked.size());
+                for (std::size_t current = 0; current != npos || !stack.empty();) {
+                    for (; current != npos; current = walked[current].left)
+                        stack.push_back(current);
+
+                    current = stack.back();
+                    stack.pop_back();
+                    nodes.push_back(walked[current].address + tree_value_offset<T>());
+                    if (read_values && !reader.load(nodes.back(), values[nodes.size() - 1], ec))
+                        return;
+
+                    current = walked[current].right;
+                }
+            }
+
+            // walks a list from both ends at once, so every read_many covers two nodes
+            template<class T, class Memory>
+            inline void walk_list(const Memory& memory, std::uintptr_t address, bool read_values
+                                  , std::vector<std::uintptr_t>& nodes, std::vector<T>& values, std::error_code& ec)
+            {
+                list_layout list;
+                memory.read(address, list, ec);
+                if (ec || list.size == 0)
+                    return;
+
+                const auto node_size = read_values ? list_value_offset<T>() + sizeof(T) : sizeof(list_node_base);
+
+                std::vector<std::uintptr_t> front;
+                std::vector<std::uintptr_t> back;
+                std::vector<T>              front_values;
+                std::vector<T>              back_values;
+                std::vector<unsigned char>  buffer;
+                node_reader<Memory>         reader(memory);
+                auto                        forward  = list.header.next;
+                auto                        backward = list.header.prev;
+                while (front.size() + back.size() < list.size) {
+                    std::uintptr_t    pending[2] = {forward, backward};
+                    const std::size_t count      = list.size - front.size() - back.size() >= 2 ? 2 : 1;
+                    if (forward == address || backward == address) {
+                        ec = std::make_error_code(std::errc::bad_message);
+                        return;
+                    }
+
+                    if (!reader.read(pending, count, node_size, buffer, ec))
+                        return;
+
+                    const auto first = load<list_node_base>(buffer.data());
+                    front.push_back(forward + list_value_offset<T>());
+                    if (read_values)
+                        front_values.push_back(load<T>(buffer.data() + list_value_offset<T>()));
+                    forward = first.next;
+
+                    if (count == 2) {
+                        const auto second = load<list_node_base>(buffer.data() + node_size);
+                        back.push_back(backward + list_value_offset<T>());
+                        if (read_values)
+                            back_values.push_back(load<T>(buffer.data() + node_size + list_value_offset<T>()));
+                        backward = second.prev;
+                    }
+                }
+
+                nodes = std::move(front);
+                nodes.insert(nodes.end(), back.rbegin(), back.rend());
+                if (read_values) {
+                    values = std::move(front_values);
+                    values.insert(values.end(), back_values.rbegin(), back_values.rend());
+                }
+            }
+
+            // walks every bucket chain of a hash table at once and returns the nodes in iteration order
+            template<class T, class Memory>
+            inline void walk_hashtable(const Memory& memory, std::uintptr_t address, bool read_values
+                                       , std::vector<std::uintptr_t>& nodes, std::vector<T>& values
+                                       , std::error_code& ec)
+            {
+                constexpr auto npos = ~std::size_t{0};
+
+                hashtable_layout table;
+                memory.read(address, table, ec);
+                if (ec || table.element_count == 0)
+                    return;
+
+                if (table.bucket_count == 0
+                    || table.bucket_count > (~std::uintptr_t{0} - table.buckets) / sizeof(std::uintptr_t)) {
+                    ec = std::make_error_code(std::errc::bad_message);
+                    return;
+                }
+
+                // every bucket stores the node before its first node, which may be the before_begin member itself.
+                // the bucket array is read in chunks keeping only the distinct nodes, of which there are never more
+                // than elements, so a corrupt bucket count fails instead of allocating for all of its buckets
+                const auto                  before_begin = address + offsetof(hashtable_layout, before_begin);
+                std::vector<std::uintptr_t> buckets;
+                std::vector<std::uintptr_t> chunk(std::min(table.bucket_count, max_reserve));
+                const auto                  distinct = [&] {
+                    std::sort(buckets.begin(), buckets.end());
+                    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+                    return buckets.size() <= table.element_count;
+                };
+
+                for (std::size_t i = 0; i < table.bucket_count;) {
+                    const auto count = std::min(chunk.size(), table.bucket_count - i);
+                    memory.read(table.buckets + i * sizeof(std::uintptr_t), chunk.data()
+                                , count * sizeof(std::uintptr_t), ec);
+                    if (ec)
+                        return;
+
+                    for (std::size_t j = 0; j < count; ++j)
+                        if (chunk[j] && chunk[j] != before_begin)
+                            buckets.push_back(chunk[j]);
+
+                    i += count;
+                    if (buckets.size() > table.element_count && !distinct()) {
+                        ec = std::make_error_code(std::errc::bad_message);
+                        return;
+                    }
+                }
+
+                distinct();
+
+                std::vector<unsigned char>  buffer;
+                node_reader<Memory>         reader(memory);
+                std::vector<std::uintptr_t> heads{table.before_begin};
+                if (!reader.read(buckets.data(), buckets.size(), sizeof(std::uintptr_t), buffer, ec))
+                    return;
+                for (std::size_t i = 0; i < buckets.size(); ++i)
+                    heads.push_back(load<std::uintptr_t>(buffer.data() + i * sizeof(std::uintptr_t)));
+
+                if (heads.size() > table.element_count) {
+                    ec = std::make_error_code(std::errc::bad_message);
+                    return;
+                }
+
+                // heads sorted by address, to tell whether a node starts a bucket
+                std::vector<std::size_t> order(heads.size());
+                for (std::size_t i = 0; i < heads.size(); ++i)
+                    order[i] = i;
+                std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return heads[a] < heads[b]; });
+                const auto find_head = [&](std::uintptr_t node) {
+                    const auto it = std::lower_bound(order.begin(), order.end(), node
+                                                     , [&](std::size_t i, std::uintptr_t h) { return heads[i] < h; });
+                    return it != order.end() && heads[*it] == node ? *it : npos;
+                };
+
+                // the chains are kept as links between walked nodes so no chain needs its own allocation
+                struct chain {
+                    std::size_t    first;
+                    std::size_t    last;
+                    std::uintptr_t next_head;
+                };
+
+                const auto node_size = read_values ? hash_value_offset<T>() + sizeof(T) : sizeof(std::uintptr_t);
+
+                std::vector<chain>          chains(heads.size(), chain{npos, npos, 0});
+                std::vector<std::uintptr_t> walked;
+                std::vector<std::size_t>    links;
+                std::vector<std::uintptr_t> frontier = heads;
+                std::vector<std::size_t>    owners(heads.size());
+                std::vector<std::uintptr_t> next_frontier;
+                std::vector<std::size_t>    next_owners;
+                for (std::size_t i = 0; i < owners.size(); ++i)
+                    owners[i] = i;
+
+                walked.reserve(std::min(table.element_count, max_reserve));
+                links.reserve(std::min(table.element_count, max_reserve));
+
+                while (!frontier.empty()) {
+                    if (walked.size() + frontier.size() > table.element_count) {
+                        ec = std::make_error_code(std::errc::bad_message);
+                        return;
+                    }
+
+                    if (!reader.read(frontier.data(), frontier.size(), node_size, buffer, ec))
+                        return;
+
+                    next_frontier.clear();
+                    next_owners.clear();
+                    for (std::size_t i = 0; i < frontier.size(); ++i) {
+                        const auto data  = buffer.data() + i * node_size;
+                        const auto next  = load<std::uintptr_t>(data);
+                        const auto index = walked.size();
+                        auto&      c     = chains[owners[i]];
+                        walked.push_back(frontier[i] + hash_value_offset<T>());
+                        links.push_back(npos);
+
+                        (c.last == npos ? c.first : links[c.last]) = index;
+                        c.last = index;
+
+                        // a chain ends where the next bucket begins
+                        if (next && find_head(next) == npos) {
+                            next_frontier.push_back(next);
+                            next_owners.push_back(owners[i]);
+                        }
+                        else
+                            c.next_head = next;
+                    }
+
+                    frontier.swap(next_frontier);
+                    owners.swap(next_owners);
+                }
+
+                // stitch the chains back together in the order of the singly linked list
+                nodes.reserve(walked.size());
+                if (read_values)
+                    values.resize(walked.size());
+                for (std::size_t current = 0, count = 0; current != npos && count < chains.size(); ++count) {
+                    for (auto i = chains[current].first; i != npos && nodes.size() < walked.size(); i = links[i]) {
+                        nodes.push_back(walked[i]);
+                        if (read_values && !reader.load(walked[i], values[nodes.size() - 1], ec))
+                            return;
+                    }
+
+                    current = chains[current].next_head ? find_head(chains[current].next_head) : npos;
+                }
+
+                if (nodes.size() != table.element_count)
+                    ec = std::make_error_code(std::errc::bad_message);
+            }
+
+            template<class Result>
+            inline Result throw_on_error(Result result, const std::error_code& ec)
+            {
+                if (ec)
+                    throw std::system_error(ec, "failed to read a remote container");
+
+                return result;
+            }
+
+        } // namespace detail
+
+        namespace detail {
+
+            // read and elements of node based containers in terms of Derived::walk
+            template<class Derived, class Element>
+            struct node_container {
+                using element = Element;
+
+                template<class Memory>
+                static std::vector<element> read(const Memory& memory, std::uintptr_t address, std::error_code& ec)
+                {
+                    check_element<element>();
+                    std::vector<std::uintptr_t> nodes;
+                    std::vector<element>        values;
+                    Derived::walk(memory, address, true, nodes, values, ec);
+                    return values;
+                }
+
+                template<class Memory>
+                static element_range<element, Memory> elements(const Memory& memory, std::uintptr_t address
+                                                                , std::error_code& ec)
+                {
+                    check_element<element>();
+                    std::vector<std::uintptr_t> nodes;
+                    std::vector<element>        values;
+                    Derived::walk(memory, address, false, nodes, values, ec);
+                    return element_range<element, Memory>(memory, std::move(nodes));
+                }
+            };
+
+        } // namespace detail
+
+        // descriptors of the supported containers, passed to read and elements
+
+        /// \brief std::vector<T>. Read with one read of the header and one of the element array.
+        template<class T>
+        struct vector {
+            using element = T;
+
+            template<class Memory>
+            static element_range<T, Memory> elements(const Memory& memory, std::uintptr_t address, std::error_code& ec)
+            {
+                detail::check_element<T>();
+                detail::vector_layout layout;
+                memory.read(address, layout, ec);
+                if (ec)
+                    return {};
+
+                const auto bytes = layout.finish - layout.start;
+                if (layout.finish < layout.start || layout.end_of_storage < layout.finish || bytes % sizeof(T) != 0
+                    || bytes / sizeof(T) > std::vector<T>().max_size()) {
+                    ec = std::make_error_code(std::errc::bad_message);
+                    return {};
+                }
+
+                return element_range<T, Memory>(memory, layout.start, bytes / sizeof(T));
+            }
+
+            template<class Memory>
+            static std::vector<T> read(const Memory& memory, std::uintptr_t address, std::error_code& ec)
+            {
+                const auto range = elements(memory, address, ec);
+                return ec ? std::vector<T>{} : range.read(ec);
+            }
+        };
+
+        /// \brief std::list<T>. Walked from both ends at once.
+        template<class T>
+        struct list : detail::node_container<list<T>, T> {
+            template<class... Args>
+            static void walk(Args&&... args) { detail::walk_list<T>(std::forward<Args>(args)...); }
+        };
+
+        /// \brief std::set<K> and std::multiset<K>, in key order.
+        template<class K>
+        struct set : detail::node_container<set<K>, K> {
+            template<class... Args>
+            static void walk(Args&&... args) { detail::walk_tree<K>(std::forward<Args>(args)...); }
+        };
+
+        /// \brief std::map<K, V> and std::multimap<K, V>, in key order.
+        template<class K, class V>
+        struct map : detail::node_container<map<K, V>, map_entry<K, V>> {
+            template<class... Args>
+            static void walk(Args&&... args) { detail::walk_tree<map_entry<K, V>>(std::forward<Args>(args)...); }
+        };
+
+        /// \brief std::unordered_set<K>, in iteration order.
+        template<class K>
+        struct unordered_set : detail::node_container<unordered_set<K>, K> {
+            template<class... Args>
+            static void walk(Args&&... args) { detail::walk_hashtable<K>(std::forward<Args>(args)...); }
+        };
+
+        /// \brief std::unordered_map<K, V>, in iteration order.
+        template<class K, class V>
+        struct unordered_map : detail::node_container<unordered_map<K, V>, map_entry<K, V>> {
+            template<class... Args>
+            static void walk(Args&&... args)
+            {
+                detail::walk_hashtable<map_entry<K, V>>(std::forward<Args>(args)...);
+            }
+        };
+
+        /// \brief The elements of a remote container. Only the links between nodes are read.
+        /// \tparam Container One of the descriptors above, for example libstdcxx::map<int, float>.
+        /// \param address The address of the container object itself.
+        template<class Container, class Memory, class Address>
+        inline element_range<typename Container::element, Memory> elements(const Memory& memory, Address address
+                                                                           , std::error_code& ec)
+        {
+            return Container::elements(memory, jm::detail::pointer_cast<std::uintptr_t>(address), ec);
+        }
+
+        template<class Container, class Memory, class Address>
+        inline element_range<typename Container::element, Memory> elements(const Memory& memory, Address address)
+        {
+            std::error_code ec;
+            return detail::throw_on_error(elements<Container>(memory, address, ec), ec);
+        }
+
+        /// \brief Reads a remote container into a local vector.
+        /// \tparam Container One of the descriptors above, for example libstdcxx::map<int, float>.
+        /// \param address The address of the container object itself.
+        template<class Container, class Memory, class Address>
+        inline std::vector<typename Container::element> read(const Memory& memory, Address address
+                                                             , std::error_code& ec)
+        {
+            return Container::read(memory, jm::detail::pointer_cast<std::uintptr_t>(address), ec);
+        }
+
+        template<class Container, class Memory, class Address>
+        inline std::vector<typename Container::element> read(const Memory& memory, Address address)
+        {
+            std::error_code ec;
+            return detail::throw_on_error(read<Container>(memory, address, ec), ec);
+        }
+
+    } // namespace libstdcxx
+
+} // namespace remote
+
+#endif // include guard
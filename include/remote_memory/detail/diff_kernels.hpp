@@ -0,0 +1,188 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_DIFF_KERNELS_HPP
+#define REMOTE_MEMORY_DIFF_KERNELS_HPP
+
+#include "simd.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace remote { namespace detail {
+
+    /// \brief Turns masks of differing bytes into runs of differing bytes.
+    ///        Runs are reported through callback(offset, size) and may continue across masks.
+    template<class Callback>
+    class diff_runs {
+        Callback&   _callback;
+        std::size_t _begin = 0;
+        bool        _open  = false;
+
+    public:
+        explicit diff_runs(Callback& callback) noexcept : _callback(callback) {}
+
+        /// \brief Consumes a block of bytes where every byte is equal.
+        void equal(std::size_t position)
+        {
+            if (_open) {
+                _callback(_begin, position - _begin);
+                _open = false;
+            }
+        }
+
+        /// \brief Consumes count bytes starting at position. Bit i of differing is set if byte
+        ///        position + i differs.
+        void block(std::size_t position, std::uint64_t differing, unsigned count)
+        {
+            const std::uint64_t valid = count == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1;
+            for (unsigned bit = 0; bit < count;) {
+                const auto remaining = (_open ? ~differing : differing) & valid & (~std::uint64_t{0} << bit);
+                if (!remaining)
+                    return;
+
+                bit = lowest_bit(remaining);
+                if (_open)
+                    _callback(_begin, position + bit - _begin);
+                else
+                    _begin = position + bit;
+
+                _open = !_open;
+            }
+        }
+
+        /// \brief Reports the run that is still open at the end of the data.
+        void finish(std::size_t size)
+        {
+            equal(size);
+        }
+    };
+
+    inline std::uint64_t differing_bytes_scalar(const std::uint8_t* a, const std::uint8_t* b, unsigned count) noexcept
+    {
+        std::uint64_t mask = 0;
+        for (unsigned i = 0; i < count; ++i)
+            mask |= std::uint64_t{a[i] != b[i]} << i;
+
+        return mask;
+    }
+
+    // every kernel calls callback(offset, size) for each run of bytes that differ between a and b
+
+    template<class Callback>
+    inline void find_differences_scalar(const std::uint8_t* a, const std::uint8_t* b, std::size_t size
+                                        , Callback& callback)
+    {
+        diff_runs<Callback> runs(callback);
+        std::size_t         pos = 0;
+        for (; pos + 64 <= size; pos += 64) {
+            // memcmp is vectorized by every libc worth using, so equal blocks stay cheap
+            if (std::memcmp(a + pos, b + pos, 64) == 0)
+                runs.equal(pos);
+            else
+                runs.block(pos, differing_bytes_scalar(a + pos, b + pos, 64), 64);
+        }
+
+        if (pos < size)
+            runs.block(pos, differing_bytes_scalar(a + pos, b + pos, static_cast<unsigned>(size - pos))
+                       , static_cast<unsigned>(size - pos));
+
+        runs.finish(size);
+    }
+
+#if defined(REMOTE_MEMORY_X86_SIMD)
+
+    template<class Callback>
+    REMOTE_MEMORY_TARGET_SSE2
+    inline void find_differences_sse2(const std::uint8_t* a, const std::uint8_t* b, std::size_t size
+                                      , Callback& callback)
+    {
+        diff_runs<Callback> runs(callback);
+        std::size_t         pos = 0;
+        for (; pos + 64 <= size; pos += 64) {
+            std::uint64_t equal = 0;
+            for (unsigned i = 0; i < 4; ++i) {
+                const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + pos + i * 16));
+                const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + pos + i * 16));
+                equal |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))))
+                         << (i * 16);
+            }
+
+            if (equal == ~std::uint64_t{0})
+                runs.equal(pos);
+            else
+                runs.block(pos, ~equal, 64);
+        }
+
+        if (pos < size)
+            runs.block(pos, differing_bytes_scalar(a + pos, b + pos, static_cast<unsigned>(size - pos))
+                       , static_cast<unsigned>(size - pos));
+
+        runs.finish(size);
+    }
+
+    template<class Callback>
+    REMOTE_MEMORY_TARGET_AVX2
+    inline void find_differences_avx2(const std::uint8_t* a, const std::uint8_t* b, std::size_t size
+                                      , Callback& callback)
+    {
+        diff_runs<Callback> runs(callback);
+        std::size_t         pos = 0;
+        for (; pos + 64 <= size; pos += 64) {
+            const auto x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + pos));
+            const auto y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + pos));
+            const auto x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + pos + 32));
+            const auto y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + pos + 32));
+
+            // the common case of identical blocks costs two xors and a test
+            const auto changed = _mm256_or_si256(_mm256_xor_si256(x0, y0), _mm256_xor_si256(x1, y1));
+            if (_mm256_testz_si256(changed, changed)) {
+                runs.equal(pos);
+                continue;
+            }
+
+            const auto low  = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x0, y0)));
+            const auto high = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x1, y1)));
+            runs.block(pos, ~(static_cast<std::uint64_t>(high) << 32 | low), 64);
+        }
+
+        if (pos < size)
+            runs.block(pos, differing_bytes_scalar(a + pos, b + pos, static_cast<unsigned>(size - pos))
+                       , static_cast<unsigned>(size - pos));
+
+        runs.finish(size);
+    }
+
+#endif
+
+    /// \brief Finds every run of differing bytes between [a; a + size] and [b; b + size] with the best kernel
+    ///        the cpu supports. Runs are reported in ascending order.
+    template<class Callback>
+    inline void find_differences(const std::uint8_t* a, const std::uint8_t* b, std::size_t size, Callback& callback)
+    {
+#if defined(REMOTE_MEMORY_X86_SIMD)
+        switch (detected_simd_level()) {
+        case simd_level::avx2: return find_differences_avx2(a, b, size, callback);
+        case simd_level::sse2: return find_differences_sse2(a, b, size, callback);
+        default: break;
+        }
+#endif
+        find_differences_scalar(a, b, size, callback);
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
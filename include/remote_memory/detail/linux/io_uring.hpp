@@ -0,0 +1,232 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_IO_URING_HPP
+#define REMOTE_MEMORY_LINUX_IO_URING_HPP
+
+#include "../error.hpp"
+#include "unique_fd.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #define REMOTE_MEMORY_HAS_IO_URING
+    #endif
+#endif
+
+namespace remote { namespace detail {
+
+#if defined(REMOTE_MEMORY_HAS_IO_URING) && defined(__NR_io_uring_setup)
+
+    /// \brief Minimal io_uring instance driven through the raw system calls, so liburing is not needed.
+    ///        The submission queue must only be used by one thread at a time and the completion queue
+    ///        by one thread at a time, but the two may be used concurrently.
+    class io_uring_queue {
+        unique_fd     _fd;
+        void*         _sq_ring      = MAP_FAILED;
+        std::size_t   _sq_ring_size = 0;
+        void*         _cq_ring      = MAP_FAILED;
+        std::size_t   _cq_ring_size = 0;
+        io_uring_sqe* _sqes         = static_cast<io_uring_sqe*>(MAP_FAILED);
+        std::size_t   _sqes_size    = 0;
+
+        unsigned*     _sq_head  = nullptr;
+        unsigned*     _sq_tail  = nullptr;
+        unsigned*     _sq_array = nullptr;
+        unsigned      _sq_mask  = 0;
+        unsigned*     _cq_head  = nullptr;
+        unsigned*     _cq_tail  = nullptr;
+        io_uring_cqe* _cqes     = nullptr;
+        unsigned      _cq_mask  = 0;
+
+        unsigned _sq_entries  = 0;
+        unsigned _cq_entries  = 0;
+        unsigned _unsubmitted = 0;
+        unsigned _sqe_flags   = 0;
+
+        static unsigned* at(void* ring, std::uint32_t offset) noexcept
+        {
+            return reinterpret_cast<unsigned*>(static_cast<std::uint8_t*>(ring) + offset);
+        }
+
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags) const noexcept
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, _fd.get(), to_submit, min_complete, flags
+                                              , nullptr, 0));
+        }
+
+    public:
+        io_uring_queue() = default;
+
+        ~io_uring_queue()
+        {
+            if (_sqes != MAP_FAILED)
+                ::munmap(_sqes, _sqes_size);
+            if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+                ::munmap(_cq_ring, _cq_ring_size);
+            if (_sq_ring != MAP_FAILED)
+                ::munmap(_sq_ring, _sq_ring_size);
+        }
+
+        io_uring_queue(const io_uring_queue&) = delete;
+        io_uring_queue& operator=(const io_uring_queue&) = delete;
+
+        /// \brief Creates the rings. ec is set if io_uring is not available.
+        void open(unsigned entries, std::error_code& ec) noexcept
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            const auto fd = ::syscall(__NR_io_uring_setup, entries, &params);
+            if (fd < 0) {
+                ec = get_last_error();
+                return;
+            }
+
+            _fd.reset(static_cast<int>(fd));
+            _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+            _sq_ring = ::mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd.get()
+                              , IORING_OFF_SQ_RING);
+            if (_sq_ring == MAP_FAILED) {
+                ec = get_last_error();
+                return;
+            }
+
+            _cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+                       ? _sq_ring
+                       : ::mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE
+                                , _fd.get(), IORING_OFF_CQ_RING);
+            if (_cq_ring == MAP_FAILED) {
+                ec = get_last_error();
+                return;
+            }
+
+            _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            _sqes      = static_cast<io_uring_sqe*>(::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE
+                                                           , MAP_SHARED | MAP_POPULATE, _fd.get(), IORING_OFF_SQES));
+            if (_sqes == MAP_FAILED) {
+                ec = get_last_error();
+                return;
+            }
+
+            _sq_head    = at(_sq_ring, params.sq_off.head);
+            _sq_tail    = at(_sq_ring, params.sq_off.tail);
+            _sq_array   = at(_sq_ring, params.sq_off.array);
+            _sq_mask    = *at(_sq_ring, params.sq_off.ring_mask);
+            _cq_head    = at(_cq_ring, params.cq_off.head);
+            _cq_tail    = at(_cq_ring, params.cq_off.tail);
+            _cqes       = reinterpret_cast<io_uring_cqe*>(static_cast<std::uint8_t*>(_cq_ring) + params.cq_off.cqes);
+            _cq_mask    = *at(_cq_ring, params.cq_off.ring_mask);
+            _sq_entries = params.sq_entries;
+            _cq_entries = params.cq_entries;
+
+#if defined(IOSQE_ASYNC) && defined(IORING_FEAT_FAST_POLL)
+            // files such as /proc/<pid>/mem can not be read without blocking, so the inline attempt is
+            // skipped and operations go straight to the kernel workers. the feature bit implies kernel 5.7+
+            if (params.features & IORING_FEAT_FAST_POLL)
+                _sqe_flags = IOSQE_ASYNC;
+#endif
+        }
+
+        unsigned sq_entries() const noexcept { return _sq_entries; }
+        unsigned cq_entries() const noexcept { return _cq_entries; }
+        unsigned unsubmitted() const noexcept { return _unsubmitted; }
+
+        /// \brief Queues an operation. Returns false if the submission queue is full.
+        bool push(std::uint8_t opcode, int fd, std::uint64_t offset, const void* buffer, std::size_t size
+                  , std::uint64_t user_data) noexcept
+        {
+            const auto tail = *_sq_tail;
+            if (tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries)
+                return false;
+
+            const auto index = tail & _sq_mask;
+            auto&      sqe   = _sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode    = opcode;
+            sqe.fd        = fd;
+            sqe.off       = offset;
+            sqe.addr      = reinterpret_cast<std::uintptr_t>(buffer);
+            sqe.len       = static_cast<std::uint32_t>(size);
+            sqe.user_data = user_data;
+            sqe.flags     = static_cast<std::uint8_t>(_sqe_flags);
+
+            _sq_array[index] = index;
+            __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+            ++_unsubmitted;
+            return true;
+        }
+
+        /// \brief Hands every queued operation to the kernel.
+        void submit(std::error_code& ec) noexcept
+        {
+            while (_unsubmitted) {
+                const auto result = enter(_unsubmitted, 0, 0);
+                if (result < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                        continue;
+
+                    ec = get_last_error();
+                    return;
+                }
+
+                _unsubmitted -= static_cast<unsigned>(result);
+            }
+        }
+
+        /// \brief Blocks until at least one completion is available.
+        void wait(std::error_code& ec) const noexcept
+        {
+            while (__atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE) == *_cq_head) {
+                if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                    ec = get_last_error();
+                    return;
+                }
+            }
+        }
+
+        /// \brief Calls fn(user_data, result) for every available completion.
+        template<class Fn>
+        unsigned reap(Fn fn) noexcept
+        {
+            auto       head  = *_cq_head;
+            const auto tail  = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            unsigned   count = 0;
+            for (; head != tail; ++head, ++count) {
+                const auto& cqe = _cqes[head & _cq_mask];
+                fn(cqe.user_data, cqe.res);
+            }
+
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+            return count;
+        }
+    };
+
+#endif
+
+}} // namespace remote::detail
+
+#endif // include guard
@@ -0,0 +1,58 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_MAP_FILES_HPP
+#define REMOTE_MEMORY_LINUX_MAP_FILES_HPP
+
+#include "unique_fd.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+
+namespace remote { namespace detail {
+
+    /// \brief Opens the file that pid maps at [begin; end).
+    ///        The file is opened through /proc/<pid>/map_files, which needs CAP_SYS_ADMIN or
+    ///        CAP_CHECKPOINT_RESTORE, and otherwise through the first of paths that still leads to the same file.
+    /// \param inode The inode and device the maps of the process report for the mapping.
+    /// \return An invalid descriptor if the file could not be opened.
+    inline unique_fd open_mapped_file(pid_t pid, std::uintptr_t begin, std::uintptr_t end, std::uint64_t inode
+                                      , dev_t device, int flags, std::initializer_list<const char*> paths) noexcept
+    {
+        char map_file[64];
+        std::snprintf(map_file, sizeof(map_file), "/proc/%d/map_files/%lx-%lx", static_cast<int>(pid)
+                      , static_cast<unsigned long>(begin), static_cast<unsigned long>(end));
+
+        unique_fd fd(::open(map_file, flags | O_CLOEXEC));
+        if (fd)
+            return fd;
+
+        for (const auto path : paths) {
+            fd.reset(::open(path, flags | O_CLOEXEC));
+            struct stat info;
+            if (fd && ::fstat(fd.get(), &info) == 0 && info.st_ino == inode && info.st_dev == device)
+                return fd;
+        }
+
+        return {};
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
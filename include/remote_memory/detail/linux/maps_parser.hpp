@@ -0,0 +1,157 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_MAPS_PARSER_HPP
+#define REMOTE_MEMORY_LINUX_MAPS_PARSER_HPP
+
+#include "../../native_types.hpp"
+#include "../error.hpp"
+#include "unique_fd.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace remote { namespace detail {
+
+    /// \brief Reads the whole /proc/<pid>/maps file into out.
+    /// \return Whether the read succeeded.
+    inline bool read_maps(pid_t pid, std::string& out, std::error_code& ec)
+    {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%d/maps", static_cast<int>(pid));
+
+        const unique_fd fd(::open(path, O_RDONLY | O_CLOEXEC));
+        if (!fd) {
+            ec = get_last_error();
+            return false;
+        }
+
+        out.clear();
+        std::size_t size = 0;
+        for (;;) {
+            if (out.size() - size < 4096)
+                out.resize(size + 16384);
+
+            const auto result = ::read(fd.get(), &out[size], out.size() - size);
+            if (result > 0)
+                size += static_cast<std::size_t>(result);
+            else if (result == 0)
+                break;
+            else if (errno != EINTR) {
+                ec = get_last_error();
+                return false;
+            }
+        }
+
+        out.resize(size);
+        return true;
+    }
+
+    struct maps_line {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::uint64_t  offset;
+        std::uint64_t  inode;
+        std::uint32_t  device_major;
+        std::uint32_t  device_minor;
+        std::uint8_t   permissions;
+        const char*    path;
+        std::size_t    path_length;
+    };
+
+    /// \brief Splits the contents of /proc/<pid>/maps into lines of the form
+    ///        begin-end perms offset major:minor inode [path]
+    class maps_parser {
+        const char* _current;
+        const char* _last;
+
+        std::uint64_t number(int base) noexcept
+        {
+            std::uint64_t value = 0;
+            for (; _current != _last; ++_current) {
+                const auto c = *_current;
+                unsigned   digit;
+                if (c >= '0' && c <= '9')
+                    digit = static_cast<unsigned>(c - '0');
+                else if (base == 16 && c >= 'a' && c <= 'f')
+                    digit = static_cast<unsigned>(c - 'a' + 10);
+                else
+                    break;
+
+                value = value * base + digit;
+            }
+
+            return value;
+        }
+
+        void skip(char c) noexcept
+        {
+            while (_current != _last && *_current == c)
+                ++_current;
+        }
+
+        void skip_separator() noexcept
+        {
+            if (_current != _last)
+                ++_current;
+        }
+
+    public:
+        maps_parser(const char* first, const char* last) noexcept : _current(first), _last(last) {}
+
+        bool next(maps_line& line) noexcept
+        {
+            if (_current == _last)
+                return false;
+
+            line.begin = static_cast<std::uintptr_t>(number(16));
+            skip_separator();
+            line.end = static_cast<std::uintptr_t>(number(16));
+            skip(' ');
+
+            // rwxp or rwxs
+            static constexpr char flags[] = {'r', 'w', 'x', 's'};
+            line.permissions = 0;
+            for (std::uint8_t i = 0; i < 4 && _current != _last; ++i, ++_current)
+                if (*_current == flags[i])
+                    line.permissions |= static_cast<std::uint8_t>(1 << i);
+
+            skip(' ');
+            line.offset = number(16);
+            skip(' ');
+            line.device_major = static_cast<std::uint32_t>(number(16));
+            skip_separator();
+            line.device_minor = static_cast<std::uint32_t>(number(16));
+            skip(' ');
+            line.inode = number(10);
+            skip(' ');
+
+            line.path = _current;
+            while (_current != _last && *_current != '\n')
+                ++_current;
+
+            line.path_length = static_cast<std::size_t>(_current - line.path);
+            skip_separator();
+            return true;
+        }
+    };
+
+}} // namespace remote::detail
+
+#endif // include guard
@@ -0,0 +1,86 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_PROCMEM_HPP
+#define REMOTE_MEMORY_LINUX_PROCMEM_HPP
+
+#include "../../native_types.hpp"
+#include "../error.hpp"
+#include "unique_fd.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+
+namespace remote { namespace detail {
+
+    /// \brief Opens /proc/<pid>/mem for reading and writing, or only reading if writing is not permitted.
+    inline unique_fd open_procmem(pid_t pid, std::error_code& ec) noexcept
+    {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%d/mem", static_cast<int>(pid));
+
+        int fd = ::open(path, O_RDWR | O_CLOEXEC);
+        if (fd == -1 && (errno == EACCES || errno == EPERM))
+            fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1)
+            ec = get_last_error();
+
+        return unique_fd(fd);
+    }
+
+    /// \brief Repeats pread / pwrite until the whole range is transferred or no more progress can be made.
+    /// \return The number of bytes transferred. ec is only set if nothing was transferred.
+    ///         Unmapped memory is reported as bad_address like process_vm_readv does, not as the EIO of /proc.
+    template<class Buffer, class Transfer>
+    inline std::size_t procmem_transfer(Transfer transfer, int fd, std::uintptr_t address, Buffer* buffer
+                                        , std::size_t size, std::error_code& ec) noexcept
+    {
+        std::size_t done = 0;
+        while (done < size) {
+            const auto result = transfer(fd, buffer + done, size - done, static_cast<::off_t>(address + done));
+            if (result > 0)
+                done += static_cast<std::size_t>(result);
+            else if (result == 0)
+                break;
+            else if (errno != EINTR) {
+                if (done == 0)
+                    ec = errno == EIO ? std::make_error_code(std::errc::bad_address) : get_last_error();
+
+                break;
+            }
+        }
+
+        return done;
+    }
+
+    inline std::size_t procmem_read(int fd, std::uintptr_t address, void* buffer, std::size_t size
+                                    , std::error_code& ec) noexcept
+    {
+        return procmem_transfer(&::pread, fd, address, static_cast<std::uint8_t*>(buffer), size, ec);
+    }
+
+    inline std::size_t procmem_write(int fd, std::uintptr_t address, const void* buffer, std::size_t size
+                                     , std::error_code& ec) noexcept
+    {
+        return procmem_transfer(&::pwrite, fd, address, static_cast<const std::uint8_t*>(buffer), size, ec);
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
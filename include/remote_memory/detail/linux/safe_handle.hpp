@@ -28,6 +28,8 @@ namespace remote { namespace detail {
 
         safe_handle() noexcept : process_id(::getpid()) {}
 
+        explicit safe_handle(pid_t pid) noexcept : process_id(pid) {}
+
         safe_handle(pid_t pid, std::error_code&) noexcept : process_id(pid) {}
 
         pid_t get() const noexcept { return process_id; }
@@ -0,0 +1,61 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_UNIQUE_FD_HPP
+#define REMOTE_MEMORY_LINUX_UNIQUE_FD_HPP
+
+#include <unistd.h>
+#include <utility>
+
+namespace remote { namespace detail {
+
+    /// \brief Owning wrapper around a file descriptor.
+    class unique_fd {
+        int _fd = -1;
+
+    public:
+        unique_fd() noexcept = default;
+
+        explicit unique_fd(int fd) noexcept : _fd(fd) {}
+
+        unique_fd(unique_fd&& other) noexcept : _fd(other.release()) {}
+
+        unique_fd& operator=(unique_fd&& other) noexcept
+        {
+            reset(other.release());
+            return *this;
+        }
+
+        ~unique_fd() { reset(); }
+
+        void reset(int fd = -1) noexcept
+        {
+            if (_fd >= 0)
+                ::close(_fd);
+
+            _fd = fd;
+        }
+
+        int release() noexcept { return std::exchange(_fd, -1); }
+
+        int get() const noexcept { return _fd; }
+
+        explicit operator bool() const noexcept { return _fd >= 0; }
+    };
+
+}} // namespace remote::detail
+
+#endif // include guard
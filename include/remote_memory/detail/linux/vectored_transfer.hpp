@@ -0,0 +1,98 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_LINUX_VECTORED_TRANSFER_HPP
+#define REMOTE_MEMORY_LINUX_VECTORED_TRANSFER_HPP
+
+#include "../error.hpp"
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#include <cstddef>
+
+namespace remote { namespace detail {
+
+#if defined(IOV_MAX)
+    constexpr std::size_t max_iovecs = IOV_MAX;
+#else
+    constexpr std::size_t max_iovecs = 1024;
+#endif
+
+    /// \brief Splits the requests into groups of up to max_iovecs entries and hands each group to transfer.
+    ///        process_vm_readv / process_vm_writev stop at the first remote iovec they fail to access,
+    ///        so after a short transfer the failing request is skipped and the rest are retried.
+    /// \param transfer Callable with signature ssize_t(const iovec* local, const iovec* remote, unsigned long count).
+    /// \return The number of requests that were transferred completely.
+    template<class Request, class Transfer>
+    inline std::size_t vectored_transfer(Request* requests, std::size_t count, Transfer transfer
+                                         , std::error_code& ec) noexcept
+    {
+        ::iovec local[max_iovecs];
+        ::iovec target[max_iovecs];
+
+        std::size_t succeeded = 0;
+        std::size_t first     = 0;
+        while (first < count) {
+            std::size_t n = 0;
+            for (; n < max_iovecs && first + n < count; ++n) {
+                auto& request = requests[first + n];
+                request.transferred = 0;
+                local[n]  = {const_cast<void*>(static_cast<const void*>(request.buffer)), request.size};
+                target[n] = {reinterpret_cast<void*>(request.address), request.size};
+            }
+
+            const auto result = transfer(local, target, static_cast<unsigned long>(n));
+            if (result == -1) {
+                // nothing could be transferred from the first remote iovec - fail only that request
+                if (errno == EFAULT) {
+                    // empty requests can't fault so the first non empty one is to blame
+                    for (; first < count && requests[first].size == 0; ++first)
+                        ++succeeded;
+
+                    ++first;
+                    continue;
+                }
+
+                ec = get_last_error();
+                for (auto i = first + n; i < count; ++i)
+                    requests[i].transferred = 0;
+                return succeeded;
+            }
+
+            auto left = static_cast<std::size_t>(result);
+            std::size_t i = 0;
+            for (; i < n; ++i) {
+                auto& request = requests[first + i];
+                if (left < request.size) {
+                    request.transferred = left;
+                    break;
+                }
+
+                request.transferred = request.size;
+                left -= request.size;
+                ++succeeded;
+            }
+
+            // skip over the request that stopped the transfer
+            first += (i == n) ? n : i + 1;
+        }
+
+        return succeeded;
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
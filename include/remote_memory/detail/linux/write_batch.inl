@@ -0,0 +1,46 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WRITE_BATCH_INL
+#define REMOTE_MEMORY_WRITE_BATCH_INL
+
+#include "../../write_batch.hpp"
+#include "vectored_transfer.hpp"
+
+namespace remote {
+
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count)
+    {
+        std::error_code ec;
+        const auto succeeded = write_batch(handle, requests, count, ec);
+        if (ec)
+            throw std::system_error(ec, "process_vm_writev() failed");
+
+        return succeeded;
+    }
+
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count
+                                   , std::error_code& ec) noexcept
+    {
+        return detail::vectored_transfer(requests, count, [handle](const ::iovec* local, const ::iovec* target
+                                                                    , unsigned long n) {
+            return ::process_vm_writev(handle, local, n, target, n, 0);
+        }, ec);
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,162 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_PATTERN_KERNELS_HPP
+#define REMOTE_MEMORY_PATTERN_KERNELS_HPP
+
+#include "simd.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace remote { namespace detail {
+
+    /// \brief A parsed pattern. bytes are pre-masked so a position matches if
+    ///        (data[i] & mask[i]) == bytes[i] for every i.
+    ///        first and last are the indices of the first and last non wildcard bytes.
+    struct pattern_view {
+        const std::uint8_t* bytes;
+        const std::uint8_t* mask;
+        std::size_t         size;
+        std::size_t         first;
+        std::size_t         last;
+        bool                wildcards_only;
+    };
+
+    inline bool pattern_matches(const std::uint8_t* data, const pattern_view& p) noexcept
+    {
+        for (std::size_t i = 0; i < p.size; ++i)
+            if ((data[i] & p.mask[i]) != p.bytes[i])
+                return false;
+
+        return true;
+    }
+
+    // every kernel calls callback(offset) for each match starting at or after from and stops
+    // once it returns false. The kernels return false if they were stopped.
+
+    template<class Callback>
+    inline bool find_pattern_scalar(const std::uint8_t* data, std::size_t size, const pattern_view& p
+                                    , std::size_t from, Callback& callback)
+    {
+        if (size < p.size)
+            return true;
+
+        const auto positions = size - p.size + 1;
+        if (p.wildcards_only) {
+            for (auto pos = from; pos < positions; ++pos)
+                if (!callback(pos))
+                    return false;
+
+            return true;
+        }
+
+        // memchr is vectorized by every libc worth using, so the scalar kernel leans on it for the anchor
+        for (auto pos = from; pos < positions; ++pos) {
+            const auto hit = static_cast<const std::uint8_t*>(std::memchr(data + pos + p.first
+                                                                         , p.bytes[p.first]
+                                                                         , positions - pos));
+            if (!hit)
+                break;
+
+            pos = static_cast<std::size_t>(hit - data) - p.first;
+            if (data[pos + p.last] == p.bytes[p.last] && pattern_matches(data + pos, p) && !callback(pos))
+                return false;
+        }
+
+        return true;
+    }
+
+#if defined(REMOTE_MEMORY_X86_SIMD)
+
+    // both kernels compare the first and last anchor bytes of a whole vector of positions at once
+    // and only fully verify the positions where both matched
+
+    template<class Callback>
+    REMOTE_MEMORY_TARGET_SSE2
+    inline bool find_pattern_sse2(const std::uint8_t* data, std::size_t size, const pattern_view& p
+                                  , Callback& callback)
+    {
+        if (size < p.size || p.wildcards_only)
+            return find_pattern_scalar(data, size, p, 0, callback);
+
+        const auto    positions = size - p.size + 1;
+        const __m128i first     = _mm_set1_epi8(static_cast<char>(p.bytes[p.first]));
+        const __m128i last      = _mm_set1_epi8(static_cast<char>(p.bytes[p.last]));
+
+        std::size_t pos = 0;
+        for (; pos + 16 <= positions; pos += 16) {
+            const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + p.first));
+            const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + p.last));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first)
+                                                                              , _mm_cmpeq_epi8(b, last))));
+            for (; mask; mask &= mask - 1) {
+                const auto offset = pos + lowest_bit(mask);
+                if (pattern_matches(data + offset, p) && !callback(offset))
+                    return false;
+            }
+        }
+
+        return find_pattern_scalar(data, size, p, pos, callback);
+    }
+
+    template<class Callback>
+    REMOTE_MEMORY_TARGET_AVX2
+    inline bool find_pattern_avx2(const std::uint8_t* data, std::size_t size, const pattern_view& p
+                                  , Callback& callback)
+    {
+        if (size < p.size || p.wildcards_only)
+            return find_pattern_scalar(data, size, p, 0, callback);
+
+        const auto    positions = size - p.size + 1;
+        const __m256i first     = _mm256_set1_epi8(static_cast<char>(p.bytes[p.first]));
+        const __m256i last      = _mm256_set1_epi8(static_cast<char>(p.bytes[p.last]));
+
+        std::size_t pos = 0;
+        for (; pos + 32 <= positions; pos += 32) {
+            const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + p.first));
+            const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + p.last));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first)
+                                                                                    , _mm256_cmpeq_epi8(b, last))));
+            for (; mask; mask &= mask - 1) {
+                const auto offset = pos + lowest_bit(mask);
+                if (pattern_matches(data + offset, p) && !callback(offset))
+                    return false;
+            }
+        }
+
+        return find_pattern_scalar(data, size, p, pos, callback);
+    }
+
+#endif
+
+    /// \brief Finds every occurrence of the pattern in [data; data + size] with the best kernel the cpu supports.
+    template<class Callback>
+    inline bool find_pattern(const std::uint8_t* data, std::size_t size, const pattern_view& p, Callback& callback)
+    {
+#if defined(REMOTE_MEMORY_X86_SIMD)
+        switch (detected_simd_level()) {
+        case simd_level::avx2: return find_pattern_avx2(data, size, p, callback);
+        case simd_level::sse2: return find_pattern_sse2(data, size, p, callback);
+        default: break;
+        }
+#endif
+        return find_pattern_scalar(data, size, p, 0, callback);
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
@@ -0,0 +1,81 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_SIMD_HPP
+#define REMOTE_MEMORY_SIMD_HPP
+
+// vector kernels are compiled with function level target attributes and selected at runtime,
+// so the library itself does not need to be built with -mavx2.
+#if !defined(REMOTE_MEMORY_DISABLE_SIMD) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__GNUC__) || defined(__clang__))
+    #define REMOTE_MEMORY_X86_SIMD
+    #include <immintrin.h>
+    #define REMOTE_MEMORY_TARGET_SSE2 __attribute__((target("sse2")))
+    #define REMOTE_MEMORY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#include <cstdint>
+
+namespace remote { namespace detail {
+
+    enum class simd_level { scalar, sse2, avx2 };
+
+    /// \brief The best instruction set supported by the cpu the program is running on.
+    inline simd_level detected_simd_level() noexcept
+    {
+#if defined(REMOTE_MEMORY_X86_SIMD)
+        static const simd_level level = __builtin_cpu_supports("avx2")
+                                        ? simd_level::avx2
+                                        : __builtin_cpu_supports("sse2") ? simd_level::sse2 : simd_level::scalar;
+        return level;
+#else
+        return simd_level::scalar;
+#endif
+    }
+
+    /// \brief Index of the lowest set bit. mask must not be 0.
+    inline unsigned lowest_bit(unsigned mask) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned index = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /// \brief Index of the lowest set bit. mask must not be 0.
+    inline unsigned lowest_bit(std::uint64_t mask) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+        unsigned index = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+}} // namespace remote::detail
+
+#endif // include guard
@@ -0,0 +1,101 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_SPSC_RING_HPP
+#define REMOTE_MEMORY_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace remote { namespace detail {
+
+    /// \brief Bounded lock free queue with a single producer and a single consumer.
+    ///        The capacity is rounded up to a power of two.
+    template<class T>
+    class spsc_ring {
+        std::unique_ptr<T[]> _slots;
+        std::size_t          _mask;
+
+        // the producer and the consumer each own one index, kept on separate cache lines
+        char                     _padding0[64];
+        std::atomic<std::size_t> _tail{0};
+        std::size_t              _cached_head = 0;
+        char                     _padding1[64];
+        std::atomic<std::size_t> _head{0};
+        std::size_t              _cached_tail = 0;
+        char                     _padding2[64];
+
+        static std::size_t round_up(std::size_t capacity) noexcept
+        {
+            std::size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+            return size;
+        }
+
+    public:
+        explicit spsc_ring(std::size_t capacity)
+                : _slots(new T[round_up(capacity)]), _mask(round_up(capacity) - 1)
+        {}
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        std::size_t capacity() const noexcept { return _mask + 1; }
+
+        /// \brief Called by the producer. Returns false if the ring is full.
+        template<class U>
+        bool try_push(U&& value)
+        {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _cached_head > _mask) {
+                _cached_head = _head.load(std::memory_order_acquire);
+                if (tail - _cached_head > _mask)
+                    return false;
+            }
+
+            _slots[tail & _mask] = std::forward<U>(value);
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// \brief Called by the consumer. Returns false if the ring is empty.
+        bool try_pop(T& value)
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            if (head == _cached_tail) {
+                _cached_tail = _tail.load(std::memory_order_acquire);
+                if (head == _cached_tail)
+                    return false;
+            }
+
+            value = std::move(_slots[head & _mask]);
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// \brief Whether the ring is empty. Exact only when called by the consumer.
+        bool empty() const noexcept
+        {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+        }
+    };
+
+}} // namespace remote::detail
+
+#endif // include guard
@@ -19,6 +19,9 @@
 
 #include <stdexcept>
 #include <limits>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 namespace jm { namespace detail {
 
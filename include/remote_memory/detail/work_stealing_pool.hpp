@@ -0,0 +1,177 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WORK_STEALING_POOL_HPP
+#define REMOTE_MEMORY_WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace remote { namespace detail {
+
+    /// \brief A fixed set of threads that run batches of indexed tasks.
+    ///        Every worker starts with a contiguous slice of the tasks and takes them from the front of its
+    ///        own queue. Once it runs dry it steals from the back of the other queues.
+    /// \note run() must not be called concurrently.
+    class work_stealing_pool {
+        struct queue {
+            std::mutex              lock;
+            std::deque<std::size_t> tasks;
+            // keep the queues of different workers on different cache lines
+            char                    padding[64];
+        };
+
+        std::vector<std::unique_ptr<queue>> _queues;
+        std::vector<std::thread>            _threads;
+
+        std::mutex                                    _lock;
+        std::condition_variable                       _start;
+        std::condition_variable                       _finished;
+        std::function<void(std::size_t, std::size_t)> _job;
+        std::exception_ptr                            _error;
+        std::uint64_t                                 _round = 0;
+        std::size_t                                   _busy  = 0;
+        bool                                          _stop  = false;
+
+        bool take(std::size_t worker, std::size_t& task)
+        {
+            {
+                auto&                       own = *_queues[worker];
+                std::lock_guard<std::mutex> lock(own.lock);
+                if (!own.tasks.empty()) {
+                    task = own.tasks.front();
+                    own.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            for (std::size_t i = 1; i < _queues.size(); ++i) {
+                auto&                       victim = *_queues[(worker + i) % _queues.size()];
+                std::lock_guard<std::mutex> lock(victim.lock);
+                if (!victim.tasks.empty()) {
+                    task = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void work(std::size_t worker)
+        {
+            std::uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _start.wait(lock, [&] { return _stop || _round != seen; });
+                    if (_stop)
+                        return;
+
+                    seen = _round;
+                }
+
+                std::size_t task;
+                while (take(worker, task)) {
+                    try {
+                        _job(worker, task);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(_lock);
+                        if (!_error)
+                            _error = std::current_exception();
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(_lock);
+                if (--_busy == 0)
+                    _finished.notify_all();
+            }
+        }
+
+    public:
+        /// \param threads The number of worker threads. 0 uses one per hardware thread.
+        explicit work_stealing_pool(std::size_t threads = 0)
+        {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            for (std::size_t i = 0; i < threads; ++i)
+                _queues.emplace_back(new queue);
+
+            for (std::size_t i = 0; i < threads; ++i)
+                _threads.emplace_back([this, i] { work(i); });
+        }
+
+        ~work_stealing_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _stop = true;
+            }
+
+            _start.notify_all();
+            for (auto& thread : _threads)
+                thread.join();
+        }
+
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+        std::size_t size() const noexcept { return _threads.size(); }
+
+        /// \brief Calls job(worker_index, task_index) for every task in [0; count) and waits for all of them.
+        /// \throw Rethrows the first exception thrown by a task once every task has finished.
+        template<class Job>
+        void run(std::size_t count, Job job)
+        {
+            const auto workers = _queues.size();
+            for (std::size_t w = 0; w < workers; ++w) {
+                std::lock_guard<std::mutex> lock(_queues[w]->lock);
+                for (auto task = count * w / workers; task < count * (w + 1) / workers; ++task)
+                    _queues[w]->tasks.push_back(task);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _job   = std::move(job);
+                _error = nullptr;
+                _busy  = workers;
+                ++_round;
+            }
+
+            _start.notify_all();
+
+            std::unique_lock<std::mutex> lock(_lock);
+            _finished.wait(lock, [&] { return _busy == 0; });
+            _job = nullptr;
+            if (_error)
+                std::rethrow_exception(std::exchange(_error, nullptr));
+        }
+    };
+
+}} // namespace remote::detail
+
+#endif // include guard
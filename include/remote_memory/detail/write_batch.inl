@@ -0,0 +1,52 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WRITE_BATCH_INL
+#define REMOTE_MEMORY_WRITE_BATCH_INL
+
+#include "../write_batch.hpp"
+#include "../write_memory.hpp"
+
+namespace remote {
+
+    // windows and osx have no vectored write so every request is a separate call
+
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count)
+    {
+        std::error_code ec;
+        return write_batch(handle, requests, count, ec);
+    }
+
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count
+                                   , std::error_code&) noexcept
+    {
+        std::size_t succeeded = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto&           request = requests[i];
+            std::error_code request_ec;
+            write_memory(handle, request.address, static_cast<const unsigned char*>(request.buffer), request.size
+                         , request_ec);
+            request.transferred = request_ec ? 0 : request.size;
+            if (!request_ec)
+                ++succeeded;
+        }
+
+        return succeeded;
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,577 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_DUMP_HPP
+#define REMOTE_MEMORY_DUMP_HPP
+
+#if !defined(__linux__)
+    #error dump_regions is only available on linux
+#endif
+
+#include "read_batch.hpp"
+#include "detail/error.hpp"
+#include "detail/linux/unique_fd.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// the size of each of the two buffers used while dumping
+#ifndef REMOTE_MEMORY_DUMP_CHUNK_SIZE
+    #define REMOTE_MEMORY_DUMP_CHUNK_SIZE (16 * 1024 * 1024)
+#endif
+
+// the amount of the output file mapped at once by zero copy dumps
+#ifndef REMOTE_MEMORY_DUMP_MAP_SIZE
+    #define REMOTE_MEMORY_DUMP_MAP_SIZE (64 * 1024 * 1024)
+#endif
+
+namespace remote {
+
+    /// \brief The first bytes of a dump file. Every field is stored in native byte order.
+    ///
+    ///        The file starts with this header, followed by the data of every region at page aligned offsets.
+    ///        The index, entry_count dump_index_entry records, and the string table holding the region paths
+    ///        follow the data.
+    struct dump_header {
+        char          magic[8];
+        std::uint32_t version;
+        std::uint32_t entry_count;
+        std::uint64_t index_offset;
+        std::uint64_t strings_offset;
+        std::uint64_t strings_size;
+    };
+
+    /// \brief A captured run of memory. Unreadable pages split a region into multiple entries.
+    struct dump_index_entry {
+        std::uint64_t address;
+        std::uint64_t size;
+        std::uint64_t file_offset;
+        std::uint32_t path_offset;
+        std::uint32_t path_size;
+        std::uint8_t  permissions;
+        std::uint8_t  reserved[7];
+    };
+
+    constexpr char          dump_magic[8] = {'R', 'M', 'D', 'U', 'M', 'P', 0, 0};
+    constexpr std::uint32_t dump_version  = 1;
+
+    struct dump_options {
+        /// read straight into a shared mapping of the output file instead of buffers written by a second thread.
+        /// Page faults on the mapping cost about as much as the copy it saves, so run the dump benchmarks
+        /// before enabling it
+        bool        zero_copy  = false;
+        /// the size of each of the two buffers
+        std::size_t chunk_size = REMOTE_MEMORY_DUMP_CHUNK_SIZE;
+        /// the amount of the file mapped at once by zero copy dumps
+        std::size_t map_size   = REMOTE_MEMORY_DUMP_MAP_SIZE;
+    };
+
+    struct dump_result {
+        std::size_t   entries    = 0;
+        std::uint64_t bytes      = 0;
+        std::uint64_t unreadable = 0;
+        /// whether the data was read straight into the file
+        bool          zero_copy  = false;
+    };
+
+    /// \brief An entry of a dump file as returned by read_dump_index.
+    struct dump_entry {
+        std::uintptr_t address;
+        std::size_t    size;
+        std::uint64_t  file_offset;
+        std::uint8_t   permissions;
+        std::string    path;
+    };
+
+    namespace detail {
+
+        constexpr std::size_t dump_page_size = 4096;
+
+        inline std::uint64_t dump_align(std::uint64_t value) noexcept
+        {
+            return (value + dump_page_size - 1) & ~std::uint64_t{dump_page_size - 1};
+        }
+
+        inline bool write_all(int fd, const void* data, std::size_t size, std::uint64_t offset
+                              , std::error_code& ec) noexcept
+        {
+            auto bytes = static_cast<const std::uint8_t*>(data);
+            while (size) {
+                const auto result = ::pwrite(fd, bytes, size, static_cast<::off_t>(offset));
+                if (result < 0) {
+                    if (errno == EINTR)
+                        continue;
+
+                    ec = get_last_error();
+                    return false;
+                }
+
+                bytes += result;
+                size -= static_cast<std::size_t>(result);
+                offset += static_cast<std::uint64_t>(result);
+            }
+
+            return true;
+        }
+
+        inline bool read_all(int fd, void* data, std::size_t size, std::uint64_t offset, std::error_code& ec) noexcept
+        {
+            auto bytes = static_cast<std::uint8_t*>(data);
+            while (size) {
+                const auto result = ::pread(fd, bytes, size, static_cast<::off_t>(offset));
+                if (result < 0 && errno == EINTR)
+                    continue;
+                if (result <= 0) {
+                    ec = result < 0 ? get_last_error() : std::make_error_code(std::errc::invalid_argument);
+                    return false;
+                }
+
+                bytes += result;
+                size -= static_cast<std::size_t>(result);
+                offset += static_cast<std::uint64_t>(result);
+            }
+
+            return true;
+        }
+
+        class mapped_window {
+            void*       _address = MAP_FAILED;
+            std::size_t _size    = 0;
+
+        public:
+            mapped_window(int fd, std::uint64_t offset, std::size_t size) noexcept
+                    : _address(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd
+                                      , static_cast<::off_t>(offset)))
+                    , _size(size)
+            {}
+
+            ~mapped_window()
+            {
+                if (_address != MAP_FAILED)
+                    ::munmap(_address, _size);
+            }
+
+            mapped_window(const mapped_window&) = delete;
+            mapped_window& operator=(const mapped_window&) = delete;
+
+            std::uint8_t* data() const noexcept { return static_cast<std::uint8_t*>(_address); }
+
+            explicit operator bool() const noexcept { return _address != MAP_FAILED; }
+        };
+
+        /// \brief Hands filled buffers to a thread that writes them to the file while the next one is read.
+        class dump_write_behind {
+            struct slot {
+                std::vector<std::uint8_t> data;
+                std::uint64_t             offset = 0;
+                std::size_t               size   = 0;
+                bool                      full   = false;
+            };
+
+            int                     _fd;
+            slot                    _slots[2];
+            std::size_t             _current = 0;
+            std::mutex              _lock;
+            std::condition_variable _changed;
+            std::error_code         _error;
+            bool                    _done = false;
+            std::thread             _thread;
+
+            void work()
+            {
+                for (;;) {
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _changed.wait(lock, [&] { return _slots[0].full || _slots[1].full || _done; });
+                    if (!_slots[0].full && !_slots[1].full)
+                        return;
+
+                    // empty submissions leave a slot free, so the slots are not always filled in turn
+                    auto& s = _slots[0].full ? _slots[0] : _slots[1];
+
+                    lock.unlock();
+                    std::error_code ec;
+                    write_all(_fd, s.data.data(), s.size, s.offset, ec);
+                    lock.lock();
+
+                    s.full = false;
+                    if (ec && !_error)
+                        _error = ec;
+
+                    _changed.notify_all();
+                }
+            }
+
+        public:
+            dump_write_behind(int fd, std::size_t chunk_size) : _fd(fd)
+            {
+                _slots[0].data.resize(chunk_size);
+                _slots[1].data.resize(chunk_size);
+                _thread = std::thread([this] { work(); });
+            }
+
+            ~dump_write_behind()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_lock);
+                    _done = true;
+                }
+                _changed.notify_all();
+                _thread.join();
+            }
+
+            /// \brief Waits until the next buffer was written out and returns it.
+            std::uint8_t* acquire(std::error_code& ec)
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _changed.wait(lock, [&] { return !_slots[_current].full; });
+                ec = _error;
+                return _slots[_current].data.data();
+            }
+
+            /// \brief Queues size bytes of the buffer returned by acquire to be written at offset.
+            void submit(std::uint64_t offset, std::size_t size)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_lock);
+                    auto&                       s = _slots[_current];
+                    s.offset                      = offset;
+                    s.size                        = size;
+                    s.full                        = size != 0;
+                }
+                _changed.notify_all();
+                _current ^= 1;
+            }
+
+            /// \brief Waits for every queued buffer to be written.
+            std::error_code finish()
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _changed.wait(lock, [&] { return !_slots[0].full && !_slots[1].full; });
+                return _error;
+            }
+        };
+
+        class dump_writer {
+            int                                            _fd;
+            dump_options                                   _options;
+            dump_result                                    _result;
+            std::vector<dump_index_entry>                  _entries;
+            std::string                                    _strings;
+            std::unordered_map<std::string, std::uint32_t> _paths;
+            bool                                           _extend = false;
+
+            std::uint32_t intern(const char* path)
+            {
+                const std::string p = path ? path : "";
+                const auto        it = _paths.find(p);
+                if (it != _paths.end())
+                    return it->second;
+
+                const auto offset = static_cast<std::uint32_t>(_strings.size());
+                _strings += p;
+                _paths.emplace(p, offset);
+                return offset;
+            }
+
+            template<class Region>
+            void record(const Region& r, std::uintptr_t address, std::size_t size, std::uint64_t file_offset)
+            {
+                _result.bytes += size;
+                if (size == 0)
+                    return;
+
+                if (_extend) {
+                    _entries.back().size += size;
+                    return;
+                }
+
+                dump_index_entry entry{};
+                entry.address     = address;
+                entry.size        = size;
+                entry.file_offset = file_offset;
+                entry.path_offset = intern(r.path);
+                entry.path_size   = static_cast<std::uint32_t>(r.path ? std::strlen(r.path) : 0);
+                entry.permissions = r.permissions;
+                _entries.push_back(entry);
+                _extend = true;
+            }
+
+            // reads [address; end) into destination, skipping pages that can not be read.
+            // on_data(offset, size) is called for every readable run relative to address
+            template<class Memory, class Region, class OnData>
+            void read_window(const Memory& memory, const Region& r, std::uintptr_t address, std::uintptr_t end
+                             , std::uint8_t* destination, std::uint64_t file_offset, OnData on_data)
+            {
+                for (auto current = address; current < end;) {
+                    read_request request(current, destination + (current - address)
+                                         , static_cast<std::size_t>(end - current));
+                    memory.read_many(&request, 1);
+
+                    record(r, current, request.transferred, file_offset + (current - address));
+                    on_data(current - address, request.transferred);
+                    if (request.succeeded())
+                        return;
+
+                    const auto unreadable = current + request.transferred;
+                    current = std::min<std::uintptr_t>(end, (unreadable + dump_page_size)
+                                                            & ~std::uintptr_t{dump_page_size - 1});
+                    _result.unreadable += current - unreadable;
+                    _extend = false;
+                }
+            }
+
+        public:
+            dump_writer(int fd, const dump_options& options) noexcept : _fd(fd), _options(options)
+            {
+                _options.chunk_size = std::max<std::size_t>(dump_align(_options.chunk_size), dump_page_size);
+                _options.map_size   = std::max<std::size_t>(dump_align(_options.map_size), dump_page_size);
+            }
+
+            /// \brief Reads the region straight into a shared mapping of the file.
+            /// \return The address at which mapping the file failed or the end of the region.
+            template<class Memory, class Region>
+            std::uintptr_t mapped(const Memory& memory, const Region& r, std::uint64_t file_offset)
+            {
+                _extend = false;
+                for (auto address = r.begin; address < r.end;) {
+                    const auto head   = address & (dump_page_size - 1);
+                    const auto window = static_cast<std::size_t>(std::min<std::uintptr_t>(_options.map_size - head
+                                                                                           , r.end - address));
+                    const auto offset = file_offset + (address - r.begin);
+                    mapped_window map(_fd, offset - head, window + head);
+                    if (!map)
+                        return address;
+
+                    read_window(memory, r, address, address + window, map.data() + head, offset
+                                , [](std::size_t, std::size_t) {});
+                    address += window;
+                }
+
+                return r.end;
+            }
+
+            /// \brief Reads the region from address onwards into buffers that are written out by a second thread.
+            template<class Memory, class Region>
+            void buffered(const Memory& memory, const Region& r, std::uintptr_t address, std::uint64_t file_offset
+                          , dump_write_behind& out, std::error_code& ec)
+            {
+                _extend = false;
+                while (address < r.end && !ec) {
+                    const auto window = static_cast<std::size_t>(std::min<std::uintptr_t>(_options.chunk_size
+                                                                                           , r.end - address));
+                    const auto offset = file_offset + (address - r.begin);
+                    auto       buffer = out.acquire(ec);
+                    if (ec)
+                        return;
+
+                    // runs are written separately so unreadable pages stay holes in the file
+                    std::size_t pending_begin = 0, pending_size = 0;
+                    read_window(memory, r, address, address + window, buffer, offset
+                                , [&](std::size_t run, std::size_t size) {
+                                    if (size == 0)
+                                        return;
+                                    if (pending_size && pending_begin + pending_size != run) {
+                                        write_all(_fd, buffer + pending_begin, pending_size
+                                                  , offset + pending_begin, ec);
+                                        pending_size = 0;
+                                    }
+                                    if (!pending_size)
+                                        pending_begin = run;
+                                    pending_size += size;
+                                });
+
+                    // the last run is usually the whole window and is written behind
+                    if (pending_begin != 0)
+                        std::memmove(buffer, buffer + pending_begin, pending_size);
+
+                    out.submit(offset + pending_begin, pending_size);
+                    address += window;
+                }
+            }
+
+            /// \brief Writes the index and the header. The data must end at data_end.
+            bool finish(std::uint64_t data_end, std::error_code& ec)
+            {
+                dump_header header{};
+                std::memcpy(header.magic, dump_magic, sizeof(header.magic));
+                header.version        = dump_version;
+                header.entry_count    = static_cast<std::uint32_t>(_entries.size());
+                header.index_offset   = (data_end + 7) & ~std::uint64_t{7};
+                header.strings_offset = header.index_offset + _entries.size() * sizeof(dump_index_entry);
+                header.strings_size   = _strings.size();
+
+                _result.entries = _entries.size();
+                return write_all(_fd, _entries.data(), _entries.size() * sizeof(dump_index_entry), header.index_offset
+                                 , ec)
+                       && write_all(_fd, _strings.data(), _strings.size(), header.strings_offset, ec)
+                       && write_all(_fd, &header, sizeof(header), 0, ec);
+            }
+
+            dump_result& result() noexcept { return _result; }
+        };
+
+    } // namespace detail
+
+    /// \brief Writes the memory of the regions to a file at path. Refer to dump_header for the format.
+    ///        The data is read into one of two buffers while a second thread writes the other one out.
+    ///        With zero_copy enabled the data is instead read straight into a shared mapping of the file,
+    ///        falling back to the buffers if the file can not be mapped.
+    ///        Pages that can not be read are skipped and left as holes in the file.
+    /// \param regions Range of objects with begin, end, permissions and path members, such as region_map::filter(...).
+    /// \param ec The error code that will be set if the file could not be created or written.
+    /// \throw Throws if the underlying read_many throws, for example if the process no longer exists.
+    template<class Memory, class Regions>
+    inline dump_result dump_regions(const Memory& memory, const Regions& regions, const char* path
+                                    , const dump_options& options, std::error_code& ec)
+    {
+        detail::unique_fd fd(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (!fd) {
+            ec = detail::get_last_error();
+            return {};
+        }
+
+        // every region starts on a page aligned offset that shares the page offset of its address
+        std::uint64_t data_end = 0;
+        for (const auto& r : regions)
+            data_end = detail::dump_align(data_end ? data_end : sizeof(dump_header))
+                       + (r.begin & (detail::dump_page_size - 1)) + (r.end - r.begin);
+
+        data_end = std::max<std::uint64_t>(data_end, sizeof(dump_header));
+        if (::ftruncate(fd.get(), static_cast<::off_t>(data_end)) == -1) {
+            ec = detail::get_last_error();
+            return {};
+        }
+
+        detail::dump_writer writer(fd.get(), options);
+        auto                zero_copy = options.zero_copy;
+        std::unique_ptr<detail::dump_write_behind> write_behind;
+
+        std::uint64_t cursor = 0;
+        for (const auto& r : regions) {
+            cursor = detail::dump_align(cursor ? cursor : sizeof(dump_header))
+                     + (r.begin & (detail::dump_page_size - 1));
+            const auto file_offset = cursor;
+            cursor += r.end - r.begin;
+
+            auto address = r.begin;
+            if (zero_copy) {
+                address = writer.mapped(memory, r, file_offset);
+                if (address == r.end)
+                    continue;
+            }
+
+            zero_copy = false;
+            if (!write_behind)
+                write_behind.reset(new detail::dump_write_behind(fd.get(), std::max<std::size_t>(
+                        detail::dump_align(options.chunk_size), detail::dump_page_size)));
+
+            writer.buffered(memory, r, address, file_offset, *write_behind, ec);
+            if (ec)
+                return {};
+        }
+
+        if (write_behind) {
+            ec = write_behind->finish();
+            write_behind.reset();
+            if (ec)
+                return {};
+        }
+
+        if (!writer.finish(data_end, ec))
+            return {};
+
+        writer.result().zero_copy = zero_copy;
+        return writer.result();
+    }
+
+    /// \brief Refer to dump_regions.
+    /// \throw Throws an std::system_error if the file could not be created or written.
+    template<class Memory, class Regions>
+    inline dump_result dump_regions(const Memory& memory, const Regions& regions, const char* path
+                                    , const dump_options& options = dump_options{})
+    {
+        std::error_code ec;
+        auto            result = dump_regions(memory, regions, path, options, ec);
+        if (ec)
+            throw std::system_error(ec, "dump_regions() failed");
+
+        return result;
+    }
+
+    /// \brief Reads the index of a file written by dump_regions.
+    /// \param ec The error code that will be set if the file can not be read or is not a dump.
+    inline std::vector<dump_entry> read_dump_index(const char* path, std::error_code& ec)
+    {
+        std::vector<dump_entry> entries;
+        detail::unique_fd       fd(::open(path, O_RDONLY | O_CLOEXEC));
+        if (!fd) {
+            ec = detail::get_last_error();
+            return entries;
+        }
+
+        dump_header header;
+        if (!detail::read_all(fd.get(), &header, sizeof(header), 0, ec))
+            return entries;
+
+        if (std::memcmp(header.magic, dump_magic, sizeof(header.magic)) != 0 || header.version != dump_version) {
+            ec = std::make_error_code(std::errc::invalid_argument);
+            return entries;
+        }
+
+        std::vector<dump_index_entry> index(header.entry_count);
+        std::string                   strings(header.strings_size, '\0');
+        if (!detail::read_all(fd.get(), index.data(), index.size() * sizeof(dump_index_entry), header.index_offset
+                              , ec)
+            || !detail::read_all(fd.get(), &strings[0], strings.size(), header.strings_offset, ec))
+            return entries;
+
+        for (const auto& e : index) {
+            if (std::uint64_t{e.path_offset} + e.path_size > strings.size()) {
+                ec = std::make_error_code(std::errc::invalid_argument);
+                return {};
+            }
+
+            entries.push_back({static_cast<std::uintptr_t>(e.address), static_cast<std::size_t>(e.size), e.file_offset
+                               , e.permissions, strings.substr(e.path_offset, e.path_size)});
+        }
+
+        return entries;
+    }
+
+    /// \brief Refer to read_dump_index.
+    /// \throw Throws an std::system_error if the file can not be read or is not a dump.
+    inline std::vector<dump_entry> read_dump_index(const char* path)
+    {
+        std::error_code ec;
+        auto            entries = read_dump_index(path, ec);
+        if (ec)
+            throw std::system_error(ec, "read_dump_index() failed");
+
+        return entries;
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,255 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_FLEET_HPP
+#define REMOTE_MEMORY_FLEET_HPP
+
+#include "read_batch.hpp"
+#include "detail/work_stealing_pool.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+    #include "detail/windows/safe_handle.hpp"
+#elif defined(__APPLE__)
+    #include "detail/osx/safe_handle.hpp"
+#elif defined(__linux__)
+    #include "detail/linux/safe_handle.hpp"
+#endif
+
+namespace remote {
+
+    /// \brief A range read from every process of a fleet.
+    struct fleet_field {
+        std::uintptr_t address = 0;
+        std::size_t    size    = 0;
+
+        fleet_field() = default;
+
+        template<class Address>
+        fleet_field(Address address_, std::size_t size_) noexcept(!jm::detail::checked_pointers)
+                : address(jm::detail::pointer_cast<std::uintptr_t>(address_)), size(size_)
+        {}
+    };
+
+    /// \brief Describes a T at address.
+    template<class T, class Address>
+    inline fleet_field make_fleet_field(Address address) noexcept(!jm::detail::checked_pointers)
+    {
+        return fleet_field(address, sizeof(T));
+    }
+
+    /// \brief The fields read from every process by fleet::read.
+    ///        The values are stored column major: the values of a field for every process follow each other,
+    ///        so the value of field f for process p is at column(f) + p * field_size(f).
+    ///        Columns are aligned for any fundamental type.
+    class fleet_result {
+        std::vector<std::max_align_t> _data;
+        std::vector<std::size_t>      _columns;
+        std::vector<std::size_t>      _sizes;
+        std::vector<std::uint8_t>     _succeeded;
+        std::vector<std::error_code>  _errors;
+        std::size_t                   _processes = 0;
+
+        friend class fleet;
+
+        void reset(std::size_t processes, const fleet_field* fields, std::size_t count)
+        {
+            _processes = processes;
+            _columns.resize(count);
+            _sizes.resize(count);
+
+            // columns are counted in units of max_align_t
+            std::size_t offset = 0;
+            for (std::size_t f = 0; f < count; ++f) {
+                _columns[f] = offset;
+                _sizes[f]   = fields[f].size;
+                offset += (processes * fields[f].size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+            }
+
+            _data.resize(offset);
+            _succeeded.assign(processes * count, 0);
+            _errors.assign(processes, std::error_code{});
+        }
+
+    public:
+        std::size_t processes() const noexcept { return _processes; }
+        std::size_t fields() const noexcept { return _sizes.size(); }
+        std::size_t field_size(std::size_t field) const noexcept { return _sizes[field]; }
+
+        /// \brief The values of a field for every process.
+        const std::uint8_t* column(std::size_t field) const noexcept
+        {
+            return reinterpret_cast<const std::uint8_t*>(_data.data() + _columns[field]);
+        }
+
+        std::uint8_t* column(std::size_t field) noexcept
+        {
+            return reinterpret_cast<std::uint8_t*>(_data.data() + _columns[field]);
+        }
+
+        /// \brief The column of a field as an array of T.
+        template<class T>
+        const T* column_as(std::size_t field) const noexcept
+        {
+            return reinterpret_cast<const T*>(column(field));
+        }
+
+        const std::uint8_t* data(std::size_t process, std::size_t field) const noexcept
+        {
+            return column(field) + process * _sizes[field];
+        }
+
+        /// \brief Copies out the value of a field of a process.
+        template<class T>
+        T get(std::size_t process, std::size_t field) const noexcept
+        {
+            T value;
+            std::memcpy(&value, data(process, field), sizeof(T));
+            return value;
+        }
+
+        /// \brief Whether the whole field was read from the process. Failed fields hold unspecified bytes.
+        bool succeeded(std::size_t process, std::size_t field) const noexcept
+        {
+            return _succeeded[field * _processes + process] != 0;
+        }
+
+        /// \brief The error the read of the whole batch of a process failed with, for example if it exited.
+        const std::error_code& error(std::size_t process) const noexcept { return _errors[process]; }
+    };
+
+    /// \brief Reads the same fields from many processes at once.
+    ///        Every process gets its own handle and a single batched read of all fields per call.
+    ///        The processes are spread over a work stealing thread pool, a pool of one thread reads on the caller.
+    /// \code remote::fleet workers;
+    ///       for (auto pid : pids)
+    ///           workers.add(pid);
+    ///       const remote::fleet_field fields[] = {remote::make_fleet_field<int>(0x601040), {0x601100, 64}};
+    ///       auto result = workers.read(fields, 2);
+    ///       auto counts = result.column_as<int>(0); // counts[p] for every process p
+    class fleet {
+        struct member {
+            pid_t               pid;
+            std::uintptr_t      base;
+            detail::safe_handle handle;
+
+            member(pid_t pid_, std::uintptr_t base_) : pid(pid_), base(base_), handle(pid_) {}
+
+            member(pid_t pid_, std::uintptr_t base_, std::error_code& ec)
+                    : pid(pid_), base(base_), handle(pid_, ec)
+            {}
+        };
+
+        std::vector<std::unique_ptr<member>>   _members;
+        std::vector<std::vector<read_request>> _requests;
+        detail::work_stealing_pool             _pool;
+
+    public:
+        /// \param threads The number of threads the processes are read on. 0 uses one per hardware thread.
+        explicit fleet(std::size_t threads = 0) : _pool(threads) { _requests.resize(_pool.size()); }
+
+        /// \brief Adds a process to the fleet.
+        /// \param base Added to the address of every field read from this process,
+        ///        for example the load address of a module in processes that were started separately.
+        /// \return The index of the process in results.
+        /// \throw Throws an std::system_error if the process could not be opened.
+        std::size_t add(pid_t pid, std::uintptr_t base = 0)
+        {
+            _members.emplace_back(new member(pid, base));
+            return _members.size() - 1;
+        }
+
+        /// \param ec The error code that will be set if the process could not be opened. It is not added then.
+        std::size_t add(pid_t pid, std::uintptr_t base, std::error_code& ec)
+        {
+            std::unique_ptr<member> m(new member(pid, base, ec));
+            if (ec)
+                return size();
+
+            _members.push_back(std::move(m));
+            return _members.size() - 1;
+        }
+
+        /// \brief Removes a process. The indices of the processes after it move down by one.
+        void remove(std::size_t index) { _members.erase(_members.begin() + index); }
+
+        void clear() noexcept { _members.clear(); }
+
+        std::size_t size() const noexcept { return _members.size(); }
+        bool empty() const noexcept { return _members.empty(); }
+        std::size_t threads() const noexcept { return _pool.size(); }
+
+        pid_t pid(std::size_t index) const noexcept { return _members[index]->pid; }
+
+        /// \brief Reads every field from every process into result, reusing its storage.
+        ///        A process failing does not affect the others, its error and failed fields are set in result.
+        /// \note Must not be called concurrently.
+        /// \throw Rethrows exceptions thrown by allocations on the pool threads.
+        void read(const fleet_field* fields, std::size_t count, fleet_result& result)
+        {
+            result.reset(_members.size(), fields, count);
+            if (_members.empty() || count == 0)
+                return;
+
+            const auto job = [&](std::size_t worker, std::size_t process) {
+                const auto& m        = *_members[process];
+                auto&       requests = _requests[worker];
+                requests.resize(count);
+                for (std::size_t f = 0; f < count; ++f)
+                    requests[f] = read_request(m.base + fields[f].address
+                                               , result.column(f) + process * fields[f].size, fields[f].size);
+
+                read_batch(m.handle.get(), requests.data(), count, result._errors[process]);
+                for (std::size_t f = 0; f < count; ++f)
+                    result._succeeded[f * _members.size() + process] = requests[f].succeeded();
+            };
+
+            // handing the reads to a single worker only adds the wake up of the worker
+            if (_pool.size() == 1 || _members.size() == 1)
+                for (std::size_t process = 0; process < _members.size(); ++process)
+                    job(0, process);
+            else
+                _pool.run(_members.size(), job);
+        }
+
+        /// \param fields A container of fleet_field with data and size members.
+        template<class Fields>
+        void read(const Fields& fields, fleet_result& result)
+        {
+            read(fields.data(), fields.size(), result);
+        }
+
+        fleet_result read(const fleet_field* fields, std::size_t count)
+        {
+            fleet_result result;
+            read(fields, count, result);
+            return result;
+        }
+
+        template<class Fields>
+        fleet_result read(const Fields& fields)
+        {
+            return read(fields.data(), fields.size());
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,394 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_MAPPED_OPERATIONS_POLICY_HPP
+#define REMOTE_MEMORY_MAPPED_OPERATIONS_POLICY_HPP
+
+#if !defined(__linux__)
+    #error mapped_operations_policy is only available on linux
+#endif
+
+#include "operations_policy.hpp"
+#include "region_map.hpp"
+#include "detail/linux/map_files.hpp"
+#include "detail/linux/unique_fd.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <system_error>
+#include <vector>
+
+namespace remote {
+
+    namespace detail {
+
+        /// \brief Lazily created local mappings of the regions of a region_map.
+        ///        A region is mapped the first time it is touched and stays mapped until the region map
+        ///        observes changed mappings.
+        class region_mappings {
+            enum class state : std::uint8_t { unknown, mapped, unmappable };
+
+            struct mapping {
+                void*       address  = nullptr;
+                std::size_t size     = 0;
+                state       status   = state::unknown;
+                bool        writable = false;
+                bool        shared   = false;
+            };
+
+            const region_map*                 _regions;
+            mutable std::shared_timed_mutex   _lock;
+            mutable std::vector<mapping>      _mappings;
+            mutable std::uint64_t             _generation    = 0;
+            bool                              _private_files = false;
+
+            void unmap(mapping& m) const noexcept
+            {
+                if (m.address)
+                    ::munmap(m.address, m.size);
+
+                m = mapping{};
+            }
+
+            unique_fd open_backing(const region& r, bool write) const noexcept
+            {
+                const auto flags = write ? O_RDWR : O_RDONLY;
+                const auto file  = r.path[0] == '/' && !std::strstr(r.path, " (deleted)");
+                return open_mapped_file(_regions->pid(), r.begin, r.end, r.inode
+                                        , makedev(r.device_major, r.device_minor), flags
+                                        , file ? std::initializer_list<const char*>{r.path}
+                                               : std::initializer_list<const char*>{});
+            }
+
+            void map(const region& r, mapping& m) const noexcept
+            {
+                m.status = state::unmappable;
+                if (!r.readable() || r.anonymous() || (!r.shared() && (!_private_files || r.writable())))
+                    return;
+
+                const auto write = r.shared() && r.writable();
+                auto       fd    = open_backing(r, write);
+                if (!fd && write)
+                    fd = open_backing(r, false);
+                if (!fd)
+                    return;
+
+                // touching a page past the end of the file raises SIGBUS instead of failing the read
+                struct stat info;
+                const auto  page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+                if (::fstat(fd.get(), &info) != 0
+                    || r.offset + r.size() > (static_cast<std::uint64_t>(info.st_size) + page - 1) / page * page)
+                    return;
+
+                const auto writable = write && (::fcntl(fd.get(), F_GETFL) & O_ACCMODE) == O_RDWR;
+                const auto address  = ::mmap(nullptr, r.size(), PROT_READ | (writable ? PROT_WRITE : 0)
+                                             , r.shared() ? MAP_SHARED : MAP_PRIVATE, fd.get()
+                                             , static_cast<::off_t>(r.offset));
+                if (address == MAP_FAILED)
+                    return;
+
+                m = {address, r.size(), state::mapped, writable, r.shared()};
+            }
+
+            // drops every mapping once the region map changed. Must be called with the exclusive lock held
+            void synchronize() const
+            {
+                if (_generation == _regions->generation() && _mappings.size() == _regions->size())
+                    return;
+
+                for (auto& m : _mappings)
+                    unmap(m);
+
+                _mappings.assign(_regions->size(), mapping{});
+                _generation = _regions->generation();
+            }
+
+            // transfer() without catching the failures of locking and of allocating the mapping table
+            template<class F>
+            bool locked_transfer(std::uintptr_t address, std::size_t size, bool write, F& f) const
+            {
+                const auto it = _regions->find(address);
+                if (it == _regions->end())
+                    return false;
+
+                const auto r     = *it;
+                const auto index = it.index();
+                if (size > r.end - address)
+                    return false;
+
+                for (;;) {
+                    {
+                        std::shared_lock<std::shared_timed_mutex> lock(_lock);
+                        if (_generation == _regions->generation() && index < _mappings.size()) {
+                            const auto& m = _mappings[index];
+                            if (m.status == state::unmappable || (m.status == state::mapped && write && !m.writable))
+                                return false;
+
+                            if (m.status == state::mapped) {
+                                f(static_cast<std::uint8_t*>(m.address) + (address - r.begin));
+                                return true;
+                            }
+                        }
+                    }
+
+                    std::lock_guard<std::shared_timed_mutex> lock(_lock);
+                    synchronize();
+                    auto& m = _mappings[index];
+                    if (m.status == state::unknown)
+                        map(r, m);
+
+                    // a private copy would no longer match the target once it was written to through another path
+                    if (write && m.status == state::mapped && !m.shared) {
+                        unmap(m);
+                        m.status = state::unmappable;
+                    }
+                }
+            }
+
+        public:
+            explicit region_mappings(const region_map& regions) noexcept : _regions(&regions) {}
+
+            ~region_mappings()
+            {
+                for (auto& m : _mappings)
+                    unmap(m);
+            }
+
+            region_mappings(const region_mappings&) = delete;
+            region_mappings& operator=(const region_mappings&) = delete;
+
+            const region_map& regions() const noexcept { return *_regions; }
+
+            bool private_files() const noexcept { return _private_files; }
+
+            void private_files(bool enable)
+            {
+                std::lock_guard<std::shared_timed_mutex> lock(_lock);
+                _private_files = enable;
+                for (auto& m : _mappings)
+                    unmap(m);
+            }
+
+            /// \brief Calls f(std::uint8_t* local) with the local copy of [address; address + size] while the
+            ///        mapping is guaranteed to stay alive.
+            /// \return false if the range is not inside of a single mappable region or the mapping could not be
+            ///         looked up, for example because memory ran out. f is not called then.
+            template<class F>
+            bool transfer(std::uintptr_t address, std::size_t size, bool write, F f) const noexcept
+            {
+                try {
+                    return locked_transfer(address, size, write, f);
+                }
+                catch (const std::bad_alloc&) {
+                    return false;
+                }
+                catch (const std::system_error&) {
+                    return false;
+                }
+            }
+
+        };
+
+    } // namespace detail
+
+    /// \brief Operations policy decorator that serves transfers of memory the target shares with a file or
+    ///        shared memory object with memcpy from a local mapping of the same object.
+    ///        Shared regions are mapped lazily through /proc/<pid>/map_files or their path on the first transfer
+    ///        touching them and every later transfer costs no system call. Writes to shared writable regions
+    ///        go through the mapping as well. Everything else, including anonymous private memory, is passed to
+    ///        the underlying policy.
+    ///
+    ///        Private file mappings such as code can optionally be mapped for reads too. They show the contents of
+    ///        the file and miss any page the target changed in its private copy, for example relocations or
+    ///        breakpoints, so this is off by default. A write through the policy to such a region stops it from
+    ///        being mapped.
+    /// \note The region map is not refreshed automatically - call region_map::refresh when the target
+    ///       may have changed its mappings. Every mapping is dropped once the map observes a change.
+    ///       A transfer of a mapped file that the target shrinks in the meantime raises SIGBUS.
+    template<class OperationsPolicy = operations_policy>
+    class mapped_operations_policy : public OperationsPolicy {
+        std::shared_ptr<detail::region_mappings> _mappings;
+
+        template<class Request>
+        struct scratch_t {
+            std::vector<Request>     requests;
+            std::vector<std::size_t> indices;
+        };
+
+        template<class Request>
+        static scratch_t<Request>& scratch()
+        {
+            thread_local scratch_t<Request> s;
+            return s;
+        }
+
+        // serves the mapped requests and passes the rest to the underlying policy in one batch
+        template<class Request, class Copy, class Transfer>
+        std::size_t mapped_many(Request* requests, std::size_t count, bool write, Copy copy, Transfer transfer) const
+        {
+            auto& rest = scratch<Request>();
+            rest.requests.clear();
+            rest.indices.clear();
+
+            std::size_t succeeded = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                auto& request = requests[i];
+                if (_mappings->transfer(request.address, request.size, write, [&](std::uint8_t* local) {
+                        copy(request, local);
+                    })) {
+                    request.transferred = request.size;
+                    ++succeeded;
+                }
+                else {
+                    rest.requests.push_back(request);
+                    rest.indices.push_back(i);
+                }
+            }
+
+            if (rest.requests.empty())
+                return succeeded;
+
+            succeeded += transfer(rest.requests.data(), rest.requests.size());
+            for (std::size_t i = 0; i < rest.indices.size(); ++i)
+                requests[rest.indices[i]].transferred = rest.requests[i].transferred;
+
+            return succeeded;
+        }
+
+        // the error_code overloads are noexcept. With room for every request reserved up front the batch
+        // itself can not throw and a reservation that fails fails the whole batch
+        template<class Request, class Copy, class Transfer>
+        std::size_t mapped_many(Request* requests, std::size_t count, bool write, Copy copy, Transfer transfer
+                                , std::error_code& ec) const noexcept
+        {
+            auto& rest = scratch<Request>();
+            try {
+                rest.requests.reserve(count);
+                rest.indices.reserve(count);
+            }
+            catch (const std::bad_alloc&) {
+                for (std::size_t i = 0; i < count; ++i)
+                    requests[i].transferred = 0;
+
+                ec = std::make_error_code(std::errc::not_enough_memory);
+                return 0;
+            }
+
+            return mapped_many(requests, count, write, copy, transfer);
+        }
+
+        static void copy_out(read_request& request, const std::uint8_t* local) noexcept
+        {
+            std::memcpy(request.buffer, local, request.size);
+        }
+
+        static void copy_in(write_request& request, std::uint8_t* local) noexcept
+        {
+            std::memcpy(local, request.buffer, request.size);
+        }
+
+    public:
+        /// \param regions The region map deciding which regions are mapped. It must outlive the policy.
+        /// \param args The arguments forwarded to the underlying policy.
+        template<class... Args>
+        explicit mapped_operations_policy(const region_map& regions, Args&&... args)
+                : OperationsPolicy(std::forward<Args>(args)...)
+                , _mappings(std::make_shared<detail::region_mappings>(regions))
+        {}
+
+        const region_map& regions() const noexcept { return _mappings->regions(); }
+
+        /// \brief Whether read only private file mappings are read through local mappings as well.
+        bool map_private_files() const noexcept { return _mappings->private_files(); }
+        void map_private_files(bool enable) { _mappings->private_files(enable); }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size) const
+        {
+            const auto addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto n    = static_cast<std::size_t>(size);
+            if (!_mappings->transfer(addr, n, false, [&](std::uint8_t* local) { std::memcpy(buffer, local, n); }))
+                OperationsPolicy::read(address, buffer, size);
+        }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            const auto addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto n    = static_cast<std::size_t>(size);
+            if (!_mappings->transfer(addr, n, false, [&](std::uint8_t* local) { std::memcpy(buffer, local, n); }))
+                OperationsPolicy::read(address, buffer, size, ec);
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return mapped_many(requests, count, false, &copy_out, [this](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n);
+            });
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return mapped_many(requests, count, false, &copy_out, [this, &ec](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n, ec);
+            }, ec);
+        }
+
+        template<typename T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size) const
+        {
+            const auto addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto n    = static_cast<std::size_t>(size);
+            if (!_mappings->transfer(addr, n, true, [&](std::uint8_t* local) { std::memcpy(local, buffer, n); }))
+                OperationsPolicy::write(address, buffer, size);
+        }
+
+        template<class T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            const auto addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto n    = static_cast<std::size_t>(size);
+            if (!_mappings->transfer(addr, n, true, [&](std::uint8_t* local) { std::memcpy(local, buffer, n); }))
+                OperationsPolicy::write(address, buffer, size, ec);
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return mapped_many(requests, count, true, &copy_in, [this](write_request* r, std::size_t n) {
+                return OperationsPolicy::write_many(r, n);
+            });
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return mapped_many(requests, count, true, &copy_in, [this, &ec](write_request* r, std::size_t n) {
+                return OperationsPolicy::write_many(r, n, ec);
+            }, ec);
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -18,7 +18,9 @@
 #define REMOTE_MEMORY_OPERATIONS_POLICY_HPP
 
 #include "read_memory.hpp"
+#include "read_batch.hpp"
 #include "write_memory.hpp"
+#include "write_batch.hpp"
 
 #if defined(_WIN32)
     #include "detail/windows/safe_handle.hpp"
@@ -51,6 +53,18 @@ namespace remote {
             read_memory(_handle.get(), address, buffer, size, ec);
         };
 
+        /// \brief Refer to remote::read_batch.
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return read_batch(_handle.get(), requests, count);
+        }
+
+        /// \brief Refer to remote::read_batch.
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return read_batch(_handle.get(), requests, count, ec);
+        }
+
         /// \brief Overwrites the memory range [address; address + size] with the contents of given
         /// buffer. \param address The address of the memory region to which the data will be
         /// written into. \param buffer The buffer whose data will be written into remote memory.
@@ -74,6 +88,18 @@ namespace remote {
         {
             write_memory(_handle.get(), address, buffer, size, ec);
         }
+
+        /// \brief Refer to remote::write_batch.
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return write_batch(_handle.get(), requests, count);
+        }
+
+        /// \brief Refer to remote::write_batch.
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return write_batch(_handle.get(), requests, count, ec);
+        }
     };
 
 } // namespace remote
@@ -0,0 +1,196 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_PARALLEL_SCAN_HPP
+#define REMOTE_MEMORY_PARALLEL_SCAN_HPP
+
+#include "read_batch.hpp"
+#include "pattern_scan.hpp"
+#include "detail/work_stealing_pool.hpp"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace remote {
+
+    /// \brief Scan kernel that finds every occurrence of a pattern.
+    class pattern_kernel {
+        pattern _pattern;
+
+    public:
+        using result_type = std::uintptr_t;
+
+        explicit pattern_kernel(pattern p) : _pattern(std::move(p)) {}
+
+        std::size_t overlap() const noexcept { return _pattern.size() - 1; }
+
+        void operator()(const std::uint8_t* data, std::size_t size, std::uintptr_t address
+                        , std::vector<result_type>& out) const
+        {
+            _pattern.find(data, size, [&](std::size_t offset) {
+                out.push_back(address + offset);
+                return true;
+            });
+        }
+    };
+
+    /// \brief Scan kernel that reports the address of every alignof(T) aligned T for which predicate returns true.
+    template<class T, class Predicate>
+    class predicate_kernel {
+        Predicate _predicate;
+
+    public:
+        using result_type = std::uintptr_t;
+
+        explicit predicate_kernel(Predicate predicate) : _predicate(std::move(predicate)) {}
+
+        std::size_t overlap() const noexcept { return sizeof(T) - 1; }
+
+        void operator()(const std::uint8_t* data, std::size_t size, std::uintptr_t address
+                        , std::vector<result_type>& out) const
+        {
+            // chunks start at aligned addresses so only the offset needs aligning
+            auto offset = static_cast<std::size_t>((alignof(T) - address % alignof(T)) % alignof(T));
+            for (; offset + sizeof(T) <= size; offset += alignof(T)) {
+                T value;
+                std::memcpy(&value, data + offset, sizeof(T));
+                if (_predicate(value))
+                    out.push_back(address + offset);
+            }
+        }
+    };
+
+    template<class T, class Predicate>
+    inline predicate_kernel<T, Predicate> make_predicate_kernel(Predicate predicate)
+    {
+        return predicate_kernel<T, Predicate>(std::move(predicate));
+    }
+
+    /// \brief Scan kernel that finds every alignof(T) aligned T equal to a value.
+    template<class T>
+    class value_kernel {
+        T _value;
+
+    public:
+        using result_type = std::uintptr_t;
+
+        explicit value_kernel(T value) noexcept : _value(value) {}
+
+        std::size_t overlap() const noexcept { return sizeof(T) - 1; }
+
+        void operator()(const std::uint8_t* data, std::size_t size, std::uintptr_t address
+                        , std::vector<result_type>& out) const
+        {
+            const auto value = _value;
+            make_predicate_kernel<T>([value](const T& v) { return std::memcmp(&v, &value, sizeof(T)) == 0; })(
+                    data, size, address, out);
+        }
+    };
+
+    /// \brief Splits remote regions into chunks and scans them on a work stealing thread pool.
+    ///        Every worker reads through its own memory object and buffer. Results are returned in address order.
+    ///
+    ///        A kernel is any type with
+    ///        - a result_type,
+    ///        - overlap() returning how many bytes past its start a result may extend minus one,
+    ///        - a thread safe operator()(const std::uint8_t* data, std::size_t size, std::uintptr_t address,
+    ///          std::vector<result_type>& out) appending the results found in [data; data + size] which was read
+    ///          from address. Each chunk is read with overlap() extra bytes so results crossing chunk boundaries
+    ///          are found exactly once.
+    class parallel_scanner {
+        struct task {
+            std::uintptr_t address;
+            std::size_t    size;
+            std::size_t    readable;
+        };
+
+        detail::work_stealing_pool _pool;
+        std::size_t                _chunk_size;
+        std::vector<task>          _tasks;
+
+    public:
+        /// \param threads The number of worker threads. 0 uses one per hardware thread.
+        /// \param chunk_size The size of a single task.
+        explicit parallel_scanner(std::size_t threads = 0, std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE)
+                : _pool(threads), _chunk_size(chunk_size)
+        {}
+
+        std::size_t threads() const noexcept { return _pool.size(); }
+        std::size_t chunk_size() const noexcept { return _chunk_size; }
+
+        /// \brief Scans every region of a range of regions such as region_map::filter(...).
+        /// \param memory_factory Called once per worker to create the memory object it reads through,
+        ///        for example [pid] { return remote::memory(pid); }
+        /// \param regions Range of objects with begin and end members.
+        /// \param kernel The kernel to run on every chunk.
+        /// \return The results of every chunk in address order.
+        /// \throw Rethrows the first exception thrown by a worker.
+        template<class MemoryFactory, class Regions, class Kernel>
+        std::vector<typename Kernel::result_type> scan(MemoryFactory memory_factory, const Regions& regions
+                                                       , const Kernel& kernel)
+        {
+            using memory_type = decltype(memory_factory());
+            using result_type = typename Kernel::result_type;
+
+            const auto overlap = kernel.overlap();
+            _tasks.clear();
+            for (const auto& r : regions)
+                for (std::uintptr_t address = r.begin; address < r.end; address += _chunk_size) {
+                    const auto left = static_cast<std::size_t>(r.end - address);
+                    _tasks.push_back({address, std::min(_chunk_size, left), std::min(_chunk_size + overlap, left)});
+                }
+
+            std::vector<std::unique_ptr<memory_type>> memories;
+            std::vector<std::vector<std::uint8_t>>    buffers(_pool.size());
+            for (std::size_t i = 0; i < _pool.size(); ++i)
+                memories.emplace_back(new memory_type(memory_factory()));
+
+            std::vector<std::vector<result_type>> results(_tasks.size());
+            _pool.run(_tasks.size(), [&](std::size_t worker, std::size_t index) {
+                const auto& t      = _tasks[index];
+                auto&       buffer = buffers[worker];
+                buffer.resize(_chunk_size + overlap);
+
+                // a read stopped by an unreadable page continues after that page, like pattern_scanner does
+                constexpr std::uintptr_t page_size = 4096;
+                const auto               end       = t.address + t.readable;
+                for (auto address = t.address; address < end;) {
+                    read_request request(address, buffer.data(), static_cast<std::size_t>(end - address));
+                    memories[worker]->read_many(&request, 1);
+                    kernel(buffer.data(), request.transferred, address, results[index]);
+                    if (request.succeeded())
+                        break;
+
+                    address = (address + request.transferred + page_size) & ~(page_size - 1);
+                }
+            });
+
+            std::size_t total = 0;
+            for (auto& r : results)
+                total += r.size();
+
+            std::vector<result_type> merged;
+            merged.reserve(total);
+            for (auto& r : results)
+                merged.insert(merged.end(), r.begin(), r.end());
+
+            return merged;
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,267 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_PATTERN_SCAN_HPP
+#define REMOTE_MEMORY_PATTERN_SCAN_HPP
+
+#include "read_batch.hpp"
+#include "detail/pattern_kernels.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// the amount of remote memory read at once while scanning
+#ifndef REMOTE_MEMORY_SCAN_CHUNK_SIZE
+    #define REMOTE_MEMORY_SCAN_CHUNK_SIZE (1024 * 1024)
+#endif
+
+namespace remote {
+
+    /// \brief A byte signature that may contain wildcards.
+    class pattern {
+        std::vector<std::uint8_t> _bytes;
+        std::vector<std::uint8_t> _mask;
+        detail::pattern_view      _view;
+
+        static int hex_digit(char c) noexcept
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+        void finish()
+        {
+            if (_bytes.empty())
+                throw std::invalid_argument("pattern is empty");
+
+            std::size_t first = _bytes.size(), last = 0;
+            for (std::size_t i = 0; i < _bytes.size(); ++i) {
+                if (_mask[i] != 0xFF)
+                    continue;
+
+                first = std::min(first, i);
+                last  = i;
+            }
+
+            const bool wildcards_only = first == _bytes.size();
+            _view = {_bytes.data(), _mask.data(), _bytes.size(), wildcards_only ? 0 : first, last, wildcards_only};
+        }
+
+    public:
+        /// \brief Parses an IDA style signature such as "48 8B ?? ? 05". Both ? and ?? are wildcards.
+        /// \throw Throws an std::invalid_argument if the signature is malformed.
+        explicit pattern(const char* signature)
+        {
+            for (auto c = signature; *c;) {
+                if (*c == ' ') {
+                    ++c;
+                    continue;
+                }
+
+                if (*c == '?') {
+                    c += (c[1] == '?') ? 2 : 1;
+                    _bytes.push_back(0);
+                    _mask.push_back(0);
+                    continue;
+                }
+
+                const auto high = hex_digit(c[0]);
+                const auto low  = high < 0 ? -1 : hex_digit(c[1]);
+                if (low < 0)
+                    throw std::invalid_argument("pattern contains an invalid byte");
+
+                _bytes.push_back(static_cast<std::uint8_t>(high << 4 | low));
+                _mask.push_back(0xFF);
+                c += 2;
+            }
+
+            finish();
+        }
+
+        /// \brief Creates a code style signature where mask contains an 'x' for every byte
+        ///        that must match and a '?' for every wildcard.
+        /// \throw Throws an std::invalid_argument if the pattern is empty.
+        pattern(const void* bytes, const char* mask)
+        {
+            const auto b = static_cast<const std::uint8_t*>(bytes);
+            for (std::size_t i = 0; mask[i]; ++i) {
+                const bool wildcard = mask[i] == '?';
+                _bytes.push_back(wildcard ? 0 : b[i]);
+                _mask.push_back(wildcard ? 0 : 0xFF);
+            }
+
+            finish();
+        }
+
+        pattern(const pattern& other) : _bytes(other._bytes), _mask(other._mask) { finish(); }
+
+        pattern& operator=(const pattern& other)
+        {
+            _bytes = other._bytes;
+            _mask  = other._mask;
+            finish();
+            return *this;
+        }
+
+        std::size_t size() const noexcept { return _bytes.size(); }
+
+        const detail::pattern_view& view() const noexcept { return _view; }
+
+        /// \brief Calls callback(offset) for every match inside of the local buffer [data; data + size]
+        ///        until it returns false.
+        /// \return false if the callback stopped the search.
+        template<class Callback>
+        bool find(const void* data, std::size_t size, Callback callback) const
+        {
+            return detail::find_pattern(static_cast<const std::uint8_t*>(data), size, _view, callback);
+        }
+    };
+
+    /// \brief Searches remote memory for patterns. The memory is streamed in large chunks through
+    ///        the read_many function of an operations policy or remote::basic_memory.
+    ///        Matches that straddle chunk boundaries are found. Unreadable memory is skipped.
+    /// \note The scanner keeps its read buffer between calls, so reuse it for repeated scans.
+    ///       It must not be used by multiple threads at once.
+    class pattern_scanner {
+        std::vector<std::uint8_t> _buffer;
+        std::size_t               _chunk_size;
+
+        static constexpr std::size_t page_size = 4096;
+
+    public:
+        explicit pattern_scanner(std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE) : _chunk_size(chunk_size)
+        {}
+
+        std::size_t chunk_size() const noexcept { return _chunk_size; }
+
+        /// \brief Calls callback(address) for every match inside of the remote range [begin; end)
+        ///        in ascending order until it returns false.
+        /// \return false if the callback stopped the scan.
+        /// \throw Throws if the underlying read_many throws, for example if the process no longer exists.
+        template<class Memory, class Callback>
+        bool scan(const Memory& memory, std::uintptr_t begin, std::uintptr_t end, const pattern& p
+                  , Callback callback)
+        {
+            const auto overlap = p.size() - 1;
+            _buffer.resize(_chunk_size + overlap);
+
+            // the last pattern size - 1 bytes of the previous chunk are kept in front of the next one
+            std::size_t carried = 0;
+            for (auto address = begin; address < end;) {
+                const auto size = std::min<std::uintptr_t>(_chunk_size, end - address);
+
+                read_request request(address, _buffer.data() + carried, static_cast<std::size_t>(size));
+                memory.read_many(&request, 1);
+
+                const auto available = carried + request.transferred;
+                const auto base      = address - carried;
+                const bool keep_going = p.find(_buffer.data(), available, [&](std::size_t offset) {
+                    return callback(base + offset);
+                });
+                if (!keep_going)
+                    return false;
+
+                if (request.succeeded()) {
+                    carried = std::min(overlap, available);
+                    std::memmove(_buffer.data(), _buffer.data() + available - carried, carried);
+                    address += size;
+                }
+                else {
+                    // skip the page that stopped the read - a match can not continue past it
+                    carried = 0;
+                    address = (address + request.transferred + page_size) & ~std::uintptr_t{page_size - 1};
+                }
+            }
+
+            return true;
+        }
+
+        /// \brief Scans every region of a range of regions such as region_map::filter(...).
+        ///        The regions must be sorted and each needs begin and end members.
+        template<class Memory, class Regions, class Callback>
+        bool scan_regions(const Memory& memory, const Regions& regions, const pattern& p, Callback callback)
+        {
+            for (const auto& r : regions)
+                if (!scan(memory, r.begin, r.end, p, callback))
+                    return false;
+
+            return true;
+        }
+
+        /// \return The address of the first match inside of [begin; end) or 0 if there is none.
+        template<class Memory>
+        std::uintptr_t find_first(const Memory& memory, std::uintptr_t begin, std::uintptr_t end, const pattern& p)
+        {
+            std::uintptr_t found = 0;
+            scan(memory, begin, end, p, [&](std::uintptr_t address) {
+                found = address;
+                return false;
+            });
+            return found;
+        }
+
+        /// \return The addresses of every match inside of [begin; end) in ascending order.
+        template<class Memory>
+        std::vector<std::uintptr_t> find_all(const Memory& memory, std::uintptr_t begin, std::uintptr_t end
+                                             , const pattern& p)
+        {
+            std::vector<std::uintptr_t> found;
+            scan(memory, begin, end, p, [&](std::uintptr_t address) {
+                found.push_back(address);
+                return true;
+            });
+            return found;
+        }
+
+        template<class Memory, class Regions>
+        std::uintptr_t find_first(const Memory& memory, const Regions& regions, const pattern& p)
+        {
+            std::uintptr_t found = 0;
+            scan_regions(memory, regions, p, [&](std::uintptr_t address) {
+                found = address;
+                return false;
+            });
+            return found;
+        }
+
+        template<class Memory, class Regions>
+        std::vector<std::uintptr_t> find_all(const Memory& memory, const Regions& regions, const pattern& p)
+        {
+            std::vector<std::uintptr_t> found;
+            scan_regions(memory, regions, p, [&](std::uintptr_t address) {
+                found.push_back(address);
+                return true;
+            });
+            return found;
+        }
+    };
+
+    /// \brief Convenience wrapper around pattern_scanner::find_all.
+    template<class Memory>
+    inline std::vector<std::uintptr_t> pattern_scan(const Memory& memory, std::uintptr_t begin, std::uintptr_t end
+                                                    , const pattern& p)
+    {
+        return pattern_scanner().find_all(memory, begin, end, p);
+    }
+
+} // namespace remote
+
+#endif // include guard
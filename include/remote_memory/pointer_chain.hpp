@@ -0,0 +1,124 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_POINTER_CHAIN_HPP
+#define REMOTE_MEMORY_POINTER_CHAIN_HPP
+
+#include "read_batch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace remote {
+
+    /// \brief A single pointer chain resolved by basic_memory::resolve_pointer_chains.
+    ///        base and offsets describe the chain the same way as the arguments of traverse_pointers_chain,
+    ///        result, resolved and failed_level are filled in during resolution.
+    /// \code pointer_chain(base_address, offsets) // offsets = {0x20, 0x8}
+    ///       // resolves to *(*(*(base_address) + 0x20) + 0x8)
+    struct pointer_chain {
+        std::uintptr_t        base    = 0;
+        const std::ptrdiff_t* offsets = nullptr;
+        std::size_t           depth   = 0;
+
+        /// \brief The value at the end of the chain once resolved.
+        std::uintptr_t result       = 0;
+        bool           resolved     = false;
+        /// \brief The index of the read that failed. Read 0 dereferences base and read i dereferences
+        ///        the address built from offsets[i - 1].
+        std::size_t    failed_level = 0;
+
+        pointer_chain() = default;
+
+        /// \param offsets The offsets. They are not copied and must outlive the resolution.
+        template<class Address>
+        pointer_chain(Address base_, const std::ptrdiff_t* offsets_, std::size_t depth_)
+            noexcept(!jm::detail::checked_pointers)
+                : base(jm::detail::pointer_cast<std::uintptr_t>(base_)), offsets(offsets_), depth(depth_)
+        {}
+
+        /// \param offsets A container of std::ptrdiff_t with data and size members. It is not copied
+        ///        and must outlive the resolution.
+        template<class Address, class Offsets>
+        pointer_chain(Address base_, const Offsets& offsets_) noexcept(!jm::detail::checked_pointers)
+                : pointer_chain(base_, offsets_.data(), offsets_.size())
+        {}
+    };
+
+    namespace detail {
+
+        /// \brief Resolves the chains one level at a time. read_many(requests, count) reads a level and returns
+        ///        false if the whole batch failed, in which case the unresolved chains fail at that level.
+        template<class Ptr, class ReadMany>
+        inline std::size_t resolve_pointer_chains(pointer_chain* chains, std::size_t count, ReadMany read_many)
+        {
+            using pointer_t = jm::detail::as_uintptr_t<sizeof(Ptr)>;
+
+            struct scratch_t {
+                std::vector<read_request> requests;
+                std::vector<pointer_t>    values;
+                std::vector<std::size_t>  active;
+            };
+            thread_local scratch_t s;
+
+            // result holds the address of the next read until the chain is resolved
+            s.active.clear();
+            for (std::size_t i = 0; i < count; ++i) {
+                chains[i].result       = chains[i].base;
+                chains[i].resolved     = false;
+                chains[i].failed_level = 0;
+                s.active.push_back(i);
+            }
+
+            std::size_t resolved = 0;
+            for (std::size_t level = 0; !s.active.empty(); ++level) {
+                s.requests.resize(s.active.size());
+                s.values.resize(s.active.size());
+                for (std::size_t i = 0; i < s.active.size(); ++i)
+                    s.requests[i] = read_request(chains[s.active[i]].result, &s.values[i]);
+
+                const bool processed = read_many(s.requests.data(), s.requests.size());
+
+                std::size_t still_active = 0;
+                for (std::size_t i = 0; i < s.active.size(); ++i) {
+                    auto& chain = chains[s.active[i]];
+                    if (!processed || !s.requests[i].succeeded()) {
+                        chain.failed_level = level;
+                        continue;
+                    }
+
+                    if (level == chain.depth) {
+                        chain.result   = static_cast<std::uintptr_t>(s.values[i]);
+                        chain.resolved = true;
+                        ++resolved;
+                        continue;
+                    }
+
+                    chain.result             = static_cast<std::uintptr_t>(s.values[i] + chain.offsets[level]);
+                    s.active[still_active++] = s.active[i];
+                }
+
+                s.active.resize(still_active);
+            }
+
+            return resolved;
+        }
+
+    } // namespace detail
+
+} // namespace remote
+
+#endif // include guard
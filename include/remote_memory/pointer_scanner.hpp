@@ -0,0 +1,538 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_POINTER_SCANNER_HPP
+#define REMOTE_MEMORY_POINTER_SCANNER_HPP
+
+#if !defined(__linux__)
+    #error pointer_scanner is only available on linux
+#endif
+
+#include "dump.hpp"
+#include "parallel_scan.hpp"
+#include "pointer_chain.hpp"
+#include "region_map.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace remote {
+
+    /// \brief The first bytes of a pointer map file. Every field is stored in native byte order.
+    ///
+    ///        The header is followed by entry_count values, entry_count sources, range_count
+    ///        pointer_map_range records, module_count pointer_map_module records and the string table
+    ///        holding the module paths.
+    struct pointer_map_header {
+        char          magic[8];
+        std::uint32_t version;
+        std::uint32_t module_count;
+        std::uint64_t entry_count;
+        std::uint64_t range_count;
+        std::uint64_t strings_size;
+    };
+
+    /// \brief A range of memory belonging to a module. Pointers stored in them are the roots of pointer paths.
+    struct pointer_map_range {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::uint32_t module;
+        std::uint32_t reserved;
+    };
+
+    struct pointer_map_module {
+        std::uint64_t base;
+        std::uint32_t path_offset;
+        std::uint32_t path_size;
+    };
+
+    constexpr char          pointer_map_magic[8] = {'R', 'M', 'P', 'T', 'R', 'M', 'A', 'P'};
+    constexpr std::uint32_t pointer_map_version  = 1;
+
+    struct pointer_scan_options {
+        /// the number of threads reading the target. 0 uses one per hardware thread
+        std::size_t   threads   = 0;
+        /// the alignment of the addresses that are checked for pointers
+        std::size_t   alignment = sizeof(std::uintptr_t);
+        /// the regions that are read for pointers
+        region_filter sources   = region_filter{protection::read | protection::write};
+    };
+
+    struct pointer_search_options {
+        /// the maximum number of pointers in a path
+        std::size_t max_depth   = 5;
+        /// the largest offset added to a pointer
+        std::size_t max_offset  = 0x1000;
+        /// the search stops once this many paths were found
+        std::size_t max_results = 10000;
+        /// no more addresses are expanded once this many were visited
+        std::size_t max_nodes   = 1 << 22;
+    };
+
+    /// \brief A path of pointers leading from a module to an address.
+    ///        The target is *(*(*(base) + offsets[0]) + offsets[1]) + offsets[2] for three offsets,
+    ///        the last offset is added without dereferencing the result.
+    struct pointer_path {
+        /// the path of the module holding the first pointer
+        std::string                 module;
+        /// the offset of base from the lowest address the module is mapped at
+        std::uintptr_t              module_offset = 0;
+        std::uintptr_t              base          = 0;
+        std::vector<std::ptrdiff_t> offsets;
+
+        /// \brief A chain resolving to the pointer the last offset is added to.
+        ///        The chain refers to the offsets, so the path must outlive it.
+        pointer_chain chain() const noexcept { return {base, offsets.data(), offsets.size() - 1}; }
+    };
+
+    /// \brief A pointer found by the scan, the value stored at source.
+    struct pointer_map_entry {
+        std::uintptr_t value;
+        std::uintptr_t source;
+
+        friend bool operator<(const pointer_map_entry& a, const pointer_map_entry& b) noexcept
+        {
+            return a.value < b.value || (a.value == b.value && a.source < b.source);
+        }
+    };
+
+    namespace detail {
+
+        /// \brief Scan kernel that reports aligned values which point into one of a sorted set of ranges.
+        ///        The results of every chunk are sorted by value so that the chunks only need to be merged.
+        class pointer_kernel {
+            const std::vector<std::uintptr_t>& _begins;
+            const std::vector<std::uintptr_t>& _ends;
+            std::size_t                        _alignment;
+
+        public:
+            using result_type = pointer_map_entry;
+
+            pointer_kernel(const std::vector<std::uintptr_t>& begins, const std::vector<std::uintptr_t>& ends
+                           , std::size_t alignment) noexcept
+                    : _begins(begins), _ends(ends), _alignment(alignment)
+            {}
+
+            std::size_t overlap() const noexcept { return sizeof(std::uintptr_t) - 1; }
+
+            void operator()(const std::uint8_t* data, std::size_t size, std::uintptr_t address
+                            , std::vector<result_type>& out) const
+            {
+                if (_begins.empty())
+                    return;
+
+                // most values are small integers or floats far outside of every range, so reject those first
+                const auto low  = _begins.front();
+                const auto span = _ends.back() - low;
+
+                // the ranges hit last are checked before searching, pointers into the same allocation cluster
+                std::size_t last   = 0;
+                auto        offset = static_cast<std::size_t>((_alignment - address % _alignment) % _alignment);
+                for (; offset + sizeof(std::uintptr_t) <= size; offset += _alignment) {
+                    std::uintptr_t value;
+                    std::memcpy(&value, data + offset, sizeof(value));
+                    if (value - low >= span)
+                        continue;
+
+                    if (value < _begins[last] || value >= _ends[last]) {
+                        const auto next = std::upper_bound(_begins.begin(), _begins.end(), value);
+                        last            = static_cast<std::size_t>(next - _begins.begin()) - 1;
+                        if (value >= _ends[last])
+                            continue;
+                    }
+
+                    out.push_back({value, address + offset});
+                }
+
+                std::sort(out.begin(), out.end());
+            }
+        };
+
+        // merges the sorted runs the chunks were returned in, one pass halves the number of runs
+        inline void merge_runs(std::vector<pointer_map_entry>& entries)
+        {
+            std::vector<std::size_t> runs{0};
+            for (std::size_t i = 1; i < entries.size(); ++i)
+                if (entries[i] < entries[i - 1])
+                    runs.push_back(i);
+            runs.push_back(entries.size());
+
+            std::vector<pointer_map_entry> scratch(entries.size());
+            while (runs.size() > 2) {
+                std::vector<std::size_t> merged{0};
+                for (std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+                    const auto middle = runs[i + 1];
+                    const auto last   = i + 2 < runs.size() ? runs[i + 2] : middle;
+                    std::merge(entries.begin() + runs[i], entries.begin() + middle, entries.begin() + middle
+                               , entries.begin() + last, scratch.begin() + runs[i]);
+                    merged.push_back(last);
+                }
+
+                entries.swap(scratch);
+                runs.swap(merged);
+            }
+        }
+
+    } // namespace detail
+
+    /// \brief Finds the paths of pointers that lead from modules to an address of a process.
+    ///
+    ///        scan() reads the target once in parallel and stores every aligned value that points into a readable
+    ///        region together with its address in a pointer map sorted by value, 16 bytes per pointer.
+    ///        The memory of file backed regions and the anonymous regions directly following them, such as .bss,
+    ///        is recorded as module memory.
+    ///        find_paths() then walks the map backwards from the target. Every level looks up the pointers to
+    ///        within max_offset below each address of the previous level with a binary search. Addresses are only
+    ///        expanded once and addresses in module memory are not expanded at all, because any path through them
+    ///        is a longer version of the path starting at them.
+    ///        The map can be saved and loaded so repeated searches of the same state skip the scan.
+    /// \note Scanning the own process also finds the pointers held by the partial results of the scan.
+    /// \code remote::pointer_scanner scanner;
+    ///       scanner.scan([pid] { return remote::memory(pid); }, remote::region_map(pid));
+    ///       for (const auto& path : scanner.find_paths(player_health_address))
+    class pointer_scanner {
+        std::vector<std::uintptr_t>     _values;
+        std::vector<std::uintptr_t>     _sources;
+        std::vector<pointer_map_range>  _ranges;
+        std::vector<pointer_map_module> _modules;
+        std::string                     _strings;
+
+        struct node {
+            std::uintptr_t address;
+            std::size_t    level;
+            bool           root;
+        };
+
+        struct edge {
+            std::uint32_t  from;
+            std::uint32_t  to;
+            std::ptrdiff_t offset;
+        };
+
+        const pointer_map_range* range_of(std::uintptr_t address) const noexcept
+        {
+            const auto next = std::upper_bound(_ranges.begin(), _ranges.end(), address
+                                               , [](std::uintptr_t a, const pointer_map_range& r) {
+                                                   return a < r.begin;
+                                               });
+            if (next == _ranges.begin() || address >= (next - 1)->end)
+                return nullptr;
+
+            return &*(next - 1);
+        }
+
+        void record_modules(const region_map& regions)
+        {
+            _ranges.clear();
+            _modules.clear();
+            _strings.clear();
+
+            // the anonymous region directly following a file mapping is its .bss
+            const char*    current   = nullptr;
+            std::uintptr_t file_end  = 0;
+            for (const auto& r : regions) {
+                const auto file = !r.anonymous() && r.path[0] != '\0' && r.path[0] != '[';
+                if (file && (!current || std::strcmp(current, r.path) != 0)) {
+                    current = r.path;
+                    const auto size = std::strlen(r.path);
+                    _modules.push_back({r.begin, static_cast<std::uint32_t>(_strings.size())
+                                        , static_cast<std::uint32_t>(size)});
+                    _strings.append(r.path, size);
+                }
+                else if (!file && !(current && r.path[0] == '\0' && r.begin == file_end)) {
+                    current = nullptr;
+                    continue;
+                }
+
+                const auto module = static_cast<std::uint32_t>(_modules.size() - 1);
+                if (!_ranges.empty() && _ranges.back().module == module && _ranges.back().end == r.begin)
+                    _ranges.back().end = r.end;
+                else
+                    _ranges.push_back({r.begin, r.end, module, 0});
+
+                file_end = file ? r.end : 0;
+            }
+        }
+
+    public:
+        /// \brief Replaces the pointer map with one of the current state of a process.
+        /// \param memory_factory Called once per thread to create the memory object it reads through,
+        ///        for example [pid] { return remote::memory(pid); }
+        /// \param regions The regions of the process.
+        /// \throw Rethrows the first exception thrown while reading.
+        template<class MemoryFactory>
+        void scan(MemoryFactory memory_factory, const region_map& regions
+                  , const pointer_scan_options& options = pointer_scan_options{})
+        {
+            record_modules(regions);
+
+            // adjacent readable regions are merged so that fewer ranges have to be searched
+            std::vector<std::uintptr_t> begins, ends;
+            for (const auto& r : regions) {
+                if (!r.readable())
+                    continue;
+
+                if (!ends.empty() && ends.back() == r.begin)
+                    ends.back() = r.end;
+                else {
+                    begins.push_back(r.begin);
+                    ends.push_back(r.end);
+                }
+            }
+
+            parallel_scanner scanner(options.threads);
+            auto entries = scanner.scan(memory_factory, regions.filter(options.sources)
+                                        , detail::pointer_kernel(begins, ends, std::max<std::size_t>(
+                                                options.alignment, 1)));
+            detail::merge_runs(entries);
+
+            _values.resize(entries.size());
+            _sources.resize(entries.size());
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                _values[i]  = entries[i].value;
+                _sources[i] = entries[i].source;
+            }
+        }
+
+        /// \brief The number of pointers in the map.
+        std::size_t size() const noexcept { return _values.size(); }
+        bool empty() const noexcept { return _values.empty(); }
+
+        /// \brief Calls f(const pointer_map_entry&) for every pointer whose value lies in [from; to].
+        template<class F>
+        void for_each_pointer(std::uintptr_t from, std::uintptr_t to, F f) const
+        {
+            auto i = static_cast<std::size_t>(std::lower_bound(_values.begin(), _values.end(), from)
+                                              - _values.begin());
+            for (; i < _values.size() && _values[i] <= to; ++i)
+                f(pointer_map_entry{_values[i], _sources[i]});
+        }
+
+        /// \brief Finds paths of pointers from module memory to the target.
+        ///        Paths are ordered by their length and the address they start at.
+        std::vector<pointer_path> find_paths(std::uintptr_t target
+                                             , const pointer_search_options& options = pointer_search_options{}) const
+        {
+            std::vector<node>                              nodes{{target, 0, false}};
+            std::vector<edge>                              edges;
+            std::unordered_map<std::uintptr_t, std::uint32_t> index{{target, 0}};
+
+            // breadth first so that every address is expanded at the level of its shortest path
+            std::size_t level_begin = 0;
+            for (std::size_t level = 0; level < options.max_depth; ++level) {
+                const auto level_end = nodes.size();
+                for (auto n = level_begin; n < level_end && nodes.size() < options.max_nodes; ++n) {
+                    if (nodes[n].root)
+                        continue;
+
+                    const auto to      = nodes[n].address;
+                    const auto from    = to - std::min<std::uintptr_t>(to, options.max_offset);
+                    const auto to_node = static_cast<std::uint32_t>(n);
+                    for_each_pointer(from, to, [&](const pointer_map_entry& e) {
+                        const auto inserted = index.emplace(e.source, static_cast<std::uint32_t>(nodes.size()));
+                        if (inserted.second)
+                            nodes.push_back({e.source, level + 1, range_of(e.source) != nullptr});
+
+                        edges.push_back({inserted.first->second, to_node, static_cast<std::ptrdiff_t>(to - e.value)});
+                    });
+                }
+
+                level_begin = level_end;
+            }
+
+            // edges grouped by the node they start at
+            std::vector<std::size_t> first_edge(nodes.size() + 1, 0);
+            for (const auto& e : edges)
+                ++first_edge[e.from + 1];
+            for (std::size_t i = 1; i < first_edge.size(); ++i)
+                first_edge[i] += first_edge[i - 1];
+
+            std::vector<edge> grouped(edges.size());
+            std::vector<std::size_t> cursor(first_edge.begin(), first_edge.end() - 1);
+            for (const auto& e : edges)
+                grouped[cursor[e.from]++] = e;
+            edges.swap(grouped);
+
+            std::vector<pointer_path>   paths;
+            std::vector<std::ptrdiff_t> offsets;
+            std::vector<bool>           on_path(nodes.size(), false);
+
+            // follows the edges towards the target through nodes close enough to reach it within the depth limit
+            struct walker {
+                const pointer_scanner&         scanner;
+                const pointer_search_options&  options;
+                const std::vector<node>&       nodes;
+                const std::vector<edge>&       edges;
+                const std::vector<std::size_t>& first_edge;
+                std::vector<pointer_path>&     paths;
+                std::vector<std::ptrdiff_t>&   offsets;
+                std::vector<bool>&             on_path;
+                std::uint32_t                  root;
+
+                void operator()(std::uint32_t n, std::size_t remaining)
+                {
+                    if (n == 0) {
+                        const auto  base   = nodes[root].address;
+                        const auto& module = scanner._modules[scanner.range_of(base)->module];
+                        paths.push_back({scanner._strings.substr(module.path_offset, module.path_size)
+                                         , base - module.base, base, offsets});
+                        return;
+                    }
+
+                    on_path[n] = true;
+                    for (auto i = first_edge[n]; i < first_edge[n + 1] && paths.size() < options.max_results; ++i) {
+                        const auto& e = edges[i];
+                        if (on_path[e.to] || nodes[e.to].level >= remaining)
+                            continue;
+
+                        offsets.push_back(e.offset);
+                        (*this)(e.to, remaining - 1);
+                        offsets.pop_back();
+                    }
+                    on_path[n] = false;
+                }
+            };
+
+            for (std::uint32_t n = 1; n < nodes.size() && paths.size() < options.max_results; ++n)
+                if (nodes[n].root)
+                    walker{*this, options, nodes, edges, first_edge, paths, offsets, on_path, n}(n, options.max_depth);
+
+            std::sort(paths.begin(), paths.end(), [](const pointer_path& a, const pointer_path& b) {
+                return a.offsets.size() < b.offsets.size()
+                       || (a.offsets.size() == b.offsets.size() && a.base < b.base);
+            });
+            return paths;
+        }
+
+        /// \brief Writes the pointer map to a file at path. Refer to pointer_map_header for the format.
+        /// \param ec The error code that will be set if the file could not be created or written.
+        void save(const char* path, std::error_code& ec) const
+        {
+            detail::unique_fd fd(::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (!fd) {
+                ec = detail::get_last_error();
+                return;
+            }
+
+            pointer_map_header header;
+            std::memcpy(header.magic, pointer_map_magic, sizeof(header.magic));
+            header.version      = pointer_map_version;
+            header.module_count = static_cast<std::uint32_t>(_modules.size());
+            header.entry_count  = _values.size();
+            header.range_count  = _ranges.size();
+            header.strings_size = _strings.size();
+
+            const auto    pointer_bytes = _values.size() * sizeof(std::uintptr_t);
+            const auto    range_bytes   = _ranges.size() * sizeof(pointer_map_range);
+            const auto    module_bytes  = _modules.size() * sizeof(pointer_map_module);
+            std::uint64_t offset        = sizeof(header);
+            detail::write_all(fd.get(), &header, sizeof(header), 0, ec)
+                    && detail::write_all(fd.get(), _values.data(), pointer_bytes, offset, ec)
+                    && detail::write_all(fd.get(), _sources.data(), pointer_bytes, offset += pointer_bytes, ec)
+                    && detail::write_all(fd.get(), _ranges.data(), range_bytes, offset += pointer_bytes, ec)
+                    && detail::write_all(fd.get(), _modules.data(), module_bytes, offset += range_bytes, ec)
+                    && detail::write_all(fd.get(), _strings.data(), _strings.size(), offset += module_bytes, ec);
+        }
+
+        /// \brief Refer to save.
+        /// \throw Throws an std::system_error if the file could not be created or written.
+        void save(const char* path) const
+        {
+            std::error_code ec;
+            save(path, ec);
+            if (ec)
+                throw std::system_error(ec, "pointer_scanner::save() failed");
+        }
+
+        /// \brief Replaces the pointer map with one written by save.
+        /// \param ec The error code that will be set if the file can not be read or is not a pointer map.
+        ///        The map is left empty on failure.
+        void load(const char* path, std::error_code& ec)
+        {
+            _values.clear();
+            _sources.clear();
+            _ranges.clear();
+            _modules.clear();
+            _strings.clear();
+
+            detail::unique_fd fd(::open(path, O_RDONLY | O_CLOEXEC));
+            if (!fd) {
+                ec = detail::get_last_error();
+                return;
+            }
+
+            pointer_map_header header;
+            if (!detail::read_all(fd.get(), &header, sizeof(header), 0, ec))
+                return;
+
+            if (std::memcmp(header.magic, pointer_map_magic, sizeof(header.magic)) != 0
+                || header.version != pointer_map_version) {
+                ec = std::make_error_code(std::errc::invalid_argument);
+                return;
+            }
+
+            std::vector<std::uintptr_t>     values(header.entry_count), sources(header.entry_count);
+            std::vector<pointer_map_range>  ranges(header.range_count);
+            std::vector<pointer_map_module> modules(header.module_count);
+            std::string                     strings(header.strings_size, '\0');
+
+            const auto    pointer_bytes = values.size() * sizeof(std::uintptr_t);
+            const auto    range_bytes   = ranges.size() * sizeof(pointer_map_range);
+            const auto    module_bytes  = modules.size() * sizeof(pointer_map_module);
+            std::uint64_t offset        = sizeof(header);
+            if (!detail::read_all(fd.get(), values.data(), pointer_bytes, offset, ec)
+                || !detail::read_all(fd.get(), sources.data(), pointer_bytes, offset += pointer_bytes, ec)
+                || !detail::read_all(fd.get(), ranges.data(), range_bytes, offset += pointer_bytes, ec)
+                || !detail::read_all(fd.get(), modules.data(), module_bytes, offset += range_bytes, ec)
+                || !detail::read_all(fd.get(), &strings[0], strings.size(), offset += module_bytes, ec))
+                return;
+
+            for (const auto& r : ranges)
+                if (r.module >= modules.size()) {
+                    ec = std::make_error_code(std::errc::invalid_argument);
+                    return;
+                }
+
+            for (const auto& m : modules)
+                if (std::uint64_t{m.path_offset} + m.path_size > strings.size()) {
+                    ec = std::make_error_code(std::errc::invalid_argument);
+                    return;
+                }
+
+            _values.swap(values);
+            _sources.swap(sources);
+            _ranges.swap(ranges);
+            _modules.swap(modules);
+            _strings.swap(strings);
+        }
+
+        /// \brief Refer to load.
+        /// \throw Throws an std::system_error if the file can not be read or is not a pointer map.
+        void load(const char* path)
+        {
+            std::error_code ec;
+            load(path, ec);
+            if (ec)
+                throw std::system_error(ec, "pointer_scanner::load() failed");
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Justas Masiulis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REMOTE_MEMORY_PROCMEM_OPERATIONS_POLICY_HPP
+#define REMOTE_MEMORY_PROCMEM_OPERATIONS_POLICY_HPP
+
+#if !defined(__linux__)
+    #error procmem_operations_policy is only available on linux
+#endif
+
+#include "read_memory.hpp"
+#include "read_batch.hpp"
+#include "write_memory.hpp"
+#include "write_batch.hpp"
+#include "detail/linux/safe_handle.hpp"
+#include "detail/linux/procmem.hpp"
+
+// transfers of at least this many bytes go through /proc/<pid>/mem, smaller ones use process_vm_readv / writev
+#ifndef REMOTE_MEMORY_PROCMEM_THRESHOLD
+    #define REMOTE_MEMORY_PROCMEM_THRESHOLD 0
+#endif
+
+namespace remote {
+
+    /// \brief Operations policy that transfers memory using pread / pwrite on a /proc/<pid>/mem descriptor
+    ///        which is opened once for the lifetime of the policy.
+    ///        Unlike process_vm_writev writes through it also succeed on read only pages.
+    class procmem_operations_policy {
+        detail::safe_handle _handle;
+        detail::unique_fd   _fd;
+        std::size_t         _threshold = REMOTE_MEMORY_PROCMEM_THRESHOLD;
+
+        bool use_procmem(std::size_t size) const noexcept { return size >= _threshold; }
+
+    public:
+        /// \brief Opens the memory of the current process.
+        procmem_operations_policy() : procmem_operations_policy(::getpid()) {}
+
+        /// \brief Opens the memory of the given process.
+        /// \throw Throws an std::system_error if /proc/<pid>/mem could not be opened.
+        explicit procmem_operations_policy(pid_t pid) : _handle(pid)
+        {
+            std::error_code ec;
+            _fd = detail::open_procmem(pid, ec);
+            if (ec)
+                throw std::system_error(ec, "open() of /proc/<pid>/mem failed");
+        }
+
+        /// \brief Opens the memory of the given process.
+        /// \param ec The error code that will be set if /proc/<pid>/mem could not be opened.
+        procmem_operations_policy(pid_t pid, std::error_code& ec) noexcept
+                : _handle(pid), _fd(detail::open_procmem(pid, ec))
+        {}
+
+        /// \brief Transfers smaller than threshold bytes will use process_vm_readv / writev instead.
+        void threshold(std::size_t threshold) noexcept { _threshold = threshold; }
+        std::size_t threshold() const noexcept { return _threshold; }
+
+        int fd() const noexcept { return _fd.get(); }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size) const
+        {
+            if (!use_procmem(static_cast<std::size_t>(size)))
+                return read_memory(_handle.get(), address, buffer, size);
+
+            std::error_code ec;
+            const auto read = detail::procmem_read(_fd.get(), jm::detail::pointer_cast<std::uintptr_t>(address)
+                                                   , buffer, static_cast<std::size_t>(size), ec);
+            if (ec)
+                throw std::system_error(ec, "pread() failed");
+            else if (read < static_cast<std::size_t>(size))
+                throw std::range_error("pread() read less than requested");
+        }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            if (!use_procmem(static_cast<std::size_t>(size)))
+                return read_memory(_handle.get(), address, buffer, size, ec);
+
+            const auto read = detail::procmem_read(_fd.get(), jm::detail::pointer_cast<std::uintptr_t>(address)
+                                                   , buffer, static_cast<std::size_t>(size), ec);
+            if (!ec && read < static_cast<std::size_t>(size))
+                ec = std::make_error_code(std::errc::result_out_of_range);
+        }
+
+        /// \brief Refer to remote::read_batch. Batches always use process_vm_readv.
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return read_batch(_handle.get(), requests, count);
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return read_batch(_handle.get(), requests, count, ec);
+        }
+
+        /// \brief Overwrites the memory range [address; address + size] with the contents of given buffer.
+        ///        Writes below the threshold that fail because of page protection are retried through
+        ///        /proc/<pid>/mem.
+        /// \throw Throws an std::system_error on failure or std::range_error on partial copy.
+        template<typename T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size) const
+        {
+            std::error_code ec;
+            write(address, buffer, size, ec);
+            if (ec == std::errc::result_out_of_range)
+                throw std::range_error("pwrite() wrote less than requested");
+            else if (ec)
+                throw std::system_error(ec, "pwrite() failed");
+        }
+
+        template<class T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            std::error_code vm_ec;
+            const auto      retry = !use_procmem(static_cast<std::size_t>(size));
+            if (retry) {
+                write_memory(_handle.get(), address, buffer, size, vm_ec);
+                if (vm_ec != std::errc::bad_address) {
+                    ec = vm_ec;
+                    return;
+                }
+            }
+
+            const auto written = detail::procmem_write(_fd.get(), jm::detail::pointer_cast<std::uintptr_t>(address)
+                                                       , buffer, static_cast<std::size_t>(size), ec);
+            // a retry that failed as well reports why the first attempt failed
+            if (ec && retry)
+                ec = vm_ec;
+            else if (!ec && written < static_cast<std::size_t>(size))
+                ec = std::make_error_code(std::errc::result_out_of_range);
+        }
+
+        /// \brief Refer to remote::write_batch. Batches always use process_vm_writev.
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return write_batch(_handle.get(), requests, count);
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return write_batch(_handle.get(), requests, count, ec);
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017 Justas Masiulis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REMOTE_MEMORY_REGION_CHECKED_OPERATIONS_POLICY_HPP
+#define REMOTE_MEMORY_REGION_CHECKED_OPERATIONS_POLICY_HPP
+
+#include "operations_policy.hpp"
+#include "region_map.hpp"
+#include <new>
+#include <vector>
+
+namespace remote {
+
+    /// \brief Operations policy decorator that rejects transfers touching memory which is not mapped
+    ///        according to a region_map before making a system call.
+    ///        Rejected transfers fail with std::errc::bad_address.
+    /// \note The region map is not refreshed automatically - call region_map::refresh when the target
+    ///       may have changed its mappings.
+    template<class OperationsPolicy = operations_policy>
+    class region_checked_operations_policy : public OperationsPolicy {
+        const region_map* _regions;
+
+        [[noreturn]] static void throw_unmapped()
+        {
+            throw std::system_error(std::make_error_code(std::errc::bad_address), "address is not mapped");
+        }
+
+        template<class Request>
+        struct scratch_t {
+            std::vector<Request>     requests;
+            std::vector<std::size_t> indices;
+        };
+
+        template<class Request>
+        static scratch_t<Request>& scratch()
+        {
+            thread_local scratch_t<Request> s;
+            return s;
+        }
+
+        // only the mapped requests are handed to the underlying policy
+        template<class Request, class Transfer>
+        std::size_t checked_many(Request* requests, std::size_t count, std::uint8_t permissions
+                                 , Transfer transfer) const
+        {
+            auto& mapped = scratch<Request>();
+            mapped.requests.clear();
+            mapped.indices.clear();
+            for (std::size_t i = 0; i < count; ++i) {
+                requests[i].transferred = 0;
+                if (_regions->contains(requests[i].address, requests[i].size, permissions)) {
+                    mapped.requests.push_back(requests[i]);
+                    mapped.indices.push_back(i);
+                }
+            }
+
+            const auto succeeded = transfer(mapped.requests.data(), mapped.requests.size());
+            for (std::size_t i = 0; i < mapped.indices.size(); ++i)
+                requests[mapped.indices[i]].transferred = mapped.requests[i].transferred;
+
+            return succeeded;
+        }
+
+        // the error_code overloads are noexcept. With room for every request reserved up front the batch
+        // itself can not throw and a reservation that fails fails the whole batch
+        template<class Request, class Transfer>
+        std::size_t checked_many(Request* requests, std::size_t count, std::uint8_t permissions, Transfer transfer
+                                 , std::error_code& ec) const noexcept
+        {
+            auto& mapped = scratch<Request>();
+            try {
+                mapped.requests.reserve(count);
+                mapped.indices.reserve(count);
+            }
+            catch (const std::bad_alloc&) {
+                for (std::size_t i = 0; i < count; ++i)
+                    requests[i].transferred = 0;
+
+                ec = std::make_error_code(std::errc::not_enough_memory);
+                return 0;
+            }
+
+            return checked_many(requests, count, permissions, transfer);
+        }
+
+    public:
+        /// \param regions The region map to check against. It must outlive the policy.
+        /// \param args The arguments forwarded to the underlying policy.
+        template<class... Args>
+        explicit region_checked_operations_policy(const region_map& regions, Args&&... args)
+                : OperationsPolicy(std::forward<Args>(args)...), _regions(&regions)
+        {}
+
+        const region_map& regions() const noexcept { return *_regions; }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size) const
+        {
+            if (!_regions->contains(address, static_cast<std::size_t>(size), protection::read))
+                throw_unmapped();
+
+            OperationsPolicy::read(address, buffer, size);
+        }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            if (!_regions->contains(address, static_cast<std::size_t>(size), protection::read))
+                ec = std::make_error_code(std::errc::bad_address);
+            else
+                OperationsPolicy::read(address, buffer, size, ec);
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return checked_many(requests, count, protection::read, [this](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n);
+            });
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return checked_many(requests, count, protection::read, [this, &ec](read_request* r, std::size_t n) {
+                return OperationsPolicy::read_many(r, n, ec);
+            }, ec);
+        }
+
+        // writes only require the memory to be mapped since some policies can write read only pages
+        template<typename T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size) const
+        {
+            if (!_regions->contains(address, static_cast<std::size_t>(size), protection::none))
+                throw_unmapped();
+
+            OperationsPolicy::write(address, buffer, size);
+        }
+
+        template<class T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            if (!_regions->contains(address, static_cast<std::size_t>(size), protection::none))
+                ec = std::make_error_code(std::errc::bad_address);
+            else
+                OperationsPolicy::write(address, buffer, size, ec);
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return checked_many(requests, count, protection::none, [this](write_request* r, std::size_t n) {
+                return OperationsPolicy::write_many(r, n);
+            });
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return checked_many(requests, count, protection::none, [this, &ec](write_request* r, std::size_t n) {
+                return OperationsPolicy::write_many(r, n, ec);
+            }, ec);
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,362 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_REGION_MAP_HPP
+#define REMOTE_MEMORY_REGION_MAP_HPP
+
+#if !defined(__linux__)
+    #error region_map is only available on linux
+#endif
+
+#include "native_types.hpp"
+#include "detail/utils.hpp"
+#include "detail/linux/maps_parser.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace remote {
+
+    /// \brief Permission bits of a memory region.
+    struct protection {
+        enum : std::uint8_t {
+            none    = 0,
+            read    = 1 << 0,
+            write   = 1 << 1,
+            execute = 1 << 2,
+            shared  = 1 << 3
+        };
+    };
+
+    /// \brief A single mapping of the target process as described by /proc/<pid>/maps.
+    struct region {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::uint64_t  offset;
+        std::uint64_t  inode;
+        std::uint32_t  device_major;
+        std::uint32_t  device_minor;
+        std::uint8_t   permissions;
+        /// the backing file or pseudo path such as [heap]. Empty for anonymous mappings.
+        const char*    path;
+
+        std::size_t size() const noexcept { return end - begin; }
+
+        bool readable() const noexcept { return (permissions & protection::read) != 0; }
+        bool writable() const noexcept { return (permissions & protection::write) != 0; }
+        bool executable() const noexcept { return (permissions & protection::execute) != 0; }
+        bool shared() const noexcept { return (permissions & protection::shared) != 0; }
+
+        /// \brief Whether the region is not backed by a file.
+        bool anonymous() const noexcept { return inode == 0; }
+
+        bool contains(std::uintptr_t address) const noexcept { return address >= begin && address < end; }
+    };
+
+    /// \brief Predicate selecting regions by permissions and backing.
+    struct region_filter {
+        enum backing_t : std::uint8_t { any, anonymous, file_backed };
+
+        /// every one of these permissions must be present
+        std::uint8_t required = protection::none;
+        /// none of these permissions may be present
+        std::uint8_t excluded = protection::none;
+        backing_t    backing  = any;
+
+        bool operator()(const region& r) const noexcept
+        {
+            if ((r.permissions & required) != required || (r.permissions & excluded) != 0)
+                return false;
+
+            switch (backing) {
+            case anonymous: return r.anonymous();
+            case file_backed: return !r.anonymous();
+            default: return true;
+            }
+        }
+    };
+
+    /// \brief Sorted index of the memory regions of a process built from /proc/<pid>/maps.
+    ///        Region bounds are stored separately from the rest of the information so that lookups
+    ///        only binary search a flat array of addresses.
+    class region_map {
+        struct info {
+            std::uint64_t offset;
+            std::uint64_t inode;
+            std::uint32_t device_major;
+            std::uint32_t device_minor;
+            std::uint8_t  permissions;
+            std::uint32_t path;
+        };
+
+        pid_t                       _pid;
+        std::vector<std::uintptr_t> _begins;
+        std::vector<std::uintptr_t> _ends;
+        std::vector<info>           _info;
+
+        // paths are interned and kept across refreshes - a deque never moves its elements
+        std::deque<std::string>                        _paths;
+        std::unordered_map<std::string, std::uint32_t> _path_ids;
+
+        std::string   _raw;
+        std::string   _scratch;
+        std::uint64_t _generation = 0;
+
+        std::uint32_t intern(const char* path, std::size_t length)
+        {
+            _scratch.assign(path, length);
+            const auto found = _path_ids.find(_scratch);
+            if (found != _path_ids.end())
+                return found->second;
+
+            const auto id = static_cast<std::uint32_t>(_paths.size());
+            _paths.push_back(_scratch);
+            _path_ids.emplace(_scratch, id);
+            return id;
+        }
+
+        void parse()
+        {
+            _begins.clear();
+            _ends.clear();
+            _info.clear();
+
+            detail::maps_parser parser(_raw.data(), _raw.data() + _raw.size());
+            detail::maps_line   line;
+            while (parser.next(line)) {
+                _begins.push_back(line.begin);
+                _ends.push_back(line.end);
+                _info.push_back({line.offset
+                                 , line.inode
+                                 , line.device_major
+                                 , line.device_minor
+                                 , line.permissions
+                                 , intern(line.path, line.path_length)});
+            }
+        }
+
+    public:
+        class const_iterator {
+            const region_map* _map;
+            std::size_t       _index;
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type        = region;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = void;
+            using reference         = region;
+
+            const_iterator(const region_map* map, std::size_t index) noexcept : _map(map), _index(index) {}
+
+            region operator*() const noexcept { return (*_map)[_index]; }
+            region operator[](difference_type n) const noexcept { return (*_map)[_index + n]; }
+
+            const_iterator& operator++() noexcept { ++_index; return *this; }
+            const_iterator& operator--() noexcept { --_index; return *this; }
+            const_iterator operator++(int) noexcept { return {_map, _index++}; }
+            const_iterator operator--(int) noexcept { return {_map, _index--}; }
+            const_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+            const_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+            const_iterator operator+(difference_type n) const noexcept { return {_map, _index + n}; }
+            const_iterator operator-(difference_type n) const noexcept { return {_map, _index - n}; }
+            difference_type operator-(const_iterator other) const noexcept
+            {
+                return static_cast<difference_type>(_index) - static_cast<difference_type>(other._index);
+            }
+
+            bool operator==(const_iterator other) const noexcept { return _index == other._index; }
+            bool operator!=(const_iterator other) const noexcept { return _index != other._index; }
+            bool operator<(const_iterator other) const noexcept { return _index < other._index; }
+
+            std::size_t index() const noexcept { return _index; }
+        };
+
+        template<class Predicate>
+        class filtered_range {
+            const region_map* _map;
+            Predicate         _predicate;
+
+        public:
+            class iterator {
+                const filtered_range* _range;
+                std::size_t           _index;
+
+                void skip() noexcept
+                {
+                    const auto& map = *_range->_map;
+                    while (_index < map.size() && !_range->_predicate(map[_index]))
+                        ++_index;
+                }
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type        = region;
+                using difference_type   = std::ptrdiff_t;
+                using pointer           = void;
+                using reference         = region;
+
+                iterator(const filtered_range* range, std::size_t index) noexcept : _range(range), _index(index)
+                {
+                    skip();
+                }
+
+                region operator*() const noexcept { return (*_range->_map)[_index]; }
+
+                iterator& operator++() noexcept
+                {
+                    ++_index;
+                    skip();
+                    return *this;
+                }
+                iterator operator++(int) noexcept
+                {
+                    auto copy = *this;
+                    ++*this;
+                    return copy;
+                }
+
+                bool operator==(const iterator& other) const noexcept { return _index == other._index; }
+                bool operator!=(const iterator& other) const noexcept { return _index != other._index; }
+            };
+
+            filtered_range(const region_map* map, Predicate predicate) : _map(map), _predicate(std::move(predicate))
+            {}
+
+            iterator begin() const noexcept { return {this, 0}; }
+            iterator end() const noexcept { return {this, _map->size()}; }
+        };
+
+        /// \brief Builds the region map of the current process.
+        region_map() : region_map(::getpid()) {}
+
+        /// \brief Builds the region map of the given process.
+        /// \throw Throws an std::system_error if /proc/<pid>/maps could not be read.
+        explicit region_map(pid_t pid) : _pid(pid) { refresh(); }
+
+        /// \brief Builds the region map of the given process.
+        /// \param ec The error code that will be set if /proc/<pid>/maps could not be read.
+        region_map(pid_t pid, std::error_code& ec) : _pid(pid) { refresh(ec); }
+
+        /// \brief Re-reads /proc/<pid>/maps. Nothing is re-parsed if the mappings did not change
+        ///        and paths seen before are reused.
+        /// \return Whether the mappings changed.
+        /// \throw Throws an std::system_error on failure.
+        bool refresh()
+        {
+            std::error_code ec;
+            const auto changed = refresh(ec);
+            if (ec)
+                throw std::system_error(ec, "reading /proc/<pid>/maps failed");
+
+            return changed;
+        }
+
+        bool refresh(std::error_code& ec)
+        {
+            if (!detail::read_maps(_pid, _scratch, ec))
+                return false;
+
+            if (_generation != 0 && _scratch == _raw)
+                return false;
+
+            _raw.swap(_scratch);
+            parse();
+            ++_generation;
+            return true;
+        }
+
+        /// \brief Incremented every time a refresh observes changed mappings.
+        std::uint64_t generation() const noexcept { return _generation; }
+
+        pid_t pid() const noexcept { return _pid; }
+
+        std::size_t size() const noexcept { return _begins.size(); }
+        bool empty() const noexcept { return _begins.empty(); }
+
+        region operator[](std::size_t index) const noexcept
+        {
+            const auto& i = _info[index];
+            return {_begins[index]
+                    , _ends[index]
+                    , i.offset
+                    , i.inode
+                    , i.device_major
+                    , i.device_minor
+                    , i.permissions
+                    , _paths[i.path].c_str()};
+        }
+
+        const_iterator begin() const noexcept { return {this, 0}; }
+        const_iterator end() const noexcept { return {this, size()}; }
+
+        /// \brief Finds the region containing address in O(log n).
+        /// \return The iterator to the region or end() if the address is not mapped.
+        template<class Address>
+        const_iterator find(Address address) const noexcept(!jm::detail::checked_pointers)
+        {
+            const auto addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto next = std::upper_bound(_begins.begin(), _begins.end(), addr);
+            if (next == _begins.begin())
+                return end();
+
+            const auto index = static_cast<std::size_t>(next - _begins.begin()) - 1;
+            return addr < _ends[index] ? const_iterator{this, index} : end();
+        }
+
+        /// \brief Checks whether every byte of [address; address + size] is mapped
+        ///        with at least the given permissions. The range may span adjacent regions.
+        template<class Address>
+        bool contains(Address address, std::size_t size, std::uint8_t permissions = protection::read) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            auto       it   = find(address);
+            auto       addr = jm::detail::pointer_cast<std::uintptr_t>(address);
+            const auto last = addr + size;
+            if (last < addr)
+                return false;
+
+            for (; it != end(); ++it) {
+                const auto i = it.index();
+                if (_begins[i] > addr)
+                    return false;
+                if ((_info[i].permissions & permissions) != permissions)
+                    return false;
+                if (last <= _ends[i])
+                    return true;
+
+                addr = _ends[i];
+            }
+
+            return false;
+        }
+
+        /// \brief Returns a range of the regions for which predicate returns true.
+        /// \code for (auto r : regions.filter(region_filter{protection::read | protection::write}))
+        template<class Predicate>
+        filtered_range<Predicate> filter(Predicate predicate) const
+        {
+            return {this, std::move(predicate)};
+        }
+    };
+
+} // namespace remote
+
+#endif // include guard
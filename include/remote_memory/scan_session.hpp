@@ -0,0 +1,399 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_SCAN_SESSION_HPP
+#define REMOTE_MEMORY_SCAN_SESSION_HPP
+
+#include "read_batch.hpp"
+#include "detail/simd.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#ifndef REMOTE_MEMORY_SCAN_CHUNK_SIZE
+    #define REMOTE_MEMORY_SCAN_CHUNK_SIZE (1024 * 1024)
+#endif
+
+namespace remote {
+
+    /// \brief The condition a value has to satisfy to stay a candidate.
+    ///        a and b refer to the arguments of scan_session::first_scan / next_scan.
+    enum class scan_condition {
+        any,        ///< every value. Used for a first scan of an unknown value
+        equal,      ///< value == a
+        not_equal,  ///< value != a
+        greater,    ///< value > a
+        less,       ///< value < a
+        in_range,   ///< a <= value <= b
+        changed,    ///< value != previous value
+        unchanged,  ///< value == previous value
+        increased,  ///< value > previous value
+        decreased   ///< value < previous value
+    };
+
+    /// \brief Narrows down the addresses holding a value over repeated scans.
+    ///
+    ///        Candidates are grouped into 4 KiB blocks. A block with many candidates stores them as a bitmap,
+    ///        one with few as sorted varint encoded deltas between candidate slots. Only blocks that hold
+    ///        candidates are stored, so memory use and the time of a next scan are proportional to the number
+    ///        of candidates. A next scan re-reads only the candidate blocks using batched reads.
+    ///
+    /// \tparam T An arithmetic type. Values are expected at addresses aligned to sizeof(T).
+    /// \tparam Memory The type providing read_many such as remote::memory.
+    template<class T, class Memory>
+    class scan_session {
+        static_assert(std::is_arithmetic<T>::value, "scan_session only supports arithmetic types");
+        static_assert(sizeof(T) == alignof(T), "the size of the type must equal its alignment");
+
+    public:
+        static constexpr std::size_t block_size  = 4096;
+        static constexpr std::size_t block_slots = block_size / sizeof(T);
+
+    private:
+        static constexpr std::size_t bitmap_words = (block_slots + 63) / 64;
+
+        struct block {
+            std::uintptr_t address;
+            // index of the first bitmap word if dense, otherwise of the first delta byte
+            std::size_t    encoding;
+            std::uint32_t  count;
+            bool           dense;
+        };
+
+        struct storage {
+            std::vector<block>         blocks;
+            std::vector<std::uint64_t> bitmaps;
+            std::vector<std::uint8_t>  deltas;
+            std::vector<T>             values;
+
+            void clear()
+            {
+                blocks.clear();
+                bitmaps.clear();
+                deltas.clear();
+                values.clear();
+            }
+
+            /// \brief Appends a block whose candidate slots are the set bits of bits. values holds one value
+            ///        per candidate in slot order.
+            void add(std::uintptr_t address, const std::uint64_t* bits, std::uint32_t count)
+            {
+                if (count == 0)
+                    return;
+
+                // a bitmap costs block_slots / 8 bytes, the deltas roughly one or two bytes per candidate
+                const bool dense = count * 2 >= block_slots / 8;
+                if (dense) {
+                    blocks.push_back({address, bitmaps.size(), count, true});
+                    bitmaps.insert(bitmaps.end(), bits, bits + bitmap_words);
+                    return;
+                }
+
+                blocks.push_back({address, deltas.size(), count, false});
+                std::size_t previous = 0;
+                for (std::size_t w = 0; w < bitmap_words; ++w)
+                    for (auto word = bits[w]; word; word &= word - 1) {
+                        const auto slot = w * 64 + detail::lowest_bit(word);
+                        for (auto delta = slot - previous;; delta >>= 7) {
+                            if (delta < 0x80) {
+                                deltas.push_back(static_cast<std::uint8_t>(delta));
+                                break;
+                            }
+                            deltas.push_back(static_cast<std::uint8_t>(delta | 0x80));
+                        }
+                        previous = slot;
+                    }
+            }
+
+            /// \brief Calls fn(slot) for every candidate slot of b in ascending order.
+            template<class Fn>
+            void for_each_slot(const block& b, Fn fn) const
+            {
+                if (b.dense) {
+                    const auto bits = bitmaps.data() + b.encoding;
+                    for (std::size_t w = 0; w < bitmap_words; ++w)
+                        for (auto word = bits[w]; word; word &= word - 1)
+                            fn(w * 64 + detail::lowest_bit(word));
+                    return;
+                }
+
+                auto        data = deltas.data() + b.encoding;
+                std::size_t slot = 0;
+                for (std::uint32_t i = 0; i < b.count; ++i) {
+                    std::size_t delta = 0;
+                    for (unsigned shift = 0;; shift += 7) {
+                        const auto byte = *data++;
+                        delta |= static_cast<std::size_t>(byte & 0x7F) << shift;
+                        if (!(byte & 0x80))
+                            break;
+                    }
+                    slot += delta;
+                    fn(slot);
+                }
+            }
+
+            std::size_t memory_usage() const noexcept
+            {
+                return blocks.capacity() * sizeof(block) + bitmaps.capacity() * sizeof(std::uint64_t)
+                       + deltas.capacity() + values.capacity() * sizeof(T);
+            }
+        };
+
+        const Memory* _memory;
+        std::size_t   _chunk_size;
+        storage       _current;
+        storage       _next;
+        std::size_t   _count = 0;
+
+        // instantiates the scan once per condition so the inner loops have no branches on it
+        template<class Scan>
+        static void dispatch(scan_condition condition, T a, T b, Scan&& scan)
+        {
+            switch (condition) {
+            case scan_condition::any: return scan([](T, T) { return true; });
+            case scan_condition::equal: return scan([a](T v, T) { return v == a; });
+            case scan_condition::not_equal: return scan([a](T v, T) { return v != a; });
+            case scan_condition::greater: return scan([a](T v, T) { return v > a; });
+            case scan_condition::less: return scan([a](T v, T) { return v < a; });
+            case scan_condition::in_range: return scan([a, b](T v, T) { return v >= a && v <= b; });
+            case scan_condition::changed: return scan([](T v, T p) { return v != p; });
+            case scan_condition::unchanged: return scan([](T v, T p) { return v == p; });
+            case scan_condition::increased: return scan([](T v, T p) { return v > p; });
+            case scan_condition::decreased: return scan([](T v, T p) { return v < p; });
+            }
+        }
+
+        static bool relative(scan_condition condition) noexcept
+        {
+            return condition >= scan_condition::changed;
+        }
+
+        // evaluates the values of one block in [first_slot; first_slot + count) and adds it to the storage
+        template<class Test>
+        static void first_scan_block(storage& out, std::uintptr_t block_address, std::size_t first_slot
+                                     , const T* values, std::size_t count, Test& test)
+        {
+            std::uint64_t bits[bitmap_words] = {};
+            std::uint8_t  matches[block_slots];
+
+            // branchless so the compiler can vectorize the comparisons
+            for (std::size_t i = 0; i < count; ++i)
+                matches[i] = test(values[i], T{}) ? 1 : 0;
+
+            std::uint32_t found = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!matches[i])
+                    continue;
+
+                const auto slot = first_slot + i;
+                bits[slot / 64] |= std::uint64_t{1} << (slot % 64);
+                out.values.push_back(values[i]);
+                ++found;
+            }
+
+            out.add(block_address, bits, found);
+        }
+
+    public:
+        /// \param memory The memory to read through. It must outlive the session.
+        /// \param chunk_size The amount of memory read at once during a first scan.
+        explicit scan_session(const Memory& memory, std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE)
+                : _memory(&memory), _chunk_size(std::max<std::size_t>(chunk_size / block_size, 1) * block_size)
+        {}
+
+        /// \brief The number of remaining candidates.
+        std::size_t size() const noexcept { return _count; }
+        bool empty() const noexcept { return _count == 0; }
+
+        /// \brief The number of bytes used to store the candidates.
+        std::size_t memory_usage() const noexcept { return _current.memory_usage() + _next.memory_usage(); }
+
+        /// \brief Scans every sizeof(T) aligned value of the regions and keeps the ones satisfying the condition.
+        ///        Any previous candidates are discarded. Unreadable memory is skipped.
+        /// \param regions Range of objects with begin and end members, such as region_map::filter(...).
+        /// \return The number of candidates.
+        /// \throw Throws an std::invalid_argument for conditions relative to a previous value.
+        template<class Regions>
+        std::size_t first_scan(const Regions& regions, scan_condition condition, T a = T{}, T b = T{})
+        {
+            if (relative(condition))
+                throw std::invalid_argument("the first scan has no previous values to compare to");
+
+            _current.clear();
+            std::vector<T> buffer(_chunk_size / sizeof(T));
+            dispatch(condition, a, b, [&](auto test) {
+                for (const auto& r : regions) {
+                    auto address = (static_cast<std::uintptr_t>(r.begin) + sizeof(T) - 1) & ~(sizeof(T) - 1);
+                    while (address + sizeof(T) <= r.end) {
+                        const auto size = std::min<std::uintptr_t>(_chunk_size - address % block_size
+                                                                   , (r.end - address) & ~(sizeof(T) - 1));
+                        read_request request(address, buffer.data(), static_cast<std::size_t>(size));
+                        _memory->read_many(&request, 1);
+
+                        const auto valid = request.transferred / sizeof(T);
+                        for (std::size_t i = 0; i < valid;) {
+                            const auto value_address = address + i * sizeof(T);
+                            const auto block_address = value_address & ~(block_size - 1);
+                            const auto first_slot    = (value_address - block_address) / sizeof(T);
+                            const auto count         = std::min(block_slots - first_slot, valid - i);
+                            first_scan_block(_current, block_address, first_slot, buffer.data() + i, count, test);
+                            i += count;
+                        }
+
+                        // skip the block that stopped the read
+                        address = request.succeeded()
+                                  ? address + size
+                                  : ((address + request.transferred) & ~(block_size - 1)) + block_size;
+                    }
+                }
+            });
+
+            _count = _current.values.size();
+            return _count;
+        }
+
+        /// \brief Re-reads every candidate and keeps the ones satisfying the condition.
+        ///        Candidates that can no longer be read are dropped.
+        /// \return The number of remaining candidates.
+        std::size_t next_scan(scan_condition condition, T a = T{}, T b = T{})
+        {
+            // reads are issued for batches of blocks so the new values never need more than a chunk of memory
+            constexpr std::size_t max_batch_requests = 4096;
+
+            _next.clear();
+            std::vector<read_request> requests;
+            std::vector<T>            fresh;
+            std::vector<std::size_t>  block_requests;
+
+            dispatch(condition, a, b, [&](auto test) {
+                std::size_t value_index = 0;
+                fresh.resize(std::max(_chunk_size / sizeof(T), block_slots));
+                for (std::size_t first = 0; first < _current.blocks.size();) {
+                    requests.clear();
+                    block_requests.clear();
+
+                    // dense blocks read the span between their first and last candidate in one request,
+                    // sparse ones read each candidate on its own
+                    std::size_t last = first, fresh_used = 0;
+                    for (; last < _current.blocks.size() && requests.size() < max_batch_requests
+                           && fresh_used + block_slots <= fresh.size(); ++last) {
+                        const auto& b = _current.blocks[last];
+                        block_requests.push_back(requests.size());
+                        if (b.dense) {
+                            std::size_t low = block_slots, high = 0;
+                            _current.for_each_slot(b, [&](std::size_t slot) {
+                                low  = std::min(low, slot);
+                                high = slot;
+                            });
+                            requests.emplace_back(b.address + low * sizeof(T), fresh.data() + fresh_used
+                                                  , (high - low + 1) * sizeof(T));
+                            fresh_used += high - low + 1;
+                        }
+                        else
+                            _current.for_each_slot(b, [&](std::size_t slot) {
+                                requests.emplace_back(b.address + slot * sizeof(T), fresh.data() + fresh_used++);
+                            });
+                    }
+
+                    _memory->read_many(requests.data(), requests.size());
+
+                    for (auto i = first; i < last; ++i) {
+                        const auto&   b       = _current.blocks[i];
+                        auto          request = requests.data() + block_requests[i - first];
+                        std::uint64_t bits[bitmap_words] = {};
+                        std::uint32_t found   = 0;
+                        std::size_t   low     = 0;
+                        bool          first_slot = true;
+
+                        _current.for_each_slot(b, [&](std::size_t slot) {
+                            const auto previous = _current.values[value_index++];
+                            const T*   value;
+                            if (b.dense) {
+                                if (first_slot)
+                                    low = slot;
+                                first_slot = false;
+
+                                if (!request->succeeded())
+                                    return;
+                                value = static_cast<const T*>(request->buffer) + (slot - low);
+                            }
+                            else {
+                                const auto r = request++;
+                                if (!r->succeeded())
+                                    return;
+                                value = static_cast<const T*>(r->buffer);
+                            }
+
+                            if (test(*value, previous)) {
+                                bits[slot / 64] |= std::uint64_t{1} << (slot % 64);
+                                _next.values.push_back(*value);
+                                ++found;
+                            }
+                        });
+
+                        _next.add(b.address, bits, found);
+                    }
+
+                    first = last;
+                }
+            });
+
+            std::swap(_current, _next);
+            _next.clear();
+            _count = _current.values.size();
+            return _count;
+        }
+
+        /// \brief Calls fn(address, value) for every candidate in ascending address order.
+        ///        value is the one read by the last scan.
+        template<class Fn>
+        void for_each(Fn fn) const
+        {
+            std::size_t value_index = 0;
+            for (const auto& b : _current.blocks)
+                _current.for_each_slot(b, [&](std::size_t slot) {
+                    fn(b.address + slot * sizeof(T), _current.values[value_index++]);
+                });
+        }
+
+        /// \brief The addresses of every candidate in ascending order.
+        std::vector<std::uintptr_t> addresses() const
+        {
+            std::vector<std::uintptr_t> result;
+            result.reserve(_count);
+            for_each([&](std::uintptr_t address, T) { result.push_back(address); });
+            return result;
+        }
+    };
+
+    template<class T, class Memory>
+    constexpr std::size_t scan_session<T, Memory>::block_size;
+
+    template<class T, class Memory>
+    constexpr std::size_t scan_session<T, Memory>::block_slots;
+
+    /// \brief Creates a scan_session for values of type T reading through memory.
+    template<class T, class Memory>
+    inline scan_session<T, Memory> make_scan_session(const Memory& memory)
+    {
+        return scan_session<T, Memory>(memory);
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,321 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_SNAPSHOT_HPP
+#define REMOTE_MEMORY_SNAPSHOT_HPP
+
+#include "read_batch.hpp"
+#include "detail/diff_kernels.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// the amount of remote memory read at once while capturing or comparing
+#ifndef REMOTE_MEMORY_SCAN_CHUNK_SIZE
+    #define REMOTE_MEMORY_SCAN_CHUNK_SIZE (1024 * 1024)
+#endif
+
+namespace remote {
+
+    /// \brief A range of remote memory [address; address + size].
+    struct changed_range {
+        std::uintptr_t address;
+        std::size_t    size;
+
+        friend bool operator==(const changed_range& a, const changed_range& b) noexcept
+        {
+            return a.address == b.address && a.size == b.size;
+        }
+    };
+
+    /// \brief A local copy of chosen remote memory ranges.
+    ///        The data is read straight into one page aligned store where every range keeps the page offset of
+    ///        its remote address, so pages of the copy line up with remote pages.
+    ///        Memory that can not be read is left out of the snapshot.
+    class snapshot {
+    public:
+        static constexpr std::size_t page_size = 4096;
+
+        /// \brief A captured range. Its data is at data() + offset.
+        struct range {
+            std::uintptr_t address;
+            std::size_t    size;
+            std::size_t    offset;
+        };
+
+    private:
+        struct free_deleter {
+            void operator()(void* p) const noexcept { std::free(p); }
+        };
+
+        std::unique_ptr<void, free_deleter> _allocation;
+        std::uint8_t*                       _data     = nullptr;
+        std::size_t                         _capacity = 0;
+        std::size_t                         _size     = 0;
+        std::vector<range>                  _ranges;
+
+        static std::size_t align_up(std::size_t value) noexcept { return (value + page_size - 1) & ~(page_size - 1); }
+
+        void reserve(std::size_t capacity)
+        {
+            if (capacity <= _capacity)
+                return;
+
+            _allocation.reset(std::malloc(capacity + page_size));
+            if (!_allocation)
+                throw std::bad_alloc();
+
+            _data     = reinterpret_cast<std::uint8_t*>(align_up(reinterpret_cast<std::uintptr_t>(_allocation.get())));
+            _capacity = capacity;
+        }
+
+        template<class Memory>
+        void capture_range(const Memory& memory, std::uintptr_t begin, std::uintptr_t end, std::size_t& cursor
+                           , std::size_t chunk_size)
+        {
+            cursor = align_up(cursor) + (begin & (page_size - 1));
+
+            bool extend = false;
+            for (auto address = begin; address < end;) {
+                const auto   size   = static_cast<std::size_t>(std::min<std::uintptr_t>(chunk_size, end - address));
+                const auto   offset = cursor + (address - begin);
+                read_request request(address, _data + offset, size);
+                memory.read_many(&request, 1);
+
+                if (request.transferred != 0) {
+                    if (extend)
+                        _ranges.back().size += request.transferred;
+                    else
+                        _ranges.push_back({address, request.transferred, offset});
+
+                    _size += request.transferred;
+                }
+
+                if (request.succeeded()) {
+                    extend = true;
+                    address += size;
+                }
+                else {
+                    // skip the page that stopped the read
+                    extend  = false;
+                    address = (address + request.transferred + page_size) & ~std::uintptr_t{page_size - 1};
+                }
+            }
+
+            cursor += end - begin;
+        }
+
+    public:
+        snapshot() = default;
+
+        /// \brief Replaces the contents of the snapshot with the regions. The store is reused if it is large enough.
+        /// \param regions Range of objects with begin and end members, such as region_map::filter(...).
+        /// \throw Throws if the underlying read_many throws, for example if the process no longer exists.
+        template<class Memory, class Regions>
+        void capture(const Memory& memory, const Regions& regions
+                     , std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE)
+        {
+            std::size_t capacity = 0;
+            for (const auto& r : regions)
+                capacity = align_up(capacity) + (r.begin & (page_size - 1)) + (r.end - r.begin);
+
+            _ranges.clear();
+            _size = 0;
+            reserve(capacity);
+
+            std::size_t cursor = 0;
+            for (const auto& r : regions)
+                capture_range(memory, r.begin, r.end, cursor, chunk_size);
+
+            std::sort(_ranges.begin(), _ranges.end(), [](const range& a, const range& b) {
+                return a.address < b.address;
+            });
+        }
+
+        /// \brief Replaces the contents of the snapshot with the remote range [begin; end).
+        template<class Memory>
+        void capture(const Memory& memory, std::uintptr_t begin, std::uintptr_t end
+                     , std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE)
+        {
+            struct single {
+                std::uintptr_t begin;
+                std::uintptr_t end;
+            };
+            const single regions[] = {{begin, end}};
+            capture(memory, regions, chunk_size);
+        }
+
+        /// \brief Reads the parts of ranges that the snapshot holds again, in place and with a single read_many.
+        /// \param ranges The ranges to read in ascending order, for example the pages that changed since the capture.
+        /// \return The number of bytes read.
+        /// \throw Throws if the underlying read_many throws.
+        template<class Memory>
+        std::size_t recapture(const Memory& memory, const changed_range* ranges, std::size_t count)
+        {
+            std::vector<read_request> requests;
+            auto                      it = _ranges.begin();
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto begin = ranges[i].address;
+                const auto end   = begin + ranges[i].size;
+                it = std::upper_bound(it, _ranges.end(), begin
+                                      , [](std::uintptr_t a, const range& r) { return a < r.address; });
+                if (it != _ranges.begin())
+                    --it;
+
+                for (; it != _ranges.end() && it->address < end; ++it) {
+                    const auto from = std::max(begin, it->address);
+                    const auto to   = std::min(end, it->address + it->size);
+                    if (from < to)
+                        requests.emplace_back(from, _data + it->offset + (from - it->address), to - from);
+                }
+
+                // the next range may start in the same captured range
+                if (it != _ranges.begin())
+                    --it;
+            }
+
+            if (!requests.empty())
+                memory.read_many(requests.data(), requests.size());
+
+            std::size_t read = 0;
+            for (const auto& request : requests)
+                read += request.transferred;
+
+            return read;
+        }
+
+        template<class Memory>
+        std::size_t recapture(const Memory& memory, const std::vector<changed_range>& ranges)
+        {
+            return recapture(memory, ranges.data(), ranges.size());
+        }
+
+        /// \brief The captured ranges sorted by address.
+        const std::vector<range>& ranges() const noexcept { return _ranges; }
+
+        /// \brief The number of captured bytes.
+        std::size_t size() const noexcept { return _size; }
+
+        bool empty() const noexcept { return _size == 0; }
+
+        /// \brief The page aligned start of the store.
+        const std::uint8_t* data() const noexcept { return _data; }
+
+        /// \return The local copy of [address; address + size] or nullptr if it was not captured as a whole.
+        const std::uint8_t* find(std::uintptr_t address, std::size_t size = 1) const noexcept
+        {
+            auto it = std::upper_bound(_ranges.begin(), _ranges.end(), address
+                                       , [](std::uintptr_t a, const range& r) { return a < r.address; });
+            if (it == _ranges.begin())
+                return nullptr;
+
+            --it;
+            if (address - it->address > it->size || size > it->size - (address - it->address))
+                return nullptr;
+
+            return _data + it->offset + (address - it->address);
+        }
+    };
+
+    namespace detail {
+
+        // collects runs into ranges, merging runs that touch
+        struct changed_ranges_collector {
+            std::vector<changed_range>& out;
+            std::uintptr_t              base;
+
+            void operator()(std::size_t offset, std::size_t size)
+            {
+                const auto address = base + offset;
+                if (!out.empty() && out.back().address + out.back().size == address)
+                    out.back().size += size;
+                else
+                    out.push_back({address, size});
+            }
+        };
+
+    } // namespace detail
+
+    /// \brief Finds the bytes that differ between two snapshots. Only memory captured by both is compared.
+    /// \return The changed ranges in ascending order.
+    inline std::vector<changed_range> diff(const snapshot& before, const snapshot& after)
+    {
+        std::vector<changed_range> changes;
+        const auto&                a = before.ranges();
+        const auto&                b = after.ranges();
+        for (std::size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+            const auto begin = std::max(a[i].address, b[j].address);
+            const auto a_end = a[i].address + a[i].size;
+            const auto b_end = b[j].address + b[j].size;
+            const auto end   = std::min(a_end, b_end);
+            if (begin < end) {
+                detail::changed_ranges_collector collector{changes, begin};
+                detail::find_differences(before.data() + a[i].offset + (begin - a[i].address)
+                                         , after.data() + b[j].offset + (begin - b[j].address)
+                                         , end - begin
+                                         , collector);
+            }
+
+            if (a_end <= b_end)
+                ++i;
+            else
+                ++j;
+        }
+
+        return changes;
+    }
+
+    /// \brief Finds the bytes of a snapshot that differ from the current contents of remote memory.
+    ///        Memory that can no longer be read is reported as changed up to the end of its page.
+    /// \return The changed ranges in ascending order.
+    /// \throw Throws if the underlying read_many throws, for example if the process no longer exists.
+    template<class Memory>
+    inline std::vector<changed_range> diff(const snapshot& before, const Memory& live
+                                           , std::size_t chunk_size = REMOTE_MEMORY_SCAN_CHUNK_SIZE)
+    {
+        std::vector<changed_range> changes;
+        std::vector<std::uint8_t>  buffer(chunk_size);
+        for (const auto& r : before.ranges()) {
+            const auto end = r.address + r.size;
+            for (auto address = r.address; address < end;) {
+                const auto size = static_cast<std::size_t>(std::min<std::uintptr_t>(chunk_size, end - address));
+                read_request request(address, buffer.data(), size);
+                live.read_many(&request, 1);
+
+                detail::changed_ranges_collector collector{changes, address};
+                detail::find_differences(before.data() + r.offset + (address - r.address), buffer.data()
+                                         , request.transferred, collector);
+                if (request.succeeded()) {
+                    address += size;
+                    continue;
+                }
+
+                const auto unreadable = address + request.transferred;
+                address = std::min<std::uintptr_t>(end, (unreadable + snapshot::page_size)
+                                                        & ~std::uintptr_t{snapshot::page_size - 1});
+                collector.base = 0;
+                collector(unreadable, static_cast<std::size_t>(address - unreadable));
+            }
+        }
+
+        return changes;
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,134 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_STAGING_ARENA_HPP
+#define REMOTE_MEMORY_STAGING_ARENA_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+
+// reads up to this size are staged on the stack
+#ifndef REMOTE_MEMORY_STAGING_INLINE_SIZE
+    #define REMOTE_MEMORY_STAGING_INLINE_SIZE 256
+#endif
+
+// the largest size an arena will grow to. Bigger reads fall back to a one-off heap allocation
+#ifndef REMOTE_MEMORY_STAGING_ARENA_LIMIT
+    #define REMOTE_MEMORY_STAGING_ARENA_LIMIT (1024 * 1024)
+#endif
+
+namespace remote {
+
+    /// \brief A reusable buffer that safe reads stage their data in before copying it into the destination.
+    ///        Every thread has its own arena which is used by default, but one can also be passed explicitly
+    ///        to the read functions of remote::basic_memory.
+    /// \note An arena may only be used by one read at a time. Nested reads fall back to the heap.
+    class staging_arena {
+        std::unique_ptr<std::uint8_t[]> _data;
+        std::size_t                     _capacity = 0;
+        std::size_t                     _limit;
+        bool                            _in_use   = false;
+
+    public:
+        /// \param limit The largest size the arena is allowed to grow to.
+        explicit staging_arena(std::size_t limit = REMOTE_MEMORY_STAGING_ARENA_LIMIT) noexcept
+                : _limit(limit)
+        {}
+
+        staging_arena(const staging_arena&) = delete;
+        staging_arena& operator=(const staging_arena&) = delete;
+
+        /// \brief Grows the arena so that reads of up to size bytes do not allocate.
+        ///        Does nothing if size exceeds the limit of the arena.
+        void reserve(std::size_t size)
+        {
+            if (size <= _capacity || size > _limit)
+                return;
+
+            _data.reset(new std::uint8_t[size]);
+            _capacity = size;
+        }
+
+        /// \brief Returns a buffer of at least size bytes or nullptr if the arena is already in use
+        ///        or size is above its limit. The buffer must be given back using release().
+        std::uint8_t* acquire(std::size_t size)
+        {
+            if (_in_use || size > _limit)
+                return nullptr;
+
+            // grow geometrically so a slowly increasing read size does not reallocate every time
+            if (size > _capacity)
+                reserve(std::min(std::max(size, _capacity * 2), _limit));
+
+            _in_use = true;
+            return _data.get();
+        }
+
+        void release() noexcept { _in_use = false; }
+
+        std::size_t capacity() const noexcept { return _capacity; }
+        std::size_t limit() const noexcept { return _limit; }
+
+        /// \brief The arena used by reads of the calling thread when none is given explicitly.
+        static staging_arena& thread_local_arena() noexcept
+        {
+            thread_local staging_arena arena;
+            return arena;
+        }
+    };
+
+    namespace detail {
+
+        /// \brief Temporary storage of a safe read. Small sizes use inline storage, larger ones
+        ///        borrow the arena and only if that fails a heap allocation is made.
+        class staging_buffer {
+            alignas(std::max_align_t) std::uint8_t _inline[REMOTE_MEMORY_STAGING_INLINE_SIZE];
+            std::unique_ptr<std::uint8_t[]>        _heap;
+            staging_arena*                         _arena = nullptr;
+            std::uint8_t*                          _data;
+
+        public:
+            staging_buffer(std::size_t size, staging_arena& arena)
+            {
+                if (size <= sizeof(_inline))
+                    _data = _inline;
+                else if ((_data = arena.acquire(size)))
+                    _arena = &arena;
+                else {
+                    _heap.reset(new std::uint8_t[size]);
+                    _data = _heap.get();
+                }
+            }
+
+            ~staging_buffer()
+            {
+                if (_arena)
+                    _arena->release();
+            }
+
+            staging_buffer(const staging_buffer&) = delete;
+            staging_buffer& operator=(const staging_buffer&) = delete;
+
+            std::uint8_t* data() const noexcept { return _data; }
+        };
+
+    } // namespace detail
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,552 @@
+/*
+ * Copyright 2017 Justas Masiulis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REMOTE_MEMORY_STATS_OPERATIONS_POLICY_HPP
+#define REMOTE_MEMORY_STATS_OPERATIONS_POLICY_HPP
+
+#include "operations_policy.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#endif
+
+namespace remote {
+
+    /// \brief Histogram of latencies in nanoseconds with 4 linear buckets per power of two,
+    ///        so every bucket is at most 25% wide while the whole 64 bit range fits in 252 buckets.
+    class latency_histogram {
+    public:
+        enum : std::size_t { sub_buckets = 4, bucket_count = 63 * sub_buckets };
+
+        /// \brief The bucket holding a latency of ns nanoseconds.
+        static std::size_t bucket(std::uint64_t ns) noexcept
+        {
+            if (ns < sub_buckets)
+                return static_cast<std::size_t>(ns);
+
+            std::size_t exponent = 63;
+#if defined(__GNUC__) || defined(__clang__)
+            exponent -= static_cast<std::size_t>(__builtin_clzll(ns));
+#else
+            while (!(ns >> exponent))
+                --exponent;
+#endif
+            return (exponent - 1) * sub_buckets + static_cast<std::size_t>((ns >> (exponent - 2)) & (sub_buckets - 1));
+        }
+
+        /// \brief The smallest latency that falls into a bucket.
+        static std::uint64_t lower_bound(std::size_t bucket) noexcept
+        {
+            if (bucket < sub_buckets)
+                return bucket;
+
+            return std::uint64_t{sub_buckets + bucket % sub_buckets} << (bucket / sub_buckets - 1);
+        }
+
+        std::uint64_t count(std::size_t bucket) const noexcept { return _counts[bucket]; }
+
+        /// \brief The number of recorded latencies.
+        std::uint64_t total() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (auto count : _counts)
+                total += count;
+            return total;
+        }
+
+        /// \brief The lower bound of the bucket holding the given fraction of latencies, 0.99 for the 99th percentile.
+        std::uint64_t percentile(double fraction) const noexcept
+        {
+            const auto target = static_cast<std::uint64_t>(fraction * static_cast<double>(total()));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                seen += _counts[i];
+                if (seen > target)
+                    return lower_bound(i);
+            }
+
+            return 0;
+        }
+
+        void add(std::size_t bucket, std::uint64_t count) noexcept { _counts[bucket] += count; }
+
+    private:
+        std::array<std::uint64_t, bucket_count> _counts{};
+    };
+
+    /// \brief Counters of one kind of operation.
+    struct operation_statistics {
+        std::uint64_t     calls             = 0;
+        /// the number of ranges, which is 1 per call of read and write
+        std::uint64_t     requests          = 0;
+        std::uint64_t     bytes_requested   = 0;
+        /// bytes of partial reads and writes are only known for batches
+        std::uint64_t     bytes_transferred = 0;
+        /// calls that failed as a whole and requests of batches that transferred nothing
+        std::uint64_t     failures          = 0;
+        /// requests that transferred only a part of their range
+        std::uint64_t     partial           = 0;
+        /// the duration of every call
+        latency_histogram latency;
+    };
+
+    /// \brief Merged counters of every thread that used a stats_operations_policy.
+    struct transfer_statistics {
+        /// errors are counted by their value, the last bucket collects every larger value
+        enum : std::size_t { error_buckets = 128 };
+
+        operation_statistics read;
+        operation_statistics read_many;
+        operation_statistics write;
+        operation_statistics write_many;
+
+        /// failed calls by the value of their error code, errno on linux
+        std::array<std::uint64_t, error_buckets> errors{};
+
+        std::uint64_t errors_of(int error) const noexcept
+        {
+            return errors[error < 0 ? 0 : std::min<std::size_t>(static_cast<std::size_t>(error), error_buckets - 1)];
+        }
+    };
+
+#if !defined(REMOTE_MEMORY_DISABLE_STATS)
+
+    namespace detail {
+
+        // written only by the owning thread, so a relaxed load and store is enough and other threads can merge
+        // the counters at any time without tearing
+        struct stats_counter {
+            std::atomic<std::uint64_t> value{0};
+
+            void add(std::uint64_t n) noexcept
+            {
+                value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            std::uint64_t get() const noexcept { return value.load(std::memory_order_relaxed); }
+        };
+
+        struct operation_counters {
+            stats_counter calls;
+            stats_counter requests;
+            stats_counter bytes_requested;
+            stats_counter bytes_transferred;
+            stats_counter failures;
+            stats_counter partial;
+            std::array<stats_counter, latency_histogram::bucket_count> latency;
+        };
+
+        enum class stats_operation { read, read_many, write, write_many };
+
+        // the time stamp counter is several times cheaper to read than steady_clock.
+        // ticks are converted to nanoseconds only when the counters are merged
+        inline std::uint64_t stats_ticks() noexcept
+        {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+            return __builtin_ia32_rdtsc();
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        struct thread_stats {
+            std::array<operation_counters, 4>                            operations;
+            std::array<stats_counter, transfer_statistics::error_buckets> errors;
+
+            operation_counters& operator[](stats_operation op) noexcept
+            {
+                return operations[static_cast<std::size_t>(op)];
+            }
+
+            void error(int value) noexcept
+            {
+                errors[value < 0 ? 0 : std::min<std::size_t>(static_cast<std::size_t>(value)
+                                                              , transfer_statistics::error_buckets - 1)].add(1);
+            }
+        };
+
+        // the counters of every thread that used one policy object and its copies
+        class stats_registry : public std::enable_shared_from_this<stats_registry> {
+            static std::uint64_t next_id() noexcept
+            {
+                static std::atomic<std::uint64_t> id{0};
+                return ++id;
+            }
+
+            const std::uint64_t                        _id = next_id();
+            mutable std::mutex                         _lock;
+            std::vector<std::unique_ptr<thread_stats>> _threads;
+
+            // calibrates ticks against steady_clock over the lifetime of the registry
+            const std::chrono::steady_clock::time_point _start_time  = std::chrono::steady_clock::now();
+            const std::uint64_t                         _start_ticks = stats_ticks();
+
+            double nanoseconds_per_tick() const
+            {
+                const auto minimum = std::chrono::milliseconds(1);
+                auto       now     = std::chrono::steady_clock::now();
+                auto       ticks   = stats_ticks();
+                for (; now - _start_time < minimum || ticks == _start_ticks; ticks = stats_ticks())
+                    now = std::chrono::steady_clock::now();
+
+                return std::chrono::duration<double, std::nano>(now - _start_time).count()
+                       / static_cast<double>(ticks - _start_ticks);
+            }
+
+            struct thread_entry {
+                std::uint64_t                id;
+                thread_stats*                stats;
+                std::weak_ptr<stats_registry> registry;
+            };
+
+        public:
+            /// \brief The counters of the calling thread.
+            thread_stats& local()
+            {
+                // ids are never reused, so entries of destroyed registries are never matched again.
+                // they are dropped whenever the thread starts using another registry
+                thread_local std::vector<thread_entry> entries;
+                thread_local std::uint64_t             last_id    = 0;
+                thread_local thread_stats*             last_stats = nullptr;
+                if (last_id == _id)
+                    return *last_stats;
+
+                for (const auto& entry : entries)
+                    if (entry.id == _id) {
+                        last_id = _id;
+                        return *(last_stats = entry.stats);
+                    }
+
+                entries.erase(std::remove_if(entries.begin(), entries.end()
+                                             , [](const thread_entry& e) { return e.registry.expired(); })
+                              , entries.end());
+                entries.reserve(entries.size() + 1);
+
+                std::unique_ptr<thread_stats> stats(new thread_stats);
+                {
+                    std::lock_guard<std::mutex> lock(_lock);
+                    _threads.push_back(std::move(stats));
+                    entries.push_back({_id, _threads.back().get(), shared_from_this()});
+                }
+
+                last_id = _id;
+                return *(last_stats = entries.back().stats);
+            }
+
+            transfer_statistics merge() const
+            {
+                const auto          scale = nanoseconds_per_tick();
+                transfer_statistics result;
+                const auto merge_operation = [scale](operation_statistics& to, const operation_counters& from) {
+                    to.calls += from.calls.get();
+                    to.requests += from.requests.get();
+                    to.bytes_requested += from.bytes_requested.get();
+                    to.bytes_transferred += from.bytes_transferred.get();
+                    to.failures += from.failures.get();
+                    to.partial += from.partial.get();
+                    for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+                        if (const auto count = from.latency[i].get())
+                            to.latency.add(latency_histogram::bucket(static_cast<std::uint64_t>(
+                                    static_cast<double>(latency_histogram::lower_bound(i)) * scale)), count);
+                };
+
+                std::lock_guard<std::mutex> lock(_lock);
+                for (const auto& thread : _threads) {
+                    merge_operation(result.read, (*thread)[stats_operation::read]);
+                    merge_operation(result.read_many, (*thread)[stats_operation::read_many]);
+                    merge_operation(result.write, (*thread)[stats_operation::write]);
+                    merge_operation(result.write_many, (*thread)[stats_operation::write_many]);
+                    for (std::size_t i = 0; i < transfer_statistics::error_buckets; ++i)
+                        result.errors[i] += thread->errors[i].get();
+                }
+
+                return result;
+            }
+
+            void reset() noexcept
+            {
+                const auto reset_operation = [](operation_counters& counters) {
+                    for (auto c : {&counters.calls, &counters.requests, &counters.bytes_requested
+                                   , &counters.bytes_transferred, &counters.failures, &counters.partial})
+                        c->value.store(0, std::memory_order_relaxed);
+                    for (auto& c : counters.latency)
+                        c.value.store(0, std::memory_order_relaxed);
+                };
+
+                std::lock_guard<std::mutex> lock(_lock);
+                for (auto& thread : _threads) {
+                    for (auto& op : thread->operations)
+                        reset_operation(op);
+                    for (auto& c : thread->errors)
+                        c.value.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+    } // namespace detail
+
+    /// \brief Operations policy decorator that counts the calls, bytes, failures by error and partial transfers
+    ///        of the underlying policy and keeps a histogram of their latencies.
+    ///        Every thread updates its own counters without synchronization, stats() merges them on demand.
+    ///        Copies of the policy share their counters.
+    /// \note Define REMOTE_MEMORY_DISABLE_STATS to turn the decorator into the underlying policy itself.
+    ///       stats() then always returns empty statistics.
+    template<class OperationsPolicy = operations_policy>
+    class stats_operations_policy : public OperationsPolicy {
+        using op = detail::stats_operation;
+
+        std::shared_ptr<detail::stats_registry> _registry = std::make_shared<detail::stats_registry>();
+
+        // the counters of the calling thread are looked up before the transfer, so that the error_code
+        // overloads can fail without transferring anything if they could not be allocated
+        detail::thread_stats* local(std::error_code& ec) const noexcept
+        {
+            try {
+                return &_registry->local();
+            }
+            catch (const std::bad_alloc&) {
+                ec = std::make_error_code(std::errc::not_enough_memory);
+            }
+            catch (const std::system_error& e) {
+                ec = e.code();
+            }
+
+            return nullptr;
+        }
+
+        // records one call. transferred is only used by calls that did not fail
+        static void record(detail::thread_stats& thread, op kind, std::uint64_t start, std::size_t requests
+                           , std::size_t requested, std::size_t transferred, std::size_t failed, std::size_t partial
+                           , const std::error_code& ec) noexcept
+        {
+            const auto ticks = detail::stats_ticks() - start;
+
+            auto& counters = thread[kind];
+            counters.calls.add(1);
+            counters.requests.add(requests);
+            counters.bytes_requested.add(requested);
+            counters.bytes_transferred.add(transferred);
+            counters.failures.add(failed);
+            counters.partial.add(partial);
+            counters.latency[latency_histogram::bucket(ticks)].add(1);
+            if (ec)
+                thread.error(ec.value());
+        }
+
+        // a single transfer either succeeds, stops part way or fails
+        static void record_single(detail::thread_stats& thread, op kind, std::uint64_t start, std::size_t size
+                                  , const std::error_code& ec) noexcept
+        {
+            if (!ec)
+                record(thread, kind, start, 1, size, size, 0, 0, ec);
+            else if (ec == std::errc::result_out_of_range)
+                record(thread, kind, start, 1, size, 0, 0, 1, {});
+            else
+                record(thread, kind, start, 1, size, 0, 1, 0, ec);
+        }
+
+        template<class Transfer>
+        void single(op kind, std::size_t size, Transfer transfer) const
+        {
+            auto&      thread = _registry->local();
+            const auto start  = detail::stats_ticks();
+            try {
+                transfer();
+            } catch (const std::system_error& e) {
+                record_single(thread, kind, start, size, e.code());
+                throw;
+            } catch (const std::range_error&) {
+                record_single(thread, kind, start, size, std::make_error_code(std::errc::result_out_of_range));
+                throw;
+            } catch (...) {
+                record_single(thread, kind, start, size, std::make_error_code(std::errc::io_error));
+                throw;
+            }
+
+            record_single(thread, kind, start, size, {});
+        }
+
+        template<class Transfer>
+        void single(op kind, std::size_t size, Transfer transfer, std::error_code& ec) const
+        {
+            const auto thread = local(ec);
+            if (!thread)
+                return;
+
+            const auto start = detail::stats_ticks();
+            transfer();
+            record_single(*thread, kind, start, size, ec);
+        }
+
+        template<class Request>
+        static void record_many(detail::thread_stats& thread, op kind, std::uint64_t start, const Request* requests
+                                , std::size_t count, const std::error_code& ec) noexcept
+        {
+            std::size_t requested = 0, transferred = 0, failed = 0, partial = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                requested += requests[i].size;
+                transferred += requests[i].transferred;
+                failed += requests[i].transferred == 0 && requests[i].size != 0;
+                partial += requests[i].transferred != 0 && !requests[i].succeeded();
+            }
+
+            // a batch that failed as a whole counts once, not once per request
+            if (ec)
+                record(thread, kind, start, count, requested, 0, 1, 0, ec);
+            else
+                record(thread, kind, start, count, requested, transferred, failed, partial, ec);
+        }
+
+        template<class Request, class Transfer>
+        std::size_t many(op kind, Request* requests, std::size_t count, Transfer transfer) const
+        {
+            auto&       thread = _registry->local();
+            const auto  start  = detail::stats_ticks();
+            std::size_t succeeded;
+            try {
+                succeeded = transfer();
+            } catch (const std::system_error& e) {
+                record_many(thread, kind, start, requests, count, e.code());
+                throw;
+            }
+
+            record_many(thread, kind, start, requests, count, {});
+            return succeeded;
+        }
+
+        template<class Request, class Transfer>
+        std::size_t many(op kind, Request* requests, std::size_t count, Transfer transfer
+                         , std::error_code& ec) const noexcept
+        {
+            const auto thread = local(ec);
+            if (!thread) {
+                for (std::size_t i = 0; i < count; ++i)
+                    requests[i].transferred = 0;
+
+                return 0;
+            }
+
+            const auto start     = detail::stats_ticks();
+            const auto succeeded = transfer();
+            record_many(*thread, kind, start, requests, count, ec);
+            return succeeded;
+        }
+
+    public:
+        /// \brief Forwards all arguments to the underlying policy.
+        template<class... Args>
+        explicit stats_operations_policy(Args&&... args) : OperationsPolicy(std::forward<Args>(args)...)
+        {}
+
+        /// \brief The counters of every thread merged together.
+        /// \note On x86 latencies are timed with the time stamp counter, which is calibrated against steady_clock
+        ///       since the policy was created. The first call within a millisecond of that waits for the rest of it.
+        transfer_statistics stats() const { return _registry->merge(); }
+
+        /// \brief Zeroes every counter. Operations running concurrently may or may not be counted.
+        void reset_stats() noexcept { _registry->reset(); }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size) const
+        {
+            single(op::read, static_cast<std::size_t>(size), [&] { OperationsPolicy::read(address, buffer, size); });
+        }
+
+        template<class T, class Address, class Size>
+        inline void read(Address address, T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            single(op::read, static_cast<std::size_t>(size), [&] {
+                OperationsPolicy::read(address, buffer, size, ec);
+            }, ec);
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count) const
+        {
+            return many(op::read_many, requests, count, [&] { return OperationsPolicy::read_many(requests, count); });
+        }
+
+        inline std::size_t read_many(read_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return many(op::read_many, requests, count, [&] {
+                return OperationsPolicy::read_many(requests, count, ec);
+            }, ec);
+        }
+
+        template<typename T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size) const
+        {
+            single(op::write, static_cast<std::size_t>(size), [&] { OperationsPolicy::write(address, buffer, size); });
+        }
+
+        template<class T, class Address, class Size>
+        inline void write(Address address, const T* buffer, Size size, std::error_code& ec) const
+            noexcept(!jm::detail::checked_pointers)
+        {
+            single(op::write, static_cast<std::size_t>(size), [&] {
+                OperationsPolicy::write(address, buffer, size, ec);
+            }, ec);
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count) const
+        {
+            return many(op::write_many, requests, count, [&] {
+                return OperationsPolicy::write_many(requests, count);
+            });
+        }
+
+        inline std::size_t write_many(write_request* requests, std::size_t count, std::error_code& ec) const noexcept
+        {
+            return many(op::write_many, requests, count, [&] {
+                return OperationsPolicy::write_many(requests, count, ec);
+            }, ec);
+        }
+    };
+
+#else
+
+    // statistics are compiled out, leaving only the underlying policy
+    template<class OperationsPolicy = operations_policy>
+    class stats_operations_policy : public OperationsPolicy {
+    public:
+        template<class... Args>
+        explicit stats_operations_policy(Args&&... args) : OperationsPolicy(std::forward<Args>(args)...)
+        {}
+
+        transfer_statistics stats() const { return {}; }
+        void reset_stats() noexcept {}
+    };
+
+#endif
+
+} // namespace remote
+
+#endif // include guard
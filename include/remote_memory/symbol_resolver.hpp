@@ -0,0 +1,844 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_SYMBOL_RESOLVER_HPP
+#define REMOTE_MEMORY_SYMBOL_RESOLVER_HPP
+
+#if !defined(__linux__)
+    #error symbol_resolver is only available on linux
+#endif
+
+#include "region_map.hpp"
+#include "detail/error.hpp"
+#include "detail/linux/map_files.hpp"
+#include "detail/linux/unique_fd.hpp"
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace remote {
+
+    namespace detail {
+        template<class Elf>
+        struct elf_reader;
+    } // namespace detail
+
+    /// \brief A symbol defined by an ELF image.
+    struct elf_symbol {
+        /// the address the image links the symbol at, the load bias of a module is added to it
+        std::uint64_t value;
+        std::uint64_t size;
+        std::uint8_t  type;
+        std::uint8_t  binding;
+    };
+
+    /// \brief The symbols of one ELF image by name. It does not depend on where the image is loaded
+    ///        and is shared by every module that maps the same image.
+    class symbol_index {
+        std::unordered_map<std::string, elf_symbol> _symbols;
+        std::string                                 _build_id;
+        std::uint64_t                               _image_base = 0;
+        bool                                        _complete   = false;
+
+        template<class Elf>
+        friend struct detail::elf_reader;
+
+    public:
+        /// \return The symbol or nullptr if the image does not define it.
+        const elf_symbol* find(const std::string& name) const noexcept
+        {
+            const auto it = _symbols.find(name);
+            return it == _symbols.end() ? nullptr : &it->second;
+        }
+
+        std::size_t size() const noexcept { return _symbols.size(); }
+        bool empty() const noexcept { return _symbols.empty(); }
+
+        /// \brief The GNU build id as lowercase hex or an empty string if the image has none.
+        const std::string& build_id() const noexcept { return _build_id; }
+
+        /// \brief The address the image links its first byte at. 0 for position independent images.
+        std::uint64_t image_base() const noexcept { return _image_base; }
+
+        /// \brief Whether the index was built from the file and includes .symtab,
+        ///        an index read from memory only holds the dynamic symbols.
+        bool complete() const noexcept { return _complete; }
+
+        const std::unordered_map<std::string, elf_symbol>& symbols() const noexcept { return _symbols; }
+    };
+
+    namespace detail {
+
+        struct elf64 {
+            using ehdr = Elf64_Ehdr;
+            using phdr = Elf64_Phdr;
+            using shdr = Elf64_Shdr;
+            using sym  = Elf64_Sym;
+            using dyn  = Elf64_Dyn;
+            using addr = Elf64_Addr;
+
+            static std::uint8_t type(unsigned char info) noexcept { return ELF64_ST_TYPE(info); }
+            static std::uint8_t binding(unsigned char info) noexcept { return ELF64_ST_BIND(info); }
+        };
+
+        struct elf32 {
+            using ehdr = Elf32_Ehdr;
+            using phdr = Elf32_Phdr;
+            using shdr = Elf32_Shdr;
+            using sym  = Elf32_Sym;
+            using dyn  = Elf32_Dyn;
+            using addr = Elf32_Addr;
+
+            static std::uint8_t type(unsigned char info) noexcept { return ELF32_ST_TYPE(info); }
+            static std::uint8_t binding(unsigned char info) noexcept { return ELF32_ST_BIND(info); }
+        };
+
+        inline bool in_bounds(std::uint64_t offset, std::uint64_t size, std::uint64_t total) noexcept
+        {
+            return offset <= total && size <= total - offset;
+        }
+
+        /// \brief Returns the GNU build id found in a block of ELF notes as hex.
+        inline std::string parse_build_id(const std::uint8_t* notes, std::size_t size)
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            std::size_t offset = 0;
+            while (offset + 12 <= size) {
+                std::uint32_t header[3]; // name size, description size, type
+                std::memcpy(header, notes + offset, sizeof(header));
+                const auto name = offset + 12;
+                const auto desc = name + ((header[0] + 3ull) & ~3ull);
+                const auto next = desc + ((header[1] + 3ull) & ~3ull);
+                if (next > size)
+                    break;
+
+                if (header[2] == NT_GNU_BUILD_ID && header[0] == 4 && std::memcmp(notes + name, "GNU", 4) == 0) {
+                    std::string id;
+                    for (std::size_t i = 0; i < header[1]; ++i) {
+                        id += digits[notes[desc + i] >> 4];
+                        id += digits[notes[desc + i] & 0xF];
+                    }
+                    return id;
+                }
+
+                offset = static_cast<std::size_t>(next);
+            }
+
+            return {};
+        }
+
+        inline bool elf_class(const std::uint8_t* ident, unsigned char& cls) noexcept
+        {
+            if (std::memcmp(ident, ELFMAG, SELFMAG) != 0 || ident[EI_DATA] != ELFDATA2LSB
+                || (ident[EI_CLASS] != ELFCLASS64 && ident[EI_CLASS] != ELFCLASS32))
+                return false;
+
+            cls = ident[EI_CLASS];
+            return true;
+        }
+
+        /// \brief A key that identifies the contents of a file without a build id.
+        inline std::string file_key(const struct stat& info)
+        {
+            char key[96];
+            std::snprintf(key, sizeof(key), "file:%lx:%lx:%lx:%lx.%lx", static_cast<unsigned long>(info.st_dev)
+                          , static_cast<unsigned long>(info.st_ino), static_cast<unsigned long>(info.st_size)
+                          , static_cast<unsigned long>(info.st_mtim.tv_sec)
+                          , static_cast<unsigned long>(info.st_mtim.tv_nsec));
+            return key;
+        }
+
+        /// \brief Process wide cache of symbol indexes keyed by build id.
+        class symbol_cache {
+            std::mutex                                                            _lock;
+            std::unordered_map<std::string, std::shared_ptr<const symbol_index>> _indexes;
+
+        public:
+            static symbol_cache& instance()
+            {
+                static symbol_cache cache;
+                return cache;
+            }
+
+            std::shared_ptr<const symbol_index> find(const std::string& key)
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                const auto                  it = _indexes.find(key);
+                return it == _indexes.end() ? nullptr : it->second;
+            }
+
+            /// \return The index already cached under key if another thread was faster.
+            std::shared_ptr<const symbol_index> insert(const std::string& key, std::shared_ptr<const symbol_index> index)
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                return _indexes.emplace(key, std::move(index)).first->second;
+            }
+
+            std::size_t size()
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                return _indexes.size();
+            }
+
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _indexes.clear();
+            }
+        };
+
+        /// \brief A read only mapping of a whole file.
+        class mapped_file {
+            const std::uint8_t* _data = nullptr;
+            std::size_t         _size = 0;
+
+        public:
+            mapped_file() noexcept = default;
+
+            mapped_file(int fd, std::size_t size) noexcept
+            {
+                const auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address == MAP_FAILED)
+                    return;
+
+                _data = static_cast<const std::uint8_t*>(address);
+                _size = size;
+            }
+
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+
+            ~mapped_file()
+            {
+                if (_data)
+                    ::munmap(const_cast<std::uint8_t*>(_data), _size);
+            }
+
+            const std::uint8_t* data() const noexcept { return _data; }
+            std::size_t size() const noexcept { return _size; }
+        };
+
+        /// \brief Builds symbol indexes of one ELF class.
+        template<class Elf>
+        struct elf_reader {
+            using ehdr = typename Elf::ehdr;
+            using phdr = typename Elf::phdr;
+            using shdr = typename Elf::shdr;
+            using sym  = typename Elf::sym;
+            using dyn  = typename Elf::dyn;
+
+            static void add(symbol_index& index, const sym& s, const char* name, std::size_t max_length)
+            {
+                const auto type = Elf::type(s.st_info);
+                if (s.st_shndx == SHN_UNDEF || type == STT_TLS || type == STT_SECTION || type == STT_FILE)
+                    return;
+
+                const auto length = ::strnlen(name, max_length);
+                if (length == 0 || length == max_length)
+                    return;
+
+                const elf_symbol symbol{s.st_value, s.st_size, type, Elf::binding(s.st_info)};
+                auto             inserted = index._symbols.emplace(std::string(name, length), symbol);
+                // a global definition wins over static ones of the same name
+                if (!inserted.second && inserted.first->second.binding == STB_LOCAL && symbol.binding != STB_LOCAL)
+                    inserted.first->second = symbol;
+
+                // versioned names are also found without the version
+                const auto at = std::find(name, name + length, '@');
+                if (at != name + length && at != name)
+                    index._symbols.emplace(std::string(name, at), symbol);
+            }
+
+            static bool first_load(const phdr* headers, std::size_t count, std::uint64_t& image_base) noexcept
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    if (headers[i].p_type == PT_LOAD) {
+                        image_base = headers[i].p_vaddr - headers[i].p_offset;
+                        return true;
+                    }
+
+                return false;
+            }
+
+            /// \brief Reads the build id and image base out of a file.
+            static bool file_identity(const std::uint8_t* data, std::size_t size, symbol_index& index)
+            {
+                ehdr header;
+                if (size < sizeof(header))
+                    return false;
+
+                std::memcpy(&header, data, sizeof(header));
+                if (header.e_phentsize != sizeof(phdr)
+                    || !in_bounds(header.e_phoff, header.e_phnum * sizeof(phdr), size))
+                    return false;
+
+                std::vector<phdr> headers(header.e_phnum);
+                std::memcpy(headers.data(), data + header.e_phoff, headers.size() * sizeof(phdr));
+                if (!first_load(headers.data(), headers.size(), index._image_base))
+                    return false;
+
+                for (const auto& h : headers)
+                    if (h.p_type == PT_NOTE && index._build_id.empty() && in_bounds(h.p_offset, h.p_filesz, size))
+                        index._build_id = parse_build_id(data + h.p_offset, static_cast<std::size_t>(h.p_filesz));
+
+                return true;
+            }
+
+            /// \brief Indexes .symtab and .dynsym of a file.
+            static bool file_symbols(const std::uint8_t* data, std::size_t size, symbol_index& index)
+            {
+                ehdr header;
+                std::memcpy(&header, data, sizeof(header));
+                if (header.e_shoff == 0)
+                    return true;
+
+                if (header.e_shentsize != sizeof(shdr)
+                    || !in_bounds(header.e_shoff, header.e_shnum * sizeof(shdr), size))
+                    return false;
+
+                std::vector<shdr> sections(header.e_shnum);
+                std::memcpy(sections.data(), data + header.e_shoff, sections.size() * sizeof(shdr));
+                for (const auto& section : sections) {
+                    if ((section.sh_type != SHT_SYMTAB && section.sh_type != SHT_DYNSYM)
+                        || section.sh_link >= sections.size() || !in_bounds(section.sh_offset, section.sh_size, size))
+                        continue;
+
+                    const auto& strings = sections[section.sh_link];
+                    if (!in_bounds(strings.sh_offset, strings.sh_size, size))
+                        continue;
+
+                    const auto names = reinterpret_cast<const char*>(data + strings.sh_offset);
+                    const auto count = section.sh_size / sizeof(sym);
+                    index._symbols.reserve(index._symbols.size() + count);
+                    for (std::size_t i = 1; i < count; ++i) {
+                        sym s;
+                        std::memcpy(&s, data + section.sh_offset + i * sizeof(sym), sizeof(s));
+                        if (s.st_name < strings.sh_size)
+                            add(index, s, names + s.st_name, strings.sh_size - s.st_name);
+                    }
+                }
+
+                index._complete = true;
+                return true;
+            }
+
+            template<class Memory>
+            static bool read(const Memory& memory, std::uint64_t address, void* buffer, std::size_t size)
+            {
+                std::error_code ec;
+                memory.read(static_cast<std::uintptr_t>(address), static_cast<std::uint8_t*>(buffer), size, ec);
+                return !ec;
+            }
+
+            /// \brief Counts the symbols of a DT_GNU_HASH table, which are the ones up to the end of the longest chain.
+            template<class Memory>
+            static bool gnu_hash_count(const Memory& memory, std::uint64_t table, std::size_t extent
+                                       , std::size_t& count)
+            {
+                std::uint32_t header[4]; // buckets, first hashed symbol, bloom words, bloom shift
+                if (!read(memory, table, header, sizeof(header))
+                    || header[0] > extent / sizeof(std::uint32_t) || header[2] > extent / sizeof(typename Elf::addr))
+                    return false;
+
+                std::vector<std::uint32_t> buckets(header[0]);
+                const auto                 bucket_table = table + sizeof(header) + header[2] * sizeof(typename Elf::addr);
+                if (!read(memory, bucket_table, buckets.data(), buckets.size() * sizeof(std::uint32_t)))
+                    return false;
+
+                const auto last = buckets.empty() ? 0u : *std::max_element(buckets.begin(), buckets.end());
+                if (last < header[1]) {
+                    count = header[1];
+                    return true;
+                }
+
+                const auto chains = bucket_table + buckets.size() * sizeof(std::uint32_t);
+                // a chain ends with the lowest bit of its hash set
+                for (auto symbol = last; symbol - last < 0x100000; ++symbol) {
+                    std::uint32_t hash;
+                    if (!read(memory, chains + (symbol - header[1]) * sizeof(hash), &hash, sizeof(hash)))
+                        return false;
+
+                    if (hash & 1) {
+                        count = symbol + 1;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /// \brief Reads the build id and image base of an image loaded at base through memory.
+            template<class Memory>
+            static bool memory_identity(const Memory& memory, std::uintptr_t base, symbol_index& index
+                                        , std::vector<phdr>& headers)
+            {
+                ehdr header;
+                if (!read(memory, base, &header, sizeof(header)) || header.e_phentsize != sizeof(phdr))
+                    return false;
+
+                headers.resize(header.e_phnum);
+                if (!read(memory, base + header.e_phoff, headers.data(), headers.size() * sizeof(phdr))
+                    || !first_load(headers.data(), headers.size(), index._image_base))
+                    return false;
+
+                const auto bias = base - index._image_base;
+                for (const auto& h : headers) {
+                    if (h.p_type != PT_NOTE || !index._build_id.empty() || h.p_memsz > 0x10000)
+                        continue;
+
+                    std::vector<std::uint8_t> notes(static_cast<std::size_t>(h.p_memsz));
+                    if (read(memory, bias + h.p_vaddr, notes.data(), notes.size()))
+                        index._build_id = parse_build_id(notes.data(), notes.size());
+                }
+
+                return true;
+            }
+
+            /// \brief Indexes the dynamic symbols of an image loaded at base, .symtab is not loaded.
+            /// \param extent The size of the mapped image. No table of a valid image is larger.
+            template<class Memory>
+            static bool memory_symbols(const Memory& memory, std::uintptr_t base, std::size_t extent
+                                       , symbol_index& index, const std::vector<phdr>& headers)
+            {
+                const auto bias    = base - index._image_base;
+                const auto dynamic = std::find_if(headers.begin(), headers.end()
+                                                  , [](const phdr& h) { return h.p_type == PT_DYNAMIC; });
+                if (dynamic == headers.end())
+                    return true;
+                if (dynamic->p_memsz > extent)
+                    return false;
+
+                std::vector<dyn> entries(static_cast<std::size_t>(dynamic->p_memsz / sizeof(dyn)));
+                if (!read(memory, bias + dynamic->p_vaddr, entries.data(), entries.size() * sizeof(dyn)))
+                    return false;
+
+                std::uint64_t symbols = 0, strings = 0, strings_size = 0, hash = 0, gnu_hash = 0;
+                for (const auto& entry : entries) {
+                    if (entry.d_tag == DT_NULL)
+                        break;
+
+                    // the dynamic linker relocates most of these in place, but not on every architecture
+                    const auto pointer = static_cast<std::uint64_t>(entry.d_un.d_ptr);
+                    const auto address = pointer >= base ? pointer : pointer + bias;
+                    switch (entry.d_tag) {
+                    case DT_SYMTAB: symbols = address; break;
+                    case DT_STRTAB: strings = address; break;
+                    case DT_STRSZ: strings_size = entry.d_un.d_val; break;
+                    case DT_HASH: hash = address; break;
+                    case DT_GNU_HASH: gnu_hash = address; break;
+                    default: break;
+                    }
+                }
+
+                std::size_t count = 0;
+                if (hash) {
+                    std::uint32_t header[2]; // buckets, chains
+                    if (!read(memory, hash, header, sizeof(header)))
+                        return false;
+                    count = header[1];
+                }
+                else if (!gnu_hash || !gnu_hash_count(memory, gnu_hash, extent, count))
+                    return false;
+
+                if (!symbols || !strings || !strings_size || strings_size > extent || count > extent / sizeof(sym))
+                    return false;
+
+                std::vector<char> names(static_cast<std::size_t>(strings_size));
+                std::vector<sym>  table(count);
+                if (!read(memory, strings, names.data(), names.size())
+                    || !read(memory, symbols, table.data(), table.size() * sizeof(sym)))
+                    return false;
+
+                index._symbols.reserve(count);
+                for (std::size_t i = 1; i < count; ++i)
+                    if (table[i].st_name < names.size())
+                        add(index, table[i], names.data() + table[i].st_name, names.size() - table[i].st_name);
+
+                return true;
+            }
+        };
+
+    } // namespace detail
+
+    /// \brief An ELF image mapped by the target.
+    struct elf_module {
+        /// the file name, such as libc.so.6
+        std::string    name;
+        std::string    path;
+        /// the address the first byte of the file is mapped at
+        std::uintptr_t base;
+        /// the end of the last region mapped from the file
+        std::uintptr_t end;
+        /// the index of the image. nullptr until the module is first resolved in
+        std::shared_ptr<const symbol_index> symbols;
+
+        /// \brief The difference between where symbols are linked and where they are loaded.
+        std::uintptr_t bias() const noexcept
+        {
+            return symbols ? base - static_cast<std::uintptr_t>(symbols->image_base()) : base;
+        }
+    };
+
+    /// \brief How a symbol_resolver builds indexes.
+    struct symbol_resolver_options {
+        /// reads the images from disk, which includes .symtab. Images that cannot be opened are read through memory
+        bool read_files = true;
+        /// shares indexes between resolvers through a process wide cache keyed by build id
+        bool use_cache  = true;
+    };
+
+    /// \brief Resolves symbolic addresses in a target to numeric ones.
+    ///        The modules are listed from a region map and the index of each one is built the first time it is
+    ///        needed from its file, falling back to the dynamic symbols in memory. Indexes are cached by build id,
+    ///        so resolving in another process that runs the same binaries does not parse them again.
+    ///        Expressions take the forms
+    ///        module!symbol[+offset], module+offset and symbol[+offset], where the last searches every module
+    ///        in load order. Offsets may be decimal or hex with 0x and may be negative.
+    /// \note Indexes are built lazily, so a resolver must not be used from several threads at once.
+    /// \code remote::region_map regions(pid);
+    ///       auto symbols = remote::make_symbol_resolver(mem, regions);
+    ///       auto handler = symbols.resolve("libc.so.6!malloc");
+    ///       auto player  = symbols.resolve("game+0x1A2B30");
+    template<class Memory>
+    class symbol_resolver {
+        // the first region of a module and the file the region map reports for it
+        struct backing {
+            std::uintptr_t begin;
+            std::uintptr_t end;
+            std::uint64_t  inode;
+            dev_t          device;
+            bool           unindexable;
+        };
+
+        const Memory*                                _memory;
+        pid_t                                        _pid;
+        symbol_resolver_options                      _options;
+        mutable std::vector<elf_module>              _modules;
+        mutable std::vector<backing>                 _backings;
+        std::unordered_map<std::string, std::size_t> _names;
+
+        // an image of a target running in another mount namespace is found under its root
+        detail::unique_fd open(const elf_module& m, const backing& b) const
+        {
+            const auto root = "/proc/" + std::to_string(_pid) + "/root" + m.path;
+            return detail::open_mapped_file(_pid, b.begin, b.end, b.inode, b.device, O_RDONLY
+                                            , {m.path.c_str(), root.c_str()});
+        }
+
+        template<class Elf>
+        std::shared_ptr<const symbol_index> load_file(const detail::mapped_file& file, const struct stat& info) const
+        {
+            std::shared_ptr<symbol_index> index(new symbol_index);
+            if (!detail::elf_reader<Elf>::file_identity(file.data(), file.size(), *index))
+                return nullptr;
+
+            auto key = index->build_id().empty() ? detail::file_key(info) : index->build_id();
+            if (_options.use_cache)
+                if (auto cached = detail::symbol_cache::instance().find(key))
+                    return cached;
+
+            if (!detail::elf_reader<Elf>::file_symbols(file.data(), file.size(), *index))
+                return nullptr;
+
+            if (!_options.use_cache)
+                return index;
+
+            return detail::symbol_cache::instance().insert(key, std::move(index));
+        }
+
+        template<class Elf>
+        std::shared_ptr<const symbol_index> load_memory(std::uintptr_t base, std::size_t extent) const
+        {
+            std::shared_ptr<symbol_index>                       index(new symbol_index);
+            std::vector<typename detail::elf_reader<Elf>::phdr> headers;
+            if (!detail::elf_reader<Elf>::memory_identity(*_memory, base, *index, headers))
+                return nullptr;
+
+            // a partial index must not replace the complete one built from the file
+            const auto key       = index->build_id() + "/dynamic";
+            const auto cacheable = _options.use_cache && !index->build_id().empty();
+            if (cacheable) {
+                if (auto cached = detail::symbol_cache::instance().find(index->build_id()))
+                    return cached;
+                if (auto cached = detail::symbol_cache::instance().find(key))
+                    return cached;
+            }
+
+            if (!detail::elf_reader<Elf>::memory_symbols(*_memory, base, extent, *index, headers))
+                return nullptr;
+
+            if (!cacheable)
+                return index;
+
+            return detail::symbol_cache::instance().insert(key, std::move(index));
+        }
+
+        std::shared_ptr<const symbol_index> load(const elf_module& m, const backing& b) const
+        {
+            if (_options.read_files) {
+                const auto fd = open(m, b);
+                struct stat file;
+                if (fd && ::fstat(fd.get(), &file) == 0 && file.st_size >= static_cast<::off_t>(EI_NIDENT)) {
+                    const detail::mapped_file mapping(fd.get(), static_cast<std::size_t>(file.st_size));
+                    unsigned char             cls;
+                    if (mapping.data() && detail::elf_class(mapping.data(), cls)) {
+                        auto index = cls == ELFCLASS64 ? load_file<detail::elf64>(mapping, file)
+                                                       : load_file<detail::elf32>(mapping, file);
+                        if (index)
+                            return index;
+                    }
+                }
+            }
+
+            std::uint8_t  ident[EI_NIDENT];
+            unsigned char cls;
+            if (!detail::elf_reader<detail::elf64>::read(*_memory, m.base, ident, sizeof(ident))
+                || !detail::elf_class(ident, cls))
+                return nullptr;
+
+            // sizes read from the image are bounded by its mapping, so a corrupt one fails the index
+            const auto extent = static_cast<std::size_t>(m.end - m.base);
+            return cls == ELFCLASS64 ? load_memory<detail::elf64>(m.base, extent)
+                                     : load_memory<detail::elf32>(m.base, extent);
+        }
+
+        const elf_module* indexed(std::size_t i, std::error_code& ec) const
+        {
+            auto& m = _modules[i];
+            auto& b = _backings[i];
+            if (!m.symbols && !b.unindexable) {
+                m.symbols     = load(m, b);
+                b.unindexable = !m.symbols;
+            }
+
+            if (b.unindexable) {
+                ec = std::make_error_code(std::errc::executable_format_error);
+                return nullptr;
+            }
+
+            return &m;
+        }
+
+        static bool parse_offset(const std::string& text, std::size_t from, std::int64_t& offset) noexcept
+        {
+            if (from + 1 >= text.size())
+                return false;
+
+            const auto begin = text.c_str() + from + 1;
+            char*      end   = nullptr;
+            errno            = 0;
+            const auto hex   = begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X');
+            const auto value = std::strtoull(begin, &end, hex ? 16 : 10);
+            if (errno || end != text.c_str() + text.size() || !std::isxdigit(static_cast<unsigned char>(*begin)))
+                return false;
+
+            offset = text[from] == '-' ? -static_cast<std::int64_t>(value) : static_cast<std::int64_t>(value);
+            return true;
+        }
+
+    public:
+        /// \param memory The memory symbols are read through when an image cannot be opened. Must outlive the resolver.
+        symbol_resolver(const Memory& memory, const region_map& regions, symbol_resolver_options options = {})
+                : _memory(&memory), _pid(regions.pid()), _options(options)
+        {
+            refresh(regions);
+        }
+
+        /// \brief Lists the modules again, keeping the indexes of the ones that are still mapped.
+        void refresh(const region_map& regions)
+        {
+            std::vector<elf_module>                      modules;
+            std::vector<backing>                         backings;
+            std::unordered_map<std::string, std::size_t> paths;
+            for (auto r : regions) {
+                if (r.anonymous() || r.path[0] != '/')
+                    continue;
+
+                const auto found = paths.find(r.path);
+                if (found != paths.end()) {
+                    auto& m = modules[found->second];
+                    m.base  = std::min(m.base, static_cast<std::uintptr_t>(r.begin - r.offset));
+                    m.end   = std::max(m.end, r.end);
+                    continue;
+                }
+
+                std::string path    = r.path;
+                auto        name    = path.substr(path.rfind('/') + 1);
+                const auto  deleted = name.find(" (deleted)");
+                if (deleted != std::string::npos)
+                    name.erase(deleted);
+
+                paths.emplace(path, modules.size());
+                modules.push_back({std::move(name), std::move(path), r.begin - static_cast<std::uintptr_t>(r.offset)
+                                   , r.end, nullptr});
+                backings.push_back({r.begin, r.end, r.inode, makedev(r.device_major, r.device_minor), false});
+            }
+
+            // indexes of modules that stayed at the same place are kept
+            for (auto& m : modules)
+                for (const auto& old : _modules)
+                    if (old.symbols && old.path == m.path && old.base == m.base) {
+                        m.symbols = old.symbols;
+                        break;
+                    }
+
+            _modules  = std::move(modules);
+            _backings = std::move(backings);
+            _names.clear();
+            for (std::size_t i = 0; i < _modules.size(); ++i) {
+                _names.emplace(_modules[i].name, i);
+                _names.emplace(_modules[i].path, i);
+            }
+        }
+
+        /// \brief The modules in the order they are mapped. Their symbols are only set once they were indexed.
+        const std::vector<elf_module>& modules() const noexcept { return _modules; }
+
+        /// \brief Finds a module by file name or full path and indexes it.
+        /// \return The module or nullptr if it is not mapped or could not be indexed.
+        const elf_module* find_module(const std::string& name) const
+        {
+            std::error_code ec;
+            const auto      it = _names.find(name);
+            return it == _names.end() ? nullptr : indexed(it->second, ec);
+        }
+
+        /// \brief Resolves a symbol of a module.
+        /// \param ec Set to no_such_file_or_directory if the module or symbol does not exist
+        ///        and to executable_format_error if the module could not be indexed.
+        std::uintptr_t resolve(const std::string& module_name, const std::string& symbol, std::error_code& ec) const
+        {
+            const auto it = _names.find(module_name);
+            if (it == _names.end()) {
+                ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                return 0;
+            }
+
+            const auto m = indexed(it->second, ec);
+            if (!m)
+                return 0;
+
+            const auto s = m->symbols->find(symbol);
+            if (!s) {
+                ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                return 0;
+            }
+
+            return m->bias() + static_cast<std::uintptr_t>(s->value);
+        }
+
+        /// \brief Resolves an expression such as libc.so.6!malloc+0x10 or game+0x1000.
+        /// \param ec Set to invalid_argument if the expression is malformed, otherwise as by resolve of a symbol.
+        std::uintptr_t resolve(const std::string& expression, std::error_code& ec) const
+        {
+            // the offset starts at the last sign that is followed by a number, so names like ld-linux-x86-64.so.2 work
+            std::int64_t offset = 0;
+            auto         length = expression.size();
+            const auto   sign   = expression.find_last_of("+-");
+            if (sign != std::string::npos && parse_offset(expression, sign, offset))
+                length = sign;
+
+            const auto bang = expression.find('!');
+            if (length == 0 || bang + 1 == length || bang == 0 || (bang != std::string::npos && bang > length)) {
+                ec = std::make_error_code(std::errc::invalid_argument);
+                return 0;
+            }
+
+            std::uintptr_t address = 0;
+            if (bang != std::string::npos)
+                address = resolve(expression.substr(0, bang), expression.substr(bang + 1, length - bang - 1), ec);
+            else {
+                const auto head = expression.substr(0, length);
+                const auto it   = _names.find(head);
+                if (it != _names.end())
+                    address = _modules[it->second].base;
+                else
+                    address = resolve_anywhere(head, ec);
+            }
+
+            return ec ? 0 : address + static_cast<std::uintptr_t>(offset);
+        }
+
+        /// \throw Throws an std::system_error if the expression could not be resolved.
+        std::uintptr_t resolve(const std::string& expression) const
+        {
+            std::error_code ec;
+            const auto      address = resolve(expression, ec);
+            if (ec)
+                throw std::system_error(ec, "symbol_resolver::resolve() failed");
+
+            return address;
+        }
+
+        std::uintptr_t resolve(const std::string& module_name, const std::string& symbol) const
+        {
+            std::error_code ec;
+            const auto      address = resolve(module_name, symbol, ec);
+            if (ec)
+                throw std::system_error(ec, "symbol_resolver::resolve() failed");
+
+            return address;
+        }
+
+        /// \brief Searches every module in load order for a symbol. Modules that cannot be indexed are skipped.
+        std::uintptr_t resolve_anywhere(const std::string& symbol, std::error_code& ec) const
+        {
+            for (std::size_t i = 0; i < _modules.size(); ++i) {
+                std::error_code index_ec;
+                const auto      m = indexed(i, index_ec);
+                if (!m)
+                    continue;
+
+                if (const auto s = m->symbols->find(symbol))
+                    return m->bias() + static_cast<std::uintptr_t>(s->value);
+            }
+
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+            return 0;
+        }
+
+        /// \brief The number of indexes in the process wide cache.
+        static std::size_t cached() { return detail::symbol_cache::instance().size(); }
+
+        /// \brief Drops every cached index. Resolvers keep the indexes they already use.
+        static void clear_cache() { detail::symbol_cache::instance().clear(); }
+    };
+
+    template<class Memory>
+    inline symbol_resolver<Memory> make_symbol_resolver(const Memory& memory, const region_map& regions
+                                                        , symbol_resolver_options options = {})
+    {
+        return symbol_resolver<Memory>(memory, regions, options);
+    }
+
+} // namespace remote
+
+#endif // include guard
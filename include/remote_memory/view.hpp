@@ -0,0 +1,350 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_VIEW_HPP
+#define REMOTE_MEMORY_VIEW_HPP
+
+#include "read_batch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace remote {
+
+    /// \brief Compile time descriptor of a field of type M at Offset bytes into a remote object.
+    ///        Useful for objects whose layout is only partially known.
+    /// \code using health = remote::field<int, 0x100>;
+    template<class M, std::size_t Offset>
+    struct field {
+        using type = M;
+        static constexpr std::size_t offset = Offset;
+    };
+
+    template<class M, std::size_t Offset>
+    constexpr std::size_t field<M, Offset>::offset;
+
+    /// \brief Stand in for a remote type of which only the size is known. Combine with remote::field.
+    template<std::size_t Size>
+    struct opaque {
+        unsigned char bytes[Size];
+    };
+
+    template<class T, class Memory>
+    class view;
+
+    namespace detail {
+
+        struct view_access;
+
+        // the storage is never constructed, only the address of the member is taken
+        template<class T, class M>
+        inline std::size_t member_offset(M T::*member) noexcept
+        {
+            static const typename std::aligned_storage<sizeof(T), alignof(T)>::type storage{};
+            const auto& object = reinterpret_cast<const T&>(storage);
+            return static_cast<std::size_t>(reinterpret_cast<const char*>(&(object.*member))
+                                            - reinterpret_cast<const char*>(&object));
+        }
+
+        // the pointee of a followed member is U, or what M points to if U is void
+        template<class U, class M>
+        struct follow_target {
+            using type = U;
+        };
+
+        template<class M>
+        struct follow_target<void, M> {
+            static_assert(std::is_pointer<M>::value, "give the type to follow for members that are not pointers");
+            using type = typename std::remove_pointer<M>::type;
+        };
+
+        template<class M>
+        inline std::uintptr_t stored_address(const M& value) noexcept
+        {
+            static_assert(sizeof(M) <= sizeof(std::uintptr_t) && std::is_trivially_copyable<M>::value
+                          , "only pointers and integers can be followed");
+            std::uintptr_t address = 0;
+            std::memcpy(&address, &value, sizeof(M));
+            return address;
+        }
+
+    } // namespace detail
+
+    /// \brief A typed address in a remote process. Copying and offsetting it never touches remote memory.
+    /// \tparam T The remote type. Must be trivially copyable.
+    template<class T, class Memory>
+    class ptr {
+        static_assert(std::is_trivially_copyable<T>::value, "remote objects must be trivially copyable");
+
+        const Memory*  _memory  = nullptr;
+        std::uintptr_t _address = 0;
+
+    public:
+        ptr() = default;
+
+        template<class Address>
+        ptr(const Memory& memory, Address address) noexcept(!jm::detail::checked_pointers)
+                : _memory(&memory), _address(jm::detail::pointer_cast<std::uintptr_t>(address))
+        {}
+
+        std::uintptr_t address() const noexcept { return _address; }
+        const Memory&  memory() const noexcept { return *_memory; }
+
+        explicit operator bool() const noexcept { return _address != 0; }
+
+        /// \brief A view of the object. Nothing is read until the view is first touched.
+        view<T, Memory> get() const noexcept { return view<T, Memory>(*_memory, _address); }
+        view<T, Memory> operator*() const noexcept { return get(); }
+
+        /// \brief Reads the whole object right away.
+        T read() const { return _memory->template read<T>(_address); }
+        T read(std::error_code& ec) const { return _memory->template read<T>(_address, ec); }
+
+        /// \brief Reads a single member without fetching the rest of the object.
+        template<class M, class U = T>
+        M read(M U::*member) const
+        {
+            return _memory->template read<M>(_address + detail::member_offset(member));
+        }
+
+        template<class Field>
+        typename Field::type read() const
+        {
+            static_assert(Field::offset + sizeof(typename Field::type) <= sizeof(T), "the field is out of bounds");
+            return _memory->template read<typename Field::type>(_address + Field::offset);
+        }
+
+        /// \brief Writes a single member.
+        template<class M, class U = T>
+        void write(M U::*member, const M& value) const
+        {
+            _memory->write(_address + detail::member_offset(member), value);
+        }
+
+        template<class Field>
+        void write(const typename Field::type& value) const
+        {
+            static_assert(Field::offset + sizeof(typename Field::type) <= sizeof(T), "the field is out of bounds");
+            _memory->write(_address + Field::offset, value);
+        }
+
+        /// \brief The remote address of a member.
+        template<class M, class U = T>
+        ptr<M, Memory> at(M U::*member) const noexcept
+        {
+            return ptr<M, Memory>(*_memory, _address + detail::member_offset(member));
+        }
+
+        ptr  operator+(std::ptrdiff_t n) const noexcept { return ptr(*_memory, _address + n * sizeof(T)); }
+        ptr  operator-(std::ptrdiff_t n) const noexcept { return ptr(*_memory, _address - n * sizeof(T)); }
+        ptr& operator+=(std::ptrdiff_t n) noexcept { return _address += n * sizeof(T), *this; }
+        ptr& operator-=(std::ptrdiff_t n) noexcept { return _address -= n * sizeof(T), *this; }
+
+        /// \brief A view of the element n objects away.
+        view<T, Memory> operator[](std::ptrdiff_t n) const noexcept { return (*this + n).get(); }
+
+        friend bool operator==(const ptr& a, const ptr& b) noexcept { return a._address == b._address; }
+        friend bool operator!=(const ptr& a, const ptr& b) noexcept { return a._address != b._address; }
+    };
+
+    /// \brief A lazily fetched local copy of a remote object.
+    ///        The whole object is read with a single read the first time any of its members are touched and
+    ///        every later access is served from the copy until refresh() is called.
+    ///        Pointers stored in the object can be followed into further views, which are fetched lazily as well.
+    /// \code auto player = remote::make_ptr<player_t>(mem, address).get();
+    ///       int  health = player->health;                         // one read of the whole player
+    ///       auto name   = player.follow(&player_t::name)->buffer; // one read of the name object
+    template<class T, class Memory>
+    class view {
+        static_assert(std::is_trivially_copyable<T>::value, "remote objects must be trivially copyable");
+
+        const Memory*                                                  _memory  = nullptr;
+        std::uintptr_t                                                 _address = 0;
+        mutable typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+        mutable bool                                                   _fetched = false;
+
+        const T& object() const noexcept { return reinterpret_cast<const T&>(_storage); }
+
+    public:
+        view() = default;
+
+        template<class Address>
+        view(const Memory& memory, Address address) noexcept(!jm::detail::checked_pointers)
+                : _memory(&memory), _address(jm::detail::pointer_cast<std::uintptr_t>(address))
+        {}
+
+        std::uintptr_t address() const noexcept { return _address; }
+        const Memory&  memory() const noexcept { return *_memory; }
+
+        /// \brief Whether the object has been read.
+        bool fetched() const noexcept { return _fetched; }
+
+        /// \brief Reads the object if it has not been read yet.
+        /// \throw Throws if the read fails. Refer to remote::read_memory.
+        const T& get() const
+        {
+            if (!_fetched) {
+                _memory->read(_address, reinterpret_cast<unsigned char*>(&_storage), sizeof(T));
+                _fetched = true;
+            }
+
+            return object();
+        }
+
+        /// \brief error_code version of get. The contents are unspecified if ec is set.
+        const T& get(std::error_code& ec) const
+        {
+            if (!_fetched) {
+                _memory->read(_address, reinterpret_cast<unsigned char*>(&_storage), sizeof(T), ec);
+                _fetched = !ec;
+            }
+
+            return object();
+        }
+
+        /// \brief Reads the object again on the next access.
+        void refresh() noexcept { _fetched = false; }
+
+        const T* operator->() const { return &get(); }
+        const T& operator*() const { return get(); }
+
+        /// \brief A member of the object.
+        template<class M, class U = T>
+        const M& operator->*(M U::*member) const { return get().*member; }
+
+        /// \brief A field described by remote::field.
+        template<class Field>
+        typename Field::type get() const
+        {
+            static_assert(Field::offset + sizeof(typename Field::type) <= sizeof(T), "the field is out of bounds");
+            typename Field::type value;
+            std::memcpy(&value, reinterpret_cast<const unsigned char*>(&get()) + Field::offset, sizeof(value));
+            return value;
+        }
+
+        /// \brief A view of the object a pointer member points to. Nothing is read until the new view is touched.
+        /// \tparam U The type of the pointee. May be omitted if the member is a pointer.
+        template<class U = void, class M, class V = T>
+        view<typename detail::follow_target<U, M>::type, Memory> follow(M V::*member) const
+        {
+            return {*_memory, detail::stored_address(get().*member)};
+        }
+
+        template<class Field, class U = void>
+        view<typename detail::follow_target<U, typename Field::type>::type, Memory> follow() const
+        {
+            return {*_memory, detail::stored_address(get<Field>())};
+        }
+
+        /// \brief The remote address of a member.
+        template<class M, class U = T>
+        ptr<M, Memory> at(M U::*member) const noexcept
+        {
+            return ptr<M, Memory>(*_memory, _address + detail::member_offset(member));
+        }
+
+        /// \brief Writes a member to the remote object and updates the local copy if it has been fetched.
+        template<class M, class U = T>
+        void write(M U::*member, const M& value)
+        {
+            const auto offset = detail::member_offset(member);
+            _memory->write(_address + offset, value);
+            if (_fetched)
+                std::memcpy(reinterpret_cast<unsigned char*>(&_storage) + offset, &value, sizeof(M));
+        }
+
+        friend struct detail::view_access;
+    };
+
+    namespace detail {
+
+        struct view_access {
+            template<class T, class Memory>
+            static read_request request(view<T, Memory>& v) noexcept
+            {
+                return read_request(v._address, &v._storage, v._fetched ? 0 : sizeof(T));
+            }
+
+            // returns whether the view is fetched
+            template<class T, class Memory>
+            static bool complete(view<T, Memory>& v, const read_request& request) noexcept
+            {
+                v._fetched = v._fetched || request.succeeded();
+                return v._fetched;
+            }
+        };
+
+    } // namespace detail
+
+    /// \brief Fetches several views that use the same memory object with a single read_many.
+    ///        Views that were already fetched are not read again.
+    /// \return The number of views that could not be read. They stay unfetched.
+    /// \throw Only throws if the whole batch failed. Refer to read_many.
+    template<class View, class... Views>
+    inline std::size_t fetch(View& first, Views&... rest)
+    {
+        read_request requests[] = {detail::view_access::request(first), detail::view_access::request(rest)...};
+        first.memory().read_many(requests, sizeof...(Views) + 1);
+
+        // braced initializers are evaluated in order, so i walks the requests in step with the views
+        std::size_t i      = 0;
+        std::size_t failed = 0;
+        const int   expand[] = {(failed += !detail::view_access::complete(first, requests[i++]), 0)
+                                , (failed += !detail::view_access::complete(rest, requests[i++]), 0)...};
+        (void)expand;
+        return failed;
+    }
+
+    /// \brief Fetches count views with a single read_many.
+    /// \return The number of views that could not be read. They stay unfetched.
+    template<class T, class Memory>
+    inline std::size_t fetch(view<T, Memory>* views, std::size_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        std::vector<read_request> requests(count);
+        for (std::size_t i = 0; i < count; ++i)
+            requests[i] = detail::view_access::request(views[i]);
+
+        views[0].memory().read_many(requests.data(), count);
+
+        std::size_t failed = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            failed += !detail::view_access::complete(views[i], requests[i]);
+
+        return failed;
+    }
+
+    template<class T, class Memory, class Address>
+    inline ptr<T, Memory> make_ptr(const Memory& memory, Address address) noexcept(!jm::detail::checked_pointers)
+    {
+        return ptr<T, Memory>(memory, address);
+    }
+
+    template<class T, class Memory, class Address>
+    inline view<T, Memory> make_view(const Memory& memory, Address address) noexcept(!jm::detail::checked_pointers)
+    {
+        return view<T, Memory>(memory, address);
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,436 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WATCHER_HPP
+#define REMOTE_MEMORY_WATCHER_HPP
+
+#include "read_batch.hpp"
+#include "detail/diff_kernels.hpp"
+#include "detail/spsc_ring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the number of new bytes carried by a watch_event
+#ifndef REMOTE_MEMORY_WATCH_INLINE_SIZE
+    #define REMOTE_MEMORY_WATCH_INLINE_SIZE 64
+#endif
+
+namespace remote {
+
+    /// \brief A change of a watched range seen by one tick of a watcher.
+    struct watch_event {
+        /// the id returned by watcher::add
+        std::size_t    id;
+        /// the first changed byte
+        std::uintptr_t address;
+        /// the number of bytes from the first to the last changed byte
+        std::size_t    size;
+        /// the tick the change was seen at
+        std::uint64_t  tick;
+        /// false if [address; address + size] could no longer be read
+        bool           readable;
+        /// the new contents of the first min(size, REMOTE_MEMORY_WATCH_INLINE_SIZE) bytes
+        std::uint8_t   data[REMOTE_MEMORY_WATCH_INLINE_SIZE];
+    };
+
+    struct watcher_options {
+        /// the time between the starts of two ticks
+        std::chrono::microseconds interval{10000};
+        /// the number of threads running callbacks
+        std::size_t               consumers      = 1;
+        /// the number of events a consumer can fall behind before further events are dropped
+        std::size_t               queue_capacity = 4096;
+    };
+
+    /// \brief Polls watched remote ranges and reports their changes.
+    ///        Every tick reads all watches with one read_many and compares them against a shadow copy from the
+    ///        previous tick in a single vectorized pass. Events are handed to consumer threads through lock free
+    ///        single producer single consumer rings, so a slow callback never delays polling - once a ring is full
+    ///        further events for it are dropped and counted.
+    ///
+    ///        Events of one watch are always delivered by the same consumer thread in order.
+    ///        A watch produces at most one event per tick. The only exception is a watch that stops being readable
+    ///        part way, which reports the unreadable rest and changes of the part that was still read separately.
+    /// \note Callbacks run on consumer threads and may still be called for a short while after remove().
+    template<class Memory>
+    class watcher {
+    public:
+        using callback = std::function<void(const watch_event&)>;
+
+    private:
+        struct watch {
+            std::size_t                     id;
+            std::uintptr_t                  address;
+            std::size_t                     size;
+            std::size_t                     offset;
+            std::shared_ptr<const callback> on_change;
+            bool                            primed;
+            bool                            readable;
+        };
+
+        struct message {
+            watch_event                     event;
+            std::shared_ptr<const callback> on_change;
+        };
+
+        struct consumer {
+            detail::spsc_ring<message> ring;
+            std::mutex                 lock;
+            std::condition_variable    wake;
+            std::thread                thread;
+            bool                       notified = false;
+
+            explicit consumer(std::size_t capacity) : ring(capacity) {}
+        };
+
+        const Memory*   _memory;
+        watcher_options _options;
+
+        // held by a tick for its whole duration, so add and remove never race a tick
+        std::mutex                _watches_lock;
+        std::vector<watch>        _watches;
+        std::vector<read_request> _requests;
+        std::vector<std::uint8_t> _shadow;
+        std::vector<std::uint8_t> _current;
+        bool                      _relayout = false;
+        std::size_t               _next_id  = 1;
+        std::uint64_t             _tick     = 0;
+
+        std::vector<std::unique_ptr<consumer>> _consumers;
+        std::atomic<bool>                      _stop{false};
+        std::atomic<std::uint64_t>             _dropped{0};
+
+        std::thread             _poller;
+        std::mutex              _poller_lock;
+        std::condition_variable _poller_wake;
+        bool                    _polling = false;
+        std::exception_ptr      _error;
+
+        void relayout()
+        {
+            std::vector<std::uint8_t> shadow;
+            std::size_t               total = 0;
+            for (auto& w : _watches)
+                total += w.size;
+
+            shadow.resize(total);
+            std::size_t offset = 0;
+            for (auto& w : _watches) {
+                if (w.primed)
+                    std::copy_n(_shadow.data() + w.offset, w.size, shadow.data() + offset);
+                w.offset = offset;
+                offset += w.size;
+            }
+
+            _shadow.swap(shadow);
+            _current.resize(total);
+            _requests.resize(_watches.size());
+            for (std::size_t i = 0; i < _watches.size(); ++i) {
+                _requests[i].address = _watches[i].address;
+                _requests[i].size    = _watches[i].size;
+            }
+
+            _relayout = false;
+        }
+
+        void emit(const watch& w, std::uintptr_t address, std::size_t size, bool readable, const std::uint8_t* data)
+        {
+            message m;
+            m.event.id       = w.id;
+            m.event.address  = address;
+            m.event.size     = size;
+            m.event.tick     = _tick;
+            m.event.readable = readable;
+            std::copy_n(data, std::min<std::size_t>(size, REMOTE_MEMORY_WATCH_INLINE_SIZE), m.event.data);
+            m.on_change = w.on_change;
+
+            auto& c = *_consumers[w.id % _consumers.size()];
+            if (!c.ring.try_push(std::move(m))) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            c.notified = true;
+        }
+
+        void consume(consumer& c)
+        {
+            for (;;) {
+                message m;
+                while (c.ring.try_pop(m)) {
+                    (*m.on_change)(m.event);
+                    m.on_change.reset();
+                }
+
+                std::unique_lock<std::mutex> lock(c.lock);
+                if (_stop.load() && c.ring.empty())
+                    return;
+
+                // the timeout covers a wake up that raced the emptiness check above
+                c.wake.wait_for(lock, _options.interval, [&] { return _stop.load() || !c.ring.empty(); });
+            }
+        }
+
+        void poll_loop()
+        {
+            auto next = std::chrono::steady_clock::now();
+            for (;;) {
+                try {
+                    poll();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(_poller_lock);
+                    _error   = std::current_exception();
+                    _polling = false;
+                    return;
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                next += _options.interval;
+                // ticks that were missed are skipped instead of being run back to back
+                if (next < now)
+                    next = now;
+
+                std::unique_lock<std::mutex> lock(_poller_lock);
+                if (_poller_wake.wait_until(lock, next, [&] { return !_polling; }))
+                    return;
+            }
+        }
+
+        void halt_poller()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_poller_lock);
+                _polling = false;
+            }
+
+            _poller_wake.notify_all();
+            if (_poller.joinable())
+                _poller.join();
+        }
+
+    public:
+        /// \param memory The memory object every tick reads through. It must outlive the watcher.
+        explicit watcher(const Memory& memory, const watcher_options& options = watcher_options{})
+                : _memory(&memory), _options(options)
+        {
+            for (std::size_t i = 0; i < std::max<std::size_t>(_options.consumers, 1); ++i)
+                _consumers.emplace_back(new consumer(_options.queue_capacity));
+
+            for (auto& c : _consumers) {
+                auto raw  = c.get();
+                c->thread = std::thread([this, raw] { consume(*raw); });
+            }
+        }
+
+        /// \brief Stops polling and waits until every queued event has been delivered.
+        ~watcher()
+        {
+            halt_poller();
+            _stop.store(true);
+            for (auto& c : _consumers) {
+                {
+                    std::lock_guard<std::mutex> lock(c->lock);
+                }
+                c->wake.notify_one();
+                c->thread.join();
+            }
+        }
+
+        watcher(const watcher&) = delete;
+        watcher& operator=(const watcher&) = delete;
+
+        /// \brief Watches [address; address + size]. The first tick after this call records the contents
+        ///        and following ticks report changes to on_change.
+        /// \return An id identifying the watch in events and for remove().
+        template<class Address>
+        std::size_t add(Address address, std::size_t size, callback on_change)
+        {
+            std::lock_guard<std::mutex> lock(_watches_lock);
+            const auto                  id = _next_id++;
+            _watches.push_back({id, jm::detail::pointer_cast<std::uintptr_t>(address), size, 0
+                                , std::make_shared<const callback>(std::move(on_change)), false, false});
+            _relayout = true;
+            return id;
+        }
+
+        /// \brief Stops watching. Events that were already queued are still delivered.
+        /// \return Whether the watch existed.
+        bool remove(std::size_t id)
+        {
+            std::lock_guard<std::mutex> lock(_watches_lock);
+            const auto it = std::find_if(_watches.begin(), _watches.end(), [id](const watch& w) { return w.id == id; });
+            if (it == _watches.end())
+                return false;
+
+            _watches.erase(it);
+            _relayout = true;
+            return true;
+        }
+
+        /// \brief The number of watches.
+        std::size_t size()
+        {
+            std::lock_guard<std::mutex> lock(_watches_lock);
+            return _watches.size();
+        }
+
+        /// \brief The number of completed ticks.
+        std::uint64_t ticks()
+        {
+            std::lock_guard<std::mutex> lock(_watches_lock);
+            return _tick;
+        }
+
+        /// \brief The number of events dropped because the ring of their consumer was full.
+        std::uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+
+        /// \brief Runs one tick on the calling thread.
+        /// \throw Throws if the underlying read_many throws, for example if the process no longer exists.
+        void poll()
+        {
+            std::lock_guard<std::mutex> lock(_watches_lock);
+            if (_relayout)
+                relayout();
+
+            for (std::size_t i = 0; i < _requests.size(); ++i)
+                _requests[i].buffer = _current.data() + _watches[i].offset;
+
+            _memory->read_many(_requests.data(), _requests.size());
+            ++_tick;
+
+            // bytes that could not be read keep their last known contents so they do not show up as changes
+            for (std::size_t i = 0; i < _requests.size(); ++i) {
+                const auto& w  = _watches[i];
+                const auto  in = std::min(_requests[i].transferred, w.size);
+                if (in != w.size)
+                    std::copy_n(_shadow.data() + w.offset + in, w.size - in, _current.data() + w.offset + in);
+            }
+
+            for (std::size_t i = 0; i < _requests.size(); ++i) {
+                const auto& w        = _watches[i];
+                const auto  readable = _requests[i].succeeded();
+                if (w.primed && readable != w.readable) {
+                    const auto in = readable ? 0 : _requests[i].transferred;
+                    emit(w, w.address + in, w.size - in, readable, _current.data() + w.offset + in);
+                }
+            }
+
+            std::size_t index = 0;
+            std::size_t first = 0;
+            std::size_t last  = 0;
+            // a watch that became readable again was already reported as a whole with its new contents
+            const auto  flush = [&] {
+                const auto& w = _watches[index];
+                if (last != first && w.primed && !(_requests[index].succeeded() && !w.readable))
+                    emit(w, w.address + (first - w.offset), last - first, true, _current.data() + first);
+                first = last = 0;
+            };
+
+            // runs arrive in ascending order, so a single sweep maps them to their watches
+            auto on_run = [&](std::size_t offset, std::size_t size) {
+                const auto end = offset + size;
+                while (offset < end) {
+                    while (_watches[index].offset + _watches[index].size <= offset) {
+                        flush();
+                        ++index;
+                    }
+
+                    const auto& w = _watches[index];
+                    if (last == first)
+                        first = offset;
+                    last   = std::min(end, w.offset + w.size);
+                    offset = last;
+                }
+            };
+
+            detail::find_differences(_shadow.data(), _current.data(), _current.size(), on_run);
+            if (!_watches.empty())
+                flush();
+
+            for (std::size_t i = 0; i < _requests.size(); ++i) {
+                auto&      w        = _watches[i];
+                const auto readable = _requests[i].succeeded();
+                w.primed   = w.primed || readable;
+                w.readable = readable;
+            }
+
+            _shadow.swap(_current);
+
+            for (auto& c : _consumers) {
+                if (!c->notified)
+                    continue;
+
+                c->notified = false;
+                {
+                    std::lock_guard<std::mutex> consumer_lock(c->lock);
+                }
+                c->wake.notify_one();
+            }
+        }
+
+        /// \brief Starts polling on a background thread every options.interval.
+        void start()
+        {
+            std::lock_guard<std::mutex> lock(_poller_lock);
+            if (_polling)
+                return;
+
+            if (_poller.joinable())
+                _poller.join();
+
+            _error   = nullptr;
+            _polling = true;
+            _poller  = std::thread([this] { poll_loop(); });
+        }
+
+        /// \brief Stops the background polling.
+        /// \throw Rethrows the exception that stopped the polling thread, if any.
+        void stop()
+        {
+            halt_poller();
+            if (_error) {
+                auto error = _error;
+                _error     = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        /// \brief Whether the background thread is polling.
+        bool running()
+        {
+            std::lock_guard<std::mutex> lock(_poller_lock);
+            return _polling;
+        }
+    };
+
+    template<class Memory>
+    inline std::unique_ptr<watcher<Memory>> make_watcher(const Memory&          memory
+                                                         , const watcher_options& options = watcher_options{})
+    {
+        return std::unique_ptr<watcher<Memory>>(new watcher<Memory>(memory, options));
+    }
+
+} // namespace remote
+
+#endif // include guard
@@ -0,0 +1,81 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WRITE_BATCH_HPP
+#define REMOTE_MEMORY_WRITE_BATCH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <system_error>
+#include "detail/utils.hpp"
+#include "native_types.hpp"
+
+namespace remote {
+
+    /// \brief A single entry of a batched write.
+    ///        address, buffer and size describe the write, transferred is filled in by remote::write_batch.
+    struct write_request {
+        std::uintptr_t address     = 0;
+        const void*    buffer      = nullptr;
+        std::size_t    size        = 0;
+        std::size_t    transferred = 0;
+
+        write_request() = default;
+
+        template<class Address, class T>
+        write_request(Address address_, const T* buffer_, std::size_t size_ = sizeof(T)) noexcept(!jm::detail::checked_pointers)
+                : address(jm::detail::pointer_cast<std::uintptr_t>(address_))
+                , buffer(buffer_)
+                , size(size_)
+        {}
+
+        /// \brief Whether the whole [address; address + size] range was written.
+        bool succeeded() const noexcept { return transferred == size; }
+    };
+
+    /// \brief Overwrites every remote memory range described by requests with the contents of their buffers
+    ///        using as few system calls as possible.
+    /// \param handle The handle to remote process.
+    /// \param requests Pointer to the first request. The transferred member of every request is overwritten.
+    /// \param count The number of requests.
+    /// \return The number of requests that were written completely.
+    /// \throw Throws an std::system_error if the batch could not be processed at all (for example the process
+    ///        no longer exists). A request touching unmapped or read only memory does not throw - it only fails
+    ///        that request.
+    /// \note A failed request may have been partially written - transferred holds the number of bytes that were.
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count);
+
+    /// \brief Overwrites every remote memory range described by requests with the contents of their buffers
+    ///        using as few system calls as possible.
+    /// \param handle The handle to remote process.
+    /// \param requests Pointer to the first request. The transferred member of every request is overwritten.
+    /// \param count The number of requests.
+    /// \param ec The error code that will be set if the batch could not be processed at all.
+    ///           Requests touching unmapped or read only memory only have their transferred member set accordingly.
+    /// \return The number of requests that were written completely.
+    /// \throw Does not throw.
+    inline std::size_t write_batch(const native_handle_t handle, write_request* requests, std::size_t count
+                                   , std::error_code& ec) noexcept;
+
+} // namespace remote
+
+#if defined(__linux__)
+    #include "detail/linux/write_batch.inl"
+#else
+    #include "detail/write_batch.inl"
+#endif
+
+#endif // include guard
@@ -0,0 +1,319 @@
+/*
+* Copyright 2017 Justas Masiulis
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REMOTE_MEMORY_WRITE_BUFFER_HPP
+#define REMOTE_MEMORY_WRITE_BUFFER_HPP
+
+#include "write_batch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+// equal bytes are only left out of a flush if at least this many follow each other
+#ifndef REMOTE_MEMORY_WRITE_BUFFER_MIN_GAP
+    #define REMOTE_MEMORY_WRITE_BUFFER_MIN_GAP 16
+#endif
+
+namespace remote {
+
+    /// \brief What a flush of a write_buffer did.
+    struct write_buffer_result {
+        /// the number of ranges handed to write_many
+        std::size_t requests = 0;
+        /// the number of bytes written
+        std::size_t bytes    = 0;
+        /// the number of bytes left out because the shadow copy already held them
+        std::size_t skipped  = 0;
+        /// the number of ranges that were not written completely
+        std::size_t failed   = 0;
+    };
+
+    /// \brief Collects writes and applies them with a single write_many.
+    ///        Overlapping and adjacent writes are merged, later writes win where they overlap.
+    ///        Shadow copies describe what the target is known to hold. Bytes equal to them are left out of the flush
+    ///        and the shadows are updated with whatever was written.
+    /// \code auto writes = remote::make_write_buffer(mem);
+    ///       writes.add_shadow(player_address, &local_player, sizeof(local_player));
+    ///       writes.write(player_address + 0x10, health);
+    ///       writes.write(player_address + 0x14, armor);
+    ///       writes.flush(); // one write of 8 bytes, none if both were unchanged
+    template<class Memory>
+    class write_buffer {
+        struct entry {
+            std::uintptr_t address;
+            std::size_t    offset;
+            std::size_t    size;
+        };
+
+        struct shadow {
+            std::uintptr_t address;
+            std::size_t    size;
+            std::uint8_t*  data;
+        };
+
+        // a merged range, its bytes are at offset in _merged
+        struct range {
+            std::uintptr_t address;
+            std::size_t    size;
+            std::size_t    offset;
+        };
+
+        const Memory*              _memory;
+        std::size_t                _min_gap = REMOTE_MEMORY_WRITE_BUFFER_MIN_GAP;
+        std::vector<entry>         _entries;
+        std::vector<std::uint8_t>  _bytes;
+        std::vector<shadow>        _shadows;
+
+        // reused by every flush
+        std::vector<std::size_t>   _order;
+        std::vector<range>         _ranges;
+        std::vector<std::uint8_t>  _merged;
+        std::vector<write_request> _requests;
+
+        void merge()
+        {
+            _order.resize(_entries.size());
+            for (std::size_t i = 0; i < _order.size(); ++i)
+                _order[i] = i;
+
+            std::sort(_order.begin(), _order.end(), [this](std::size_t a, std::size_t b) {
+                return _entries[a].address < _entries[b].address;
+            });
+
+            _ranges.clear();
+            std::size_t total = 0;
+            for (auto i : _order) {
+                const auto& e = _entries[i];
+                if (!_ranges.empty() && e.address <= _ranges.back().address + _ranges.back().size) {
+                    auto&      r   = _ranges.back();
+                    const auto end = std::max(r.address + r.size, e.address + e.size);
+                    total += end - (r.address + r.size);
+                    r.size = end - r.address;
+                }
+                else {
+                    _ranges.push_back({e.address, e.size, total});
+                    total += e.size;
+                }
+            }
+
+            // applying the writes in the order they were made lets later ones win
+            _merged.resize(total);
+            for (const auto& e : _entries) {
+                const auto r = std::upper_bound(_ranges.begin(), _ranges.end(), e.address
+                                                , [](std::uintptr_t a, const range& x) { return a < x.address; })
+                               - 1;
+                std::memcpy(_merged.data() + r->offset + (e.address - r->address), _bytes.data() + e.offset, e.size);
+            }
+        }
+
+        // splits every merged range into the runs of bytes that differ from the shadows
+        void diff(write_buffer_result& result)
+        {
+            std::sort(_shadows.begin(), _shadows.end(), [](const shadow& a, const shadow& b) {
+                return a.address < b.address;
+            });
+
+            _requests.clear();
+            for (const auto& r : _ranges) {
+                const auto bytes = _merged.data() + r.offset;
+                const auto end   = r.address + r.size;
+
+                // the first shadow that may cover the range
+                auto next = std::upper_bound(_shadows.begin(), _shadows.end(), r.address
+                                             , [](std::uintptr_t a, const shadow& s) { return a < s.address; });
+                if (next != _shadows.begin() && (next - 1)->address + (next - 1)->size > r.address)
+                    --next;
+
+                // the pending run of changed bytes is extended over gaps of equal bytes shorter than min_gap
+                std::uintptr_t run_begin = 0, run_end = 0;
+                bool           pending   = false;
+                const auto     changed   = [&](std::uintptr_t from, std::uintptr_t to) {
+                    if (pending && from - run_end < _min_gap) {
+                        run_end = to;
+                        return;
+                    }
+
+                    if (pending)
+                        _requests.emplace_back(run_begin, bytes + (run_begin - r.address), run_end - run_begin);
+                    run_begin = from;
+                    run_end   = to;
+                    pending   = true;
+                };
+
+                for (auto address = r.address; address < end;) {
+                    while (next != _shadows.end() && next->address + next->size <= address)
+                        ++next;
+
+                    // bytes not covered by a shadow always count as changed
+                    if (next == _shadows.end() || next->address > address) {
+                        const auto stop = next == _shadows.end() ? end : std::min(end, next->address);
+                        changed(address, stop);
+                        address = stop;
+                        continue;
+                    }
+
+                    // equal words are skipped eight bytes at a time
+                    const auto stop   = std::min(end, next->address + next->size);
+                    const auto copy   = next->data;
+                    const auto base   = next->address;
+                    while (address < stop) {
+                        const auto known = copy + (address - base);
+                        const auto value = bytes + (address - r.address);
+                        if (stop - address >= 8 && std::memcmp(known, value, 8) == 0) {
+                            address += 8;
+                            continue;
+                        }
+
+                        if (*known != *value)
+                            changed(address, address + 1);
+                        ++address;
+                    }
+                }
+
+                if (pending)
+                    _requests.emplace_back(run_begin, bytes + (run_begin - r.address), run_end - run_begin);
+            }
+
+            std::size_t requested = 0;
+            for (const auto& request : _requests)
+                requested += request.size;
+
+            result.requests = _requests.size();
+            result.skipped  = _merged.size() - requested;
+        }
+
+        // copies what was written into the shadows that cover it
+        void update_shadows(write_buffer_result& result)
+        {
+            for (const auto& request : _requests) {
+                result.bytes += request.transferred;
+                result.failed += !request.succeeded();
+
+                const auto begin = request.address;
+                const auto end   = begin + request.transferred;
+                auto       s     = std::upper_bound(_shadows.begin(), _shadows.end(), begin
+                                                    , [](std::uintptr_t a, const shadow& x) { return a < x.address; });
+                if (s != _shadows.begin())
+                    --s;
+
+                for (; s != _shadows.end() && s->address < end; ++s) {
+                    const auto from = std::max(begin, s->address);
+                    const auto to   = std::min(end, s->address + s->size);
+                    if (from < to)
+                        std::memcpy(s->data + (from - s->address)
+                                    , static_cast<const std::uint8_t*>(request.buffer) + (from - begin), to - from);
+                }
+            }
+        }
+
+        template<class WriteMany>
+        write_buffer_result flush_with(WriteMany write_many)
+        {
+            write_buffer_result result;
+            if (_entries.empty())
+                return result;
+
+            merge();
+            diff(result);
+            _entries.clear();
+            _bytes.clear();
+
+            if (!_requests.empty() && !write_many(_requests.data(), _requests.size()))
+                return result;
+
+            update_shadows(result);
+            return result;
+        }
+
+    public:
+        explicit write_buffer(const Memory& memory) noexcept : _memory(&memory) {}
+
+        const Memory& memory() const noexcept { return *_memory; }
+
+        /// \brief Buffers a write of [address; address + size]. The data is copied.
+        template<class Address, class T>
+        void write(Address address, const T* buffer, std::size_t size)
+        {
+            const auto offset = _bytes.size();
+            _bytes.insert(_bytes.end(), reinterpret_cast<const std::uint8_t*>(buffer)
+                          , reinterpret_cast<const std::uint8_t*>(buffer) + size);
+            if (size)
+                _entries.push_back({jm::detail::pointer_cast<std::uintptr_t>(address), offset, size});
+        }
+
+        template<class Address, class T>
+        void write(Address address, const T& value)
+        {
+            write(address, std::addressof(value), sizeof(T));
+        }
+
+        /// \brief Registers a local copy of what the target holds at [address; address + size].
+        ///        The copy is not owned and is kept up to date by flush. Shadows must not overlap.
+        template<class Address>
+        void add_shadow(Address address, void* copy, std::size_t size)
+        {
+            _shadows.push_back({jm::detail::pointer_cast<std::uintptr_t>(address), size
+                                , static_cast<std::uint8_t*>(copy)});
+        }
+
+        void clear_shadows() noexcept { _shadows.clear(); }
+
+        /// \brief Runs of equal bytes shorter than this are written anyway instead of splitting the range.
+        std::size_t min_gap() const noexcept { return _min_gap; }
+        void min_gap(std::size_t bytes) noexcept { _min_gap = std::max<std::size_t>(bytes, 1); }
+
+        /// \brief The number of buffered writes.
+        std::size_t size() const noexcept { return _entries.size(); }
+        bool empty() const noexcept { return _entries.empty(); }
+
+        /// \brief Drops the buffered writes without applying them.
+        void discard() noexcept
+        {
+            _entries.clear();
+            _bytes.clear();
+        }
+
+        /// \brief Applies the buffered writes with a single write_many and empties the buffer.
+        /// \throw Throws if the underlying write_many throws. The writes are dropped in that case.
+        write_buffer_result flush()
+        {
+            return flush_with([this](write_request* requests, std::size_t count) {
+                _memory->write_many(requests, count);
+                return true;
+            });
+        }
+
+        /// \param ec The error code that will be set if the whole batch failed. The shadows are not updated then.
+        write_buffer_result flush(std::error_code& ec)
+        {
+            return flush_with([this, &ec](write_request* requests, std::size_t count) {
+                _memory->write_many(requests, count, ec);
+                return !ec;
+            });
+        }
+    };
+
+    template<class Memory>
+    inline write_buffer<Memory> make_write_buffer(const Memory& memory) noexcept
+    {
+        return write_buffer<Memory>(memory);
+    }
+
+} // namespace remote
+
+#endif // include guard
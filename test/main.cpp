@@ -1,5 +1,7 @@
 #include <catch_with_main.hpp>
 #include <remote_memory.hpp>
+#include <vector>
+#include <algorithm>
 
 const int   integer  = 26;
 const float floating = 1.26f;
@@ -376,4 +378,2064 @@ TEST_CASE("traverse_pointers_chain")
     auto result = mem.read<std::uint64_t>(mem.traverse_pointers_chain(reinterpret_cast<std::uintptr_t>(data) + offset, offset));
 
     REQUIRE(result == 111 );
-}
\ No newline at end of file
+}
+
+TEST_CASE("resolve_pointer_chains")
+{
+    struct node {
+        std::uint64_t value;
+        node*         next;
+    };
+
+    node third{111, nullptr};
+    node second{222, &third};
+    node first{333, &second};
+    node* root = &first;
+
+    const auto                       next = static_cast<std::ptrdiff_t>(offsetof(node, next));
+    const std::vector<std::ptrdiff_t> to_third{next, next, 0};
+    const std::vector<std::ptrdiff_t> to_first{0};
+    const std::vector<std::ptrdiff_t> past_end{next, next, next, 0};
+    const std::vector<std::ptrdiff_t> none;
+
+    std::vector<remote::pointer_chain> chains = {{&root, to_third}, {&root, to_first}, {&root, past_end}
+                                                 , {&root, none}, {std::uintptr_t{16}, to_first}};
+    REQUIRE(mem.resolve_pointer_chains(chains) == 3);
+
+    REQUIRE(chains[0].resolved);
+    REQUIRE(chains[0].result == 111);
+    REQUIRE(chains[0].result == mem.traverse_pointers_chain(reinterpret_cast<std::uintptr_t>(&root), next, next, 0));
+    REQUIRE(chains[1].resolved);
+    REQUIRE(chains[1].result == 333);
+    // third.next is null, so the last read fails
+    REQUIRE_FALSE(chains[2].resolved);
+    REQUIRE(chains[2].failed_level == 4);
+    REQUIRE(chains[3].resolved);
+    REQUIRE(chains[3].result == reinterpret_cast<std::uintptr_t>(&first));
+    REQUIRE_FALSE(chains[4].resolved);
+    REQUIRE(chains[4].failed_level == 0);
+
+    std::error_code ec;
+    REQUIRE(mem.resolve_pointer_chains(chains.data(), 2, ec) == 2);
+    REQUIRE_FALSE(ec);
+}
+TEST_CASE("read_many(requests)")
+{
+    SECTION("every request succeeds") {
+        int   i = 0;
+        float f = 0;
+        const int* ptr = nullptr;
+
+        std::vector<remote::read_request> requests = {
+            {ptr_i, &i},
+            {reinterpret_cast<std::uintptr_t>(&floating), &f},
+            {&ptr_i, &ptr}
+        };
+
+        REQUIRE(mem.read_many(requests) == 3);
+        for (auto& request : requests)
+            REQUIRE(request.succeeded());
+
+        REQUIRE(i == integer);
+        REQUIRE(f == floating);
+        REQUIRE(ptr == ptr_i);
+    }
+
+    SECTION("a failing request does not fail the batch") {
+        int first = 0, last = 0, unused = 0;
+        std::vector<remote::read_request> requests = {
+            {ptr_i, &first},
+            {std::uintptr_t{16}, &unused},
+            {ptr_i, &last}
+        };
+
+        std::error_code ec;
+        REQUIRE(mem.read_many(requests, ec) == 2);
+        REQUIRE_FALSE(ec);
+        REQUIRE(requests[0].succeeded());
+        REQUIRE_FALSE(requests[1].succeeded());
+        REQUIRE(requests[1].transferred == 0);
+        REQUIRE(requests[2].succeeded());
+        REQUIRE(first == integer);
+        REQUIRE(last == integer);
+    }
+
+    SECTION("batches larger than the vectored call limit") {
+        std::vector<std::uint32_t>        source(5000), destination(5000);
+        std::vector<remote::read_request> requests;
+        for (std::size_t i = 0; i < source.size(); ++i) {
+            source[i] = static_cast<std::uint32_t>(i * 7);
+            // sprinkle in some unreadable requests
+            if (i % 1000 == 999)
+                requests.emplace_back(std::uintptr_t{16}, &destination[i]);
+            else
+                requests.emplace_back(&source[i], &destination[i]);
+        }
+
+        REQUIRE(mem.read_many(requests) == source.size() - 5);
+        for (std::size_t i = 0; i < source.size(); ++i)
+            if (i % 1000 != 999)
+                REQUIRE(destination[i] == source[i]);
+    }
+}
+
+TEST_CASE("write_many(requests)")
+{
+    SECTION("every request succeeds") {
+        int   i = 0;
+        float f = 0;
+        const int* ptr = nullptr;
+
+        std::vector<remote::write_request> requests = {
+            {&i, &integer},
+            {reinterpret_cast<std::uintptr_t>(&f), &floating},
+            {&ptr, &ptr_i}
+        };
+
+        REQUIRE(mem.write_many(requests) == 3);
+        for (auto& request : requests)
+            REQUIRE(request.transferred == request.size);
+
+        REQUIRE(i == integer);
+        REQUIRE(f == floating);
+        REQUIRE(ptr == ptr_i);
+    }
+
+    SECTION("a failing request does not fail the batch") {
+        int first = 0, last = 0;
+        std::vector<remote::write_request> requests = {
+            {&first, &integer},
+            {ptr_i, &integer}, // read only
+            {std::uintptr_t{16}, &integer},
+            {&last, &integer}
+        };
+
+        std::error_code ec;
+        REQUIRE(mem.write_many(requests, ec) == 2);
+        REQUIRE_FALSE(ec);
+        REQUIRE(requests[0].succeeded());
+        REQUIRE(requests[1].transferred == 0);
+        REQUIRE(requests[2].transferred == 0);
+        REQUIRE(requests[3].succeeded());
+        REQUIRE(first == integer);
+        REQUIRE(last == integer);
+    }
+}
+
+TEST_CASE("staged reads")
+{
+    std::vector<int> source(4096), destination(4096, 0);
+    for (std::size_t i = 0; i < source.size(); ++i)
+        source[i] = static_cast<int>(i);
+
+    const auto size = source.size() * sizeof(int);
+
+    SECTION("the whole size is copied") {
+        mem.read(source.data(), destination.data(), size);
+        REQUIRE(destination == source);
+    }
+
+    SECTION("caller supplied arena") {
+        remote::staging_arena arena;
+        mem.read(source.data(), destination.data(), size, arena);
+        REQUIRE(destination == source);
+        REQUIRE(arena.capacity() >= size);
+
+        // the arena is reused once it has grown
+        const auto capacity = arena.capacity();
+        std::error_code ec;
+        mem.read(source.data(), destination.data(), size, arena, ec);
+        REQUIRE_FALSE(ec);
+        REQUIRE(arena.capacity() == capacity);
+    }
+
+    SECTION("reads above the arena limit still work") {
+        remote::staging_arena arena(64);
+        mem.read(source.data(), destination.data(), size, arena);
+        REQUIRE(destination == source);
+        REQUIRE(arena.capacity() == 0);
+    }
+
+    SECTION("failed reads leave the buffer unchanged") {
+        std::error_code ec;
+        mem.read(std::uintptr_t{16}, destination.data(), size, ec);
+        REQUIRE(ec);
+        REQUIRE(std::count(destination.begin(), destination.end(), 0) == static_cast<std::ptrdiff_t>(destination.size()));
+        REQUIRE_THROWS(mem.read(std::uintptr_t{16}, destination.data(), size));
+    }
+}
+
+#if defined(__linux__)
+
+#include <remote_memory/procmem_operations_policy.hpp>
+#include <sys/mman.h>
+
+TEST_CASE("procmem_operations_policy")
+{
+    remote::basic_memory<remote::procmem_operations_policy> procmem;
+
+    SECTION("reads and writes") {
+        REQUIRE(procmem.read<int>(ptr_i) == integer);
+        REQUIRE(procmem.read<float>(&floating) == floating);
+
+        int i = 0;
+        procmem.write(&i, integer);
+        REQUIRE(i == integer);
+
+        std::error_code ec;
+        REQUIRE(procmem.read<const int*>(&ptr_i, ec) == ptr_i);
+        REQUIRE_FALSE(ec);
+    }
+
+    SECTION("below the threshold process_vm_readv / writev is used") {
+        procmem.threshold(64);
+        REQUIRE(procmem.read<int>(ptr_i) == integer);
+
+        int i = 0;
+        procmem.write(&i, integer);
+        REQUIRE(i == integer);
+    }
+
+    const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto pages = static_cast<std::uint8_t*>(::mmap(nullptr, page * 2, PROT_READ | PROT_WRITE
+                                                   , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+
+    SECTION("writes to read only pages") {
+        ::mprotect(pages, page, PROT_READ);
+        procmem.write(pages, integer);
+        REQUIRE(*reinterpret_cast<const int*>(pages) == integer);
+
+        procmem.threshold(64);
+        const float f = floating;
+        procmem.write(pages + sizeof(int), f);
+        float read_back;
+        std::memcpy(&read_back, pages + sizeof(int), sizeof(float));
+        REQUIRE(read_back == floating);
+    }
+
+    SECTION("partial and failed reads") {
+        ::munmap(pages + page, page);
+
+        std::vector<std::uint8_t> buffer(page * 2);
+        std::error_code           ec;
+        procmem.read(pages, buffer.data(), buffer.size(), ec);
+        REQUIRE(ec == std::errc::result_out_of_range);
+        REQUIRE_THROWS_AS(procmem.read(pages, buffer.data(), buffer.size()), std::range_error);
+
+        ec.clear();
+        procmem.read(pages + page, buffer.data(), page, ec);
+        REQUIRE(ec == std::errc::bad_address);
+        REQUIRE_THROWS_AS(procmem.read(pages + page, buffer.data(), page), std::system_error);
+
+        // unmapped memory is reported the same way on both sides of the threshold
+        procmem.threshold(64);
+        ec.clear();
+        procmem.read(pages + page, buffer.data(), std::size_t{8}, ec);
+        REQUIRE(ec == std::errc::bad_address);
+        ec.clear();
+        procmem.write(pages + page, buffer.data(), std::size_t{8}, ec);
+        REQUIRE(ec == std::errc::bad_address);
+        ec.clear();
+        procmem.write(pages + page, buffer.data(), page, ec);
+        REQUIRE(ec == std::errc::bad_address);
+    }
+
+    ::munmap(pages, page * 2);
+}
+
+#endif
+
+#if defined(__linux__)
+
+#include <remote_memory/region_checked_operations_policy.hpp>
+
+TEST_CASE("region_map")
+{
+    remote::region_map regions;
+    REQUIRE_FALSE(regions.empty());
+    REQUIRE(std::is_sorted(regions.begin(), regions.end(), [](remote::region a, remote::region b) {
+        return a.begin < b.begin;
+    }));
+
+    SECTION("lookups") {
+        auto constant = regions.find(ptr_i);
+        REQUIRE(constant != regions.end());
+        REQUIRE((*constant).contains(reinterpret_cast<std::uintptr_t>(ptr_i)));
+        REQUIRE((*constant).readable());
+        REQUIRE_FALSE((*constant).writable());
+
+        int  local = 0;
+        auto stack = regions.find(&local);
+        REQUIRE(stack != regions.end());
+        REQUIRE((*stack).writable());
+
+        REQUIRE(regions.find(std::uintptr_t{16}) == regions.end());
+        REQUIRE(regions.contains(ptr_i, sizeof(int)));
+        REQUIRE_FALSE(regions.contains(ptr_i, sizeof(int), remote::protection::write));
+        REQUIRE_FALSE(regions.contains(std::uintptr_t{16}, 1));
+    }
+
+    SECTION("filtered iteration") {
+        std::vector<int> heap(1024);
+        bool             found = false;
+        for (auto r : regions.filter(remote::region_filter{remote::protection::read | remote::protection::write
+                                                           , remote::protection::none
+                                                           , remote::region_filter::anonymous})) {
+            REQUIRE(r.readable());
+            REQUIRE(r.writable());
+            REQUIRE(r.anonymous());
+            found |= r.contains(reinterpret_cast<std::uintptr_t>(heap.data()));
+        }
+        REQUIRE(found);
+    }
+
+    SECTION("refresh") {
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto       mapping = ::mmap(nullptr, page * 3, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        REQUIRE(mapping != MAP_FAILED);
+        // a hole in the middle of the mapping
+        ::munmap(static_cast<char*>(mapping) + page, page);
+
+        const auto generation = regions.generation();
+        REQUIRE(regions.refresh());
+        REQUIRE(regions.generation() == generation + 1);
+        REQUIRE_FALSE(regions.refresh());
+
+        REQUIRE(regions.contains(mapping, page));
+        REQUIRE_FALSE(regions.contains(mapping, page + 1));
+        REQUIRE(regions.find(static_cast<char*>(mapping) + page) == regions.end());
+
+        ::munmap(mapping, page * 3);
+    }
+}
+
+TEST_CASE("region_checked_operations_policy")
+{
+    remote::region_map                                               regions;
+    remote::basic_memory<remote::region_checked_operations_policy<>> checked(regions);
+
+    REQUIRE(checked.read<int>(ptr_i) == integer);
+
+    std::error_code ec;
+    checked.read<int>(std::uintptr_t{16}, ec);
+    REQUIRE(ec == std::errc::bad_address);
+    REQUIRE_THROWS_AS(checked.read<int>(std::uintptr_t{16}), std::system_error);
+
+    int first = 0, last = 0, unused = 0;
+    std::vector<remote::read_request> requests = {
+        {ptr_i, &first},
+        {std::uintptr_t{16}, &unused},
+        {ptr_i, &last}
+    };
+    REQUIRE(checked.read_many(requests) == 2);
+    REQUIRE(requests[0].succeeded());
+    REQUIRE(requests[1].transferred == 0);
+    REQUIRE(requests[2].succeeded());
+    REQUIRE(first == integer);
+    REQUIRE(last == integer);
+
+    // basic_memory forwards the error_code overloads from noexcept functions
+    using checked_policy = remote::region_checked_operations_policy<>;
+    static_assert(noexcept(std::declval<const checked_policy&>().read_many(nullptr, 0, ec)), "");
+    static_assert(noexcept(std::declval<const checked_policy&>().write_many(nullptr, 0, ec)), "");
+}
+
+#endif
+
+#include <remote_memory/pattern_scan.hpp>
+
+TEST_CASE("pattern_scan")
+{
+    std::vector<std::uint8_t> data(4096 * 4);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 31 % 251);
+
+    const std::uint8_t signature[] = {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0xC3};
+    // one match straddles a 64 byte chunk boundary
+    const std::size_t offsets[] = {3, 100, 60, 4000, data.size() - sizeof(signature)};
+    for (auto offset : offsets)
+        std::memcpy(data.data() + offset, signature, sizeof(signature));
+
+    std::vector<std::uintptr_t> expected;
+    for (auto offset : offsets)
+        expected.push_back(reinterpret_cast<std::uintptr_t>(data.data()) + offset);
+    std::sort(expected.begin(), expected.end());
+
+    const auto begin = reinterpret_cast<std::uintptr_t>(data.data());
+    const auto end   = begin + data.size();
+
+    SECTION("parsing") {
+        REQUIRE(remote::pattern("48 8B ?? ? 05").size() == 5);
+        REQUIRE_THROWS_AS(remote::pattern(""), std::invalid_argument);
+        REQUIRE_THROWS_AS(remote::pattern("48 8X"), std::invalid_argument);
+    }
+
+    SECTION("every match is found with and without wildcards") {
+        for (auto chunk_size : {std::size_t{64}, std::size_t{REMOTE_MEMORY_SCAN_CHUNK_SIZE}}) {
+            remote::pattern_scanner scanner(chunk_size);
+            REQUIRE(scanner.find_all(mem, begin, end, remote::pattern("48 8B 05 11 22 33 C3")) == expected);
+            REQUIRE(scanner.find_all(mem, begin, end, remote::pattern("48 ?? 05 ? 22 33 ??")) == expected);
+            REQUIRE(scanner.find_all(mem, begin, end, remote::pattern(signature, "x?xxx?x")) == expected);
+            REQUIRE(scanner.find_first(mem, begin, end, remote::pattern("48 8B 05 11 22 33 C3")) == expected[0]);
+        }
+
+        REQUIRE(remote::pattern_scan(mem, begin, end, remote::pattern("48 8B 05 11 22 33 C3")) == expected);
+    }
+
+    SECTION("wildcard only patterns match everywhere") {
+        REQUIRE(remote::pattern_scan(mem, begin, begin + 16, remote::pattern("?? ??")).size() == 15);
+    }
+
+    SECTION("no matches") {
+        REQUIRE(remote::pattern_scanner().find_first(mem, begin, end, remote::pattern("DE AD BE EF")) == 0);
+    }
+
+#if defined(__linux__)
+    SECTION("unreadable memory is skipped") {
+        const auto page  = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto       pages = static_cast<std::uint8_t*>(::mmap(nullptr, page * 3, PROT_READ | PROT_WRITE
+                                                             , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        REQUIRE(pages != MAP_FAILED);
+        std::memcpy(pages + 8, signature, sizeof(signature));
+        std::memcpy(pages + page * 2 + 8, signature, sizeof(signature));
+        ::munmap(pages + page, page);
+
+        const auto first = reinterpret_cast<std::uintptr_t>(pages);
+        const auto found = remote::pattern_scan(mem, first, first + page * 3, remote::pattern("48 8B 05 11 22 33 C3"));
+        REQUIRE(found == std::vector<std::uintptr_t>{first + 8, first + page * 2 + 8});
+
+        ::munmap(pages, page * 3);
+    }
+#endif
+}
+
+#include <remote_memory/parallel_scan.hpp>
+
+TEST_CASE("parallel_scanner")
+{
+    std::vector<std::uint32_t> data(64 * 1024);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint32_t>(i % 1000);
+
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+    };
+    const auto begin   = reinterpret_cast<std::uintptr_t>(data.data());
+    const auto size    = data.size() * sizeof(std::uint32_t);
+    // two regions with a gap between them
+    const std::vector<range> regions = {{begin, begin + size / 2 - 64}, {begin + size / 2, begin + size}};
+
+    remote::parallel_scanner scanner(4, 4096);
+    const auto               factory = [] { return remote::memory(); };
+
+    SECTION("value kernel") {
+        const auto found = scanner.scan(factory, regions, remote::value_kernel<std::uint32_t>(777));
+
+        std::vector<std::uintptr_t> expected;
+        for (const auto& r : regions)
+            for (auto address = r.begin; address < r.end; address += sizeof(std::uint32_t))
+                if (*reinterpret_cast<const std::uint32_t*>(address) == 777)
+                    expected.push_back(address);
+
+        REQUIRE_FALSE(found.empty());
+        REQUIRE(found == expected);
+    }
+
+    SECTION("predicate kernel") {
+        const auto found = scanner.scan(factory, regions, remote::make_predicate_kernel<std::uint32_t>(
+                [](std::uint32_t v) { return v >= 990; }));
+        REQUIRE(std::is_sorted(found.begin(), found.end()));
+        for (auto address : found)
+            REQUIRE(*reinterpret_cast<const std::uint32_t*>(address) >= 990);
+    }
+
+    SECTION("pattern kernel finds matches across chunk boundaries") {
+        // 998 999 0 1 straddles every 4000 byte period, which never lines up with the 4096 byte chunks
+        const remote::pattern p("E6 03 00 00 E7 03 00 00 00 00 00 00 01 00 00 00");
+        remote::pattern_scanner sequential;
+        std::vector<std::uintptr_t> expected;
+        for (const auto& r : regions) {
+            const auto part = sequential.find_all(mem, r.begin, r.end, p);
+            expected.insert(expected.end(), part.begin(), part.end());
+        }
+
+        REQUIRE(expected.size() > 10);
+        REQUIRE(scanner.scan(factory, regions, remote::pattern_kernel(p)) == expected);
+    }
+
+#if defined(__linux__)
+    SECTION("an unreadable page only hides itself") {
+        const std::size_t page  = 4096;
+        auto              pages = static_cast<std::uint8_t*>(
+                ::mmap(nullptr, page * 8, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        REQUIRE(pages != MAP_FAILED);
+        std::vector<std::uintptr_t> expected;
+        for (std::size_t i = 0; i < 8; ++i) {
+            const std::uint32_t value = 777;
+            std::memcpy(pages + i * page + 64, &value, sizeof(value));
+            if (i != 2)
+                expected.push_back(reinterpret_cast<std::uintptr_t>(pages + i * page + 64));
+        }
+        ::mprotect(pages + page * 2, page, PROT_NONE);
+
+        // the whole mapping is one chunk
+        const auto               base    = reinterpret_cast<std::uintptr_t>(pages);
+        const std::vector<range> mapping = {{base, base + page * 8}};
+        remote::parallel_scanner one_chunk(2, page * 8);
+        REQUIRE(one_chunk.scan(factory, mapping, remote::value_kernel<std::uint32_t>(777)) == expected);
+        ::munmap(pages, page * 8);
+    }
+#endif
+}
+
+#include <remote_memory/scan_session.hpp>
+
+TEST_CASE("scan_session")
+{
+    std::vector<std::int32_t> data(16 * 1024, 5);
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+    };
+    const auto               begin   = reinterpret_cast<std::uintptr_t>(data.data());
+    const std::vector<range> regions = {{begin, begin + data.size() * sizeof(std::int32_t)}};
+    const auto               address = [&](std::size_t i) { return reinterpret_cast<std::uintptr_t>(&data[i]); };
+
+    auto session = remote::make_scan_session<std::int32_t>(mem);
+    REQUIRE_THROWS_AS(session.first_scan(regions, remote::scan_condition::changed), std::invalid_argument);
+
+    SECTION("dense candidates") {
+        REQUIRE(session.first_scan(regions, remote::scan_condition::equal, 5) == data.size());
+
+        for (std::size_t i = 0; i < data.size(); i += 3)
+            data[i] = 6;
+        REQUIRE(session.next_scan(remote::scan_condition::unchanged) == data.size() - (data.size() + 2) / 3);
+        REQUIRE(session.next_scan(remote::scan_condition::equal, 5) == data.size() - (data.size() + 2) / 3);
+
+        data[1] = 9;
+        data[2] = 1;
+        REQUIRE(session.next_scan(remote::scan_condition::changed) == 2);
+        REQUIRE(session.addresses() == std::vector<std::uintptr_t>{address(1), address(2)});
+
+        data[1] = 10;
+        data[2] = 10;
+        REQUIRE(session.next_scan(remote::scan_condition::decreased) == 0);
+    }
+
+    SECTION("sparse candidates") {
+        const std::size_t indices[] = {0, 7, 1000, 1001, 5000, 16383};
+        for (auto i : indices)
+            data[i] = 100 + static_cast<std::int32_t>(i);
+
+        REQUIRE(session.first_scan(regions, remote::scan_condition::in_range, 100, 20000) == 6);
+        std::size_t n = 0;
+        session.for_each([&](std::uintptr_t a, std::int32_t v) {
+            REQUIRE(a == address(indices[n]));
+            REQUIRE(v == data[indices[n]]);
+            ++n;
+        });
+        REQUIRE(n == 6);
+
+        data[7]    += 1;
+        data[16383] += 2;
+        data[1000] -= 1;
+        REQUIRE(session.next_scan(remote::scan_condition::increased) == 2);
+        REQUIRE(session.addresses() == std::vector<std::uintptr_t>{address(7), address(16383)});
+        REQUIRE(session.next_scan(remote::scan_condition::greater, 110) == 1);
+        REQUIRE(session.addresses() == std::vector<std::uintptr_t>{address(16383)});
+    }
+}
+
+#include <remote_memory/cached_operations_policy.hpp>
+
+TEST_CASE("cached_operations_policy")
+{
+    alignas(4096) static std::uint32_t values[3 * 1024];
+    for (std::size_t i = 0; i < 3 * 1024; ++i)
+        values[i] = static_cast<std::uint32_t>(i);
+
+    remote::basic_memory<remote::cached_operations_policy<>> cached;
+    cached.prefetch(2);
+
+    // basic_memory forwards the error_code overloads from noexcept functions
+    std::error_code no_ec;
+    using cached_policy = remote::cached_operations_policy<>;
+    static_assert(noexcept(std::declval<const cached_policy&>().read_many(nullptr, 0, no_ec)), "");
+    static_assert(noexcept(std::declval<const cached_policy&>().write_many(nullptr, 0, no_ec)), "");
+
+    REQUIRE(cached.read<std::uint32_t>(&values[10]) == 10);
+    REQUIRE(cached.statistics().misses == 1);
+    // the second page was prefetched by the first miss
+    REQUIRE(cached.read<std::uint32_t>(&values[1030]) == 1030);
+    REQUIRE(cached.statistics().hits == 1);
+
+    SECTION("reads are served from the cache until the epoch changes") {
+        values[11] = 0;
+        REQUIRE(cached.read<std::uint32_t>(&values[11]) == 11);
+        cached.next_epoch();
+        REQUIRE(cached.read<std::uint32_t>(&values[11]) == 0);
+
+        cached.max_age(1);
+        values[11] = 5;
+        cached.next_epoch();
+        REQUIRE(cached.read<std::uint32_t>(&values[11]) == 0);
+        cached.invalidate(&values[11], 4);
+        REQUIRE(cached.read<std::uint32_t>(&values[11]) == 5);
+    }
+
+    SECTION("reads spanning pages") {
+        std::uint32_t buffer[4];
+        cached.read(&values[1022], buffer, sizeof(buffer));
+        REQUIRE(buffer[0] == 1022);
+        REQUIRE(buffer[3] == 1025);
+    }
+
+    SECTION("writes are written through") {
+        cached.write(&values[12], std::uint32_t{1234});
+        REQUIRE(values[12] == 1234);
+        REQUIRE(cached.read<std::uint32_t>(&values[12]) == 1234);
+
+        std::uint32_t v = 99;
+        remote::write_request request(&values[13], &v);
+        REQUIRE(cached.write_many(&request, 1) == 1);
+        REQUIRE(cached.read<std::uint32_t>(&values[13]) == 99);
+    }
+
+    SECTION("batched reads") {
+        std::uint32_t a = 0, b = 0;
+        remote::read_request requests[] = {{&values[20], &a}, {&values[2100], &b}, {std::uintptr_t{16}, &a}};
+        REQUIRE(cached.read_many(requests, 3) == 2);
+        REQUIRE(a == 20);
+        REQUIRE(b == 2100);
+        REQUIRE_FALSE(requests[2].succeeded());
+    }
+
+    SECTION("evictions") {
+        cached.capacity(2);
+        cached.prefetch(1);
+        for (std::size_t i = 0; i < 3; ++i)
+            REQUIRE(cached.read<std::uint32_t>(&values[i * 1024]) == i * 1024);
+        REQUIRE(cached.statistics().evictions == 1);
+        REQUIRE_THROWS(cached.read<std::uint32_t>(std::uintptr_t{16}));
+    }
+}
+
+#include <remote_memory/snapshot.hpp>
+
+TEST_CASE("snapshot")
+{
+    std::vector<std::uint8_t> data(64 * 1024 + 13);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 7);
+
+    const auto begin = reinterpret_cast<std::uintptr_t>(data.data());
+    const auto end   = begin + data.size();
+    const auto at    = [&](std::size_t i) { return begin + i; };
+
+    remote::snapshot before;
+    before.capture(mem, begin, end, 4096);
+    REQUIRE(before.size() == data.size());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(before.data()) % remote::snapshot::page_size == 0);
+    REQUIRE(before.find(at(100), 4) != nullptr);
+    REQUIRE(*before.find(at(100)) == data[100]);
+    REQUIRE(before.find(end, 1) == nullptr);
+
+    REQUIRE(remote::diff(before, mem).empty());
+
+    // changes inside a vector block, across a 64 byte block and across a chunk boundary
+    data[3] ^= 1;
+    for (std::size_t i = 60; i < 70; ++i)
+        data[i] ^= 0xFF;
+    for (std::size_t i = 4090; i < 4100; ++i)
+        data[i] ^= 0xFF;
+    data.back() ^= 1;
+
+    const std::vector<remote::changed_range> expected = {
+            {at(3), 1}, {at(60), 10}, {at(4090), 10}, {at(data.size() - 1), 1}};
+    REQUIRE(remote::diff(before, mem, 4096) == expected);
+
+    remote::snapshot after;
+    after.capture(mem, begin, end);
+    REQUIRE(remote::diff(before, after) == expected);
+    REQUIRE(remote::diff(after, after).empty());
+
+    SECTION("recapture reads chosen ranges again in place") {
+        data[5] ^= 1;
+        data[5000] ^= 1;
+        const std::vector<remote::changed_range> changed = {{at(0), 8}, {at(4996), 8}, {end - 4, 16}};
+        REQUIRE(before.recapture(mem, changed) == 20);
+        REQUIRE(*before.find(at(5)) == data[5]);
+        REQUIRE(*before.find(at(5000)) == data[5000]);
+        REQUIRE(*before.find(at(3)) == data[3]);
+        REQUIRE(*before.find(at(60)) != data[60]);
+    }
+
+#if defined(__linux__)
+    SECTION("unreadable memory") {
+        const auto page  = remote::snapshot::page_size;
+        auto       pages = static_cast<std::uint8_t*>(
+                ::mmap(nullptr, page * 3, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        REQUIRE(pages != MAP_FAILED);
+        std::memset(pages, 1, page * 3);
+        ::mprotect(pages + page, page, PROT_NONE);
+
+        const auto base = reinterpret_cast<std::uintptr_t>(pages);
+        remote::snapshot s;
+        s.capture(mem, base, base + page * 3);
+        REQUIRE(s.size() == page * 2);
+        REQUIRE(s.ranges().size() == 2);
+        REQUIRE(s.find(base + page) == nullptr);
+
+        ::mprotect(pages + page, page, PROT_READ | PROT_WRITE);
+        ::mprotect(pages + page * 2, page, PROT_NONE);
+        const std::vector<remote::changed_range> unreadable = {{base + page * 2, page}};
+        REQUIRE(remote::diff(s, mem) == unreadable);
+        ::munmap(pages, page * 3);
+    }
+#endif
+}
+
+#if defined(__linux__)
+
+#include <remote_memory/dump.hpp>
+#include <fstream>
+
+TEST_CASE("dump_regions")
+{
+    const std::size_t page  = 4096;
+    auto              pages = static_cast<std::uint8_t*>(
+            ::mmap(nullptr, page * 4, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+    for (std::size_t i = 0; i < page * 4; ++i)
+        pages[i] = static_cast<std::uint8_t>(i * 13);
+    ::mprotect(pages + page, page, PROT_NONE);
+
+    const auto           base      = reinterpret_cast<std::uintptr_t>(pages);
+    const remote::region regions[] = {
+            {base, base + page * 3, 0, 0, 0, 0, remote::protection::read | remote::protection::write, "[test]"},
+            {base + page * 3 + 100, base + page * 4, 0, 0, 0, 0, remote::protection::read, ""}};
+
+    const auto check = [&](const char* path, const remote::dump_result& result) {
+        REQUIRE(result.entries == 3);
+        REQUIRE(result.bytes == page * 3 - 100);
+        REQUIRE(result.unreadable == page);
+
+        const auto entries = remote::read_dump_index(path);
+        REQUIRE(entries.size() == 3);
+        REQUIRE(entries[0].address == base);
+        REQUIRE(entries[0].size == page);
+        REQUIRE(entries[0].path == "[test]");
+        REQUIRE(entries[1].address == base + page * 2);
+        REQUIRE(entries[1].permissions == (remote::protection::read | remote::protection::write));
+        REQUIRE(entries[2].address == base + page * 3 + 100);
+        REQUIRE(entries[2].path.empty());
+
+        std::ifstream file(path, std::ios::binary);
+        for (const auto& e : entries) {
+            REQUIRE(e.file_offset % page == e.address % page);
+            std::vector<char> data(e.size);
+            file.seekg(static_cast<std::streamoff>(e.file_offset));
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            REQUIRE(std::memcmp(data.data(), reinterpret_cast<const void*>(e.address), e.size) == 0);
+        }
+    };
+
+    const char* path = "remote_memory_test.dump";
+    SECTION("zero copy") {
+        remote::dump_options options;
+        options.zero_copy = true;
+        options.map_size  = page;
+        const auto result = remote::dump_regions(mem, regions, path, options);
+        REQUIRE(result.zero_copy);
+        check(path, result);
+    }
+
+    SECTION("double buffered") {
+        remote::dump_options options;
+        options.chunk_size = page;
+        const auto result  = remote::dump_regions(mem, regions, path, options);
+        REQUIRE_FALSE(result.zero_copy);
+        check(path, result);
+    }
+
+    SECTION("errors") {
+        std::error_code ec;
+        remote::dump_regions(mem, regions, "/nonexistent/directory/file", remote::dump_options{}, ec);
+        REQUIRE(ec);
+        REQUIRE_THROWS_AS(remote::read_dump_index("/nonexistent/directory/file"), std::system_error);
+    }
+
+    std::remove(path);
+    ::munmap(pages, page * 4);
+}
+
+#endif
+
+#if defined(__linux__)
+
+#include <remote_memory/async_memory.hpp>
+#include <atomic>
+
+TEST_CASE("async_memory")
+{
+    const auto page  = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto       pages = static_cast<std::uint8_t*>(::mmap(nullptr, page * 2, PROT_READ | PROT_WRITE
+                                                         , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+    for (std::size_t i = 0; i < page; ++i)
+        pages[i] = static_cast<std::uint8_t>(i * 7);
+
+    const auto run = [&](remote::async_options options) {
+        remote::async_memory memory(::getpid(), options);
+        // unmapped only now so the rings of the engine can not take the place of the page
+        ::munmap(pages + page, page);
+
+        SECTION("futures") {
+            int value = 0;
+            REQUIRE(memory.read(ptr_i, &value, sizeof(value)).get() == sizeof(value));
+            REQUIRE(value == integer);
+
+            const int written = integer + 1;
+            int       target  = 0;
+            REQUIRE(memory.write(&target, &written, sizeof(written)).get() == sizeof(written));
+            REQUIRE(target == written);
+
+            auto unmapped = memory.read(pages + page, &value, sizeof(value));
+            try {
+                unmapped.get();
+                FAIL("the read of unmapped memory succeeded");
+            } catch (const std::system_error& e) {
+                REQUIRE(e.code() == std::errc::bad_address);
+            }
+        }
+
+        SECTION("callbacks") {
+            std::vector<std::uint8_t> buffers(page * 64);
+            std::atomic<std::size_t>  completed{0};
+            for (std::size_t i = 0; i < 64; ++i)
+                memory.read(pages, buffers.data() + i * page, page
+                            , [&](const std::error_code& ec, std::size_t transferred) {
+                                if (!ec && transferred == page)
+                                    ++completed;
+                            });
+            memory.drain();
+            REQUIRE(memory.pending() == 0);
+            REQUIRE(completed == 64);
+            for (std::size_t i = 0; i < 64; ++i)
+                REQUIRE(std::memcmp(buffers.data() + i * page, pages, page) == 0);
+        }
+
+        SECTION("partial reads") {
+            std::vector<std::uint8_t> buffer(page * 2);
+            std::error_code           result;
+            std::size_t               transferred = 0;
+            memory.read(pages, buffer.data(), buffer.size(), [&](const std::error_code& ec, std::size_t n) {
+                result      = ec;
+                transferred = n;
+            });
+            memory.drain();
+            REQUIRE(result == std::errc::result_out_of_range);
+            REQUIRE(transferred == page);
+        }
+    };
+
+    remote::async_options options;
+    SECTION("default") { run(options); }
+
+    SECTION("batched") {
+        options.queue_depth  = 8;
+        options.submit_batch = 16;
+        run(options);
+    }
+
+    SECTION("thread pool") {
+        options.thread_pool = true;
+        options.threads     = 2;
+        run(options);
+        REQUIRE_FALSE(remote::async_memory(::getpid(), options).uses_io_uring());
+    }
+
+    std::error_code ec;
+    remote::async_memory(-1, remote::async_options{}, ec);
+    REQUIRE(ec);
+
+    ::munmap(pages, page);
+}
+
+#endif
+
+#include <remote_memory/watcher.hpp>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+TEST_CASE("watcher")
+{
+    static volatile std::uint64_t values[32] = {};
+    std::mutex                    lock;
+    std::vector<remote::watch_event> events;
+    const auto record = [&](const remote::watch_event& e) {
+        std::lock_guard<std::mutex> guard(lock);
+        events.push_back(e);
+    };
+    const auto wait_for_events = [&](std::size_t count) {
+        for (int i = 0; i < 2000; ++i) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (events.size() >= count)
+                    return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    };
+
+    remote::watcher_options options;
+    options.consumers = 2;
+    remote::watcher<remote::memory> w(mem, options);
+    const auto first  = w.add(&values[0], 8 * sizeof(std::uint64_t), record);
+    const auto second = w.add(&values[16], sizeof(std::uint64_t), record);
+    REQUIRE(w.size() == 2);
+
+    SECTION("the first tick only records the contents") {
+        values[0] = 1;
+        w.poll();
+        w.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(events.empty());
+        REQUIRE(w.ticks() == 2);
+    }
+
+    SECTION("changes are reported per watch") {
+        w.poll();
+        values[1] = 0x1111;
+        values[3] = 0x2222;
+        values[16] = 7;
+        values[17] = 7; // not watched
+        w.poll();
+        REQUIRE(wait_for_events(2));
+
+        std::sort(events.begin(), events.end()
+                  , [](const remote::watch_event& a, const remote::watch_event& b) { return a.id < b.id; });
+        REQUIRE(events[0].id == first);
+        REQUIRE(events[0].address == reinterpret_cast<std::uintptr_t>(&values[1]));
+        REQUIRE(events[0].size == 2 * sizeof(std::uint64_t) + 2);
+        REQUIRE(events[0].readable);
+        REQUIRE(events[0].data[0] == 0x11);
+        REQUIRE(events[1].id == second);
+        REQUIRE(events[1].size == 1);
+        REQUIRE(events[1].data[0] == 7);
+
+        w.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(events.size() == 2);
+    }
+
+    SECTION("removed watches are not reported") {
+        w.poll();
+        REQUIRE(w.remove(second));
+        REQUIRE_FALSE(w.remove(second));
+        values[16] = 9;
+        values[2]  = 9;
+        w.poll();
+        REQUIRE(wait_for_events(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].id == first);
+    }
+
+    SECTION("background polling") {
+        w.start();
+        REQUIRE(w.running());
+        while (w.ticks() < 1)
+            std::this_thread::yield();
+        values[5] = 42;
+        REQUIRE(wait_for_events(1));
+        w.stop();
+        REQUIRE_FALSE(w.running());
+        REQUIRE(events[0].data[0] == 42);
+    }
+
+    for (auto& v : values)
+        v = 0;
+}
+
+#if defined(__linux__)
+
+TEST_CASE("watcher reports ranges that become unreadable")
+{
+    const auto page  = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto       pages = static_cast<std::uint8_t*>(::mmap(nullptr, page * 2, PROT_READ | PROT_WRITE
+                                                         , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+
+    std::mutex                       lock;
+    std::vector<remote::watch_event> events;
+    {
+        remote::watcher<remote::memory> w(mem);
+        w.add(pages + page - 8, 16, [&](const remote::watch_event& e) {
+            std::lock_guard<std::mutex> guard(lock);
+            events.push_back(e);
+        });
+
+        w.poll();
+        ::mprotect(pages + page, page, PROT_NONE);
+        w.poll();
+        ::mprotect(pages + page, page, PROT_READ | PROT_WRITE);
+        pages[page] = 1;
+        w.poll();
+    }
+
+    // the destructor delivers every queued event. Becoming readable again is a single event with the new bytes
+    REQUIRE(events.size() == 2);
+    REQUIRE_FALSE(events[0].readable);
+    REQUIRE(events[0].address == reinterpret_cast<std::uintptr_t>(pages + page));
+    REQUIRE(events[0].size == 8);
+    REQUIRE(events[1].readable);
+    REQUIRE(events[1].address == reinterpret_cast<std::uintptr_t>(pages + page - 8));
+    REQUIRE(events[1].size == 16);
+    REQUIRE(events[1].data[8] == 1);
+    ::munmap(pages, page * 2);
+}
+
+#endif
+
+#include <remote_memory/view.hpp>
+
+namespace {
+
+    struct test_name {
+        char text[16];
+    };
+
+    struct test_entity {
+        int            health;
+        float          speed;
+        test_name*     name;
+        std::uintptr_t next;
+    };
+
+} // namespace
+
+TEST_CASE("ptr and view")
+{
+    static test_name   name  = {"entity"};
+    static test_entity other = {50, 2.f, nullptr, 0};
+    static test_entity entity = {100, 1.5f, &name, reinterpret_cast<std::uintptr_t>(&other)};
+
+    auto p = remote::make_ptr<test_entity>(mem, &entity);
+    REQUIRE(p.address() == reinterpret_cast<std::uintptr_t>(&entity));
+    REQUIRE(p.read(&test_entity::health) == 100);
+    REQUIRE(p.read<remote::field<float, 4>>() == 1.5f);
+    REQUIRE(p.at(&test_entity::speed).address() == reinterpret_cast<std::uintptr_t>(&entity.speed));
+
+    SECTION("views fetch the whole object once") {
+        auto v = p.get();
+        REQUIRE_FALSE(v.fetched());
+        REQUIRE(v->health == 100);
+        REQUIRE(v.fetched());
+
+        entity.health = 1;
+        REQUIRE(v->*&test_entity::health == 100);
+        REQUIRE(v.get<remote::field<int, 0>>() == 100);
+        v.refresh();
+        REQUIRE(v->health == 1);
+        entity.health = 100;
+    }
+
+    SECTION("pointers are followed lazily") {
+        auto v    = p.get();
+        auto n    = v.follow(&test_entity::name);
+        auto next = v.follow<test_entity>(&test_entity::next);
+        REQUIRE_FALSE(n.fetched());
+        REQUIRE(std::string(n->text) == "entity");
+        REQUIRE(next->health == 50);
+        REQUIRE(next.follow<test_entity>(&test_entity::next).address() == 0);
+    }
+
+    SECTION("writes update the local copy") {
+        auto v = p.get();
+        REQUIRE(v->speed == 1.5f);
+        v.write(&test_entity::speed, 3.f);
+        REQUIRE(entity.speed == 3.f);
+        REQUIRE(v->speed == 3.f);
+        p.write(&test_entity::speed, 1.5f);
+        REQUIRE(entity.speed == 1.5f);
+    }
+
+    SECTION("arrays") {
+        static test_entity entities[3] = {{1, 0.f, nullptr, 0}, {2, 0.f, nullptr, 0}, {3, 0.f, nullptr, 0}};
+        auto               array       = remote::make_ptr<test_entity>(mem, &entities[0]);
+        REQUIRE(array[2]->health == 3);
+        REQUIRE((array + 1).read().health == 2);
+    }
+
+    SECTION("several views are fetched together") {
+        auto a = p.get();
+        auto b = remote::make_view<test_entity>(mem, &other);
+        auto c = remote::make_view<test_entity>(mem, std::uintptr_t{0});
+        REQUIRE(remote::fetch(a, b, c) == 1);
+        REQUIRE(a.fetched());
+        REQUIRE(b.fetched());
+        REQUIRE_FALSE(c.fetched());
+        REQUIRE(b->health == 50);
+        REQUIRE_THROWS(c.get());
+
+        std::error_code ec;
+        c.get(ec);
+        REQUIRE(ec);
+
+        std::vector<remote::view<test_entity, remote::memory>> views = {p.get(), b, c};
+        REQUIRE(remote::fetch(views.data(), views.size()) == 1);
+        REQUIRE(views[0]->health == 100);
+    }
+}
+
+#if defined(__GLIBCXX__)
+
+#include <remote_memory/containers.hpp>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+TEST_CASE("libstdcxx containers")
+{
+    namespace stdcxx = remote::libstdcxx;
+
+    SECTION("vector") {
+        const std::vector<int> v = {1, 2, 3, 4, 5};
+        REQUIRE(stdcxx::read<stdcxx::vector<int>>(mem, &v) == v);
+
+        const auto elements = stdcxx::elements<stdcxx::vector<int>>(mem, &v);
+        REQUIRE(elements.size() == 5);
+        REQUIRE(elements.address(2) == reinterpret_cast<std::uintptr_t>(&v[2]));
+        REQUIRE(*elements[4] == 5);
+
+        const std::vector<int> empty;
+        REQUIRE(stdcxx::read<stdcxx::vector<int>>(mem, &empty).empty());
+    }
+
+    SECTION("list") {
+        for (int size : {0, 1, 2, 7, 100}) {
+            std::list<double> l;
+            for (int i = 0; i < size; ++i)
+                l.push_back(i * 1.5);
+
+            const auto values = stdcxx::read<stdcxx::list<double>>(mem, &l);
+            REQUIRE(std::vector<double>(l.begin(), l.end()) == values);
+
+            const auto elements = stdcxx::elements<stdcxx::list<double>>(mem, &l);
+            REQUIRE(elements.size() == l.size());
+            if (size)
+                REQUIRE(elements.address(0) == reinterpret_cast<std::uintptr_t>(&l.front()));
+        }
+    }
+
+    SECTION("set and map") {
+        std::set<std::uint16_t>        s;
+        std::map<int, std::uint64_t> m;
+        for (int i = 0; i < 100000; ++i) {
+            const auto key = (i * 7919) % 100003;
+            s.insert(static_cast<std::uint16_t>(key));
+            m[key] = static_cast<std::uint64_t>(key) * 3;
+        }
+
+        REQUIRE(stdcxx::read<stdcxx::set<std::uint16_t>>(mem, &s) == std::vector<std::uint16_t>(s.begin(), s.end()));
+
+        const auto entries = stdcxx::read<stdcxx::map<int, std::uint64_t>>(mem, &m);
+        REQUIRE(entries.size() == m.size());
+        auto it = m.begin();
+        for (const auto& e : entries) {
+            REQUIRE(e.first == it->first);
+            REQUIRE(e.second == it->second);
+            ++it;
+        }
+
+        const auto elements = stdcxx::elements<stdcxx::map<int, std::uint64_t>>(mem, &m);
+        REQUIRE(elements.address(0) == reinterpret_cast<std::uintptr_t>(&*m.begin()));
+        REQUIRE(elements[1]->second == std::next(m.begin())->second);
+
+        const std::map<int, int> empty;
+        REQUIRE(stdcxx::read<stdcxx::map<int, int>>(mem, &empty).empty());
+    }
+
+    SECTION("unordered set and map") {
+        std::unordered_map<std::uint32_t, float> m;
+        std::unordered_set<std::uint64_t>        s;
+        for (std::uint32_t i = 0; i < 10000; ++i) {
+            m[i * 13] = static_cast<float>(i);
+            s.insert(i * 31ull);
+        }
+
+        const auto entries = stdcxx::read<stdcxx::unordered_map<std::uint32_t, float>>(mem, &m);
+        REQUIRE(entries.size() == m.size());
+        auto it = m.begin();
+        for (const auto& e : entries) {
+            REQUIRE(e.first == it->first);
+            REQUIRE(e.second == it->second);
+            ++it;
+        }
+
+        REQUIRE(stdcxx::read<stdcxx::unordered_set<std::uint64_t>>(mem, &s)
+                == std::vector<std::uint64_t>(s.begin(), s.end()));
+        REQUIRE(stdcxx::elements<stdcxx::unordered_set<std::uint64_t>>(mem, &s).address(0)
+                == reinterpret_cast<std::uintptr_t>(&*s.begin()));
+
+        const std::unordered_map<int, int> one = {{1, 2}};
+        REQUIRE(stdcxx::read<stdcxx::unordered_map<int, int>>(mem, &one).size() == 1);
+    }
+
+    SECTION("broken structures") {
+        // a list claiming three elements whose first node is unreadable
+        const std::uintptr_t broken_list[] = {0x10, 0x10, 3};
+        std::error_code      ec;
+        stdcxx::read<stdcxx::list<int>>(mem, broken_list, ec);
+        REQUIRE(ec == std::errc::bad_address);
+        REQUIRE_THROWS_AS(stdcxx::read<stdcxx::list<int>>(mem, broken_list), std::system_error);
+
+        // a map whose recorded size is smaller than the tree
+        std::map<int, int> m = {{1, 1}, {2, 2}, {3, 3}};
+        std::uintptr_t     layout[6];
+        std::memcpy(layout, &m, sizeof(layout));
+        layout[5] = 2;
+        ec.clear();
+        stdcxx::read<stdcxx::map<int, int>>(mem, layout, ec);
+        REQUIRE(ec == std::errc::bad_message);
+
+        // a vector that ends before it starts
+        std::vector<int> v = {1, 2, 3};
+        std::uintptr_t   vector_layout[3];
+        std::memcpy(vector_layout, &v, sizeof(vector_layout));
+        std::swap(vector_layout[0], vector_layout[1]);
+        ec.clear();
+        REQUIRE(stdcxx::read<stdcxx::vector<int>>(mem, vector_layout, ec).empty());
+        REQUIRE(ec == std::errc::bad_message);
+
+        // an unordered_map with far more buckets than it could ever have, holding more nodes than elements
+        std::unordered_map<int, int> u = {{1, 1}, {2, 2}};
+        std::uintptr_t               table[7];
+        std::vector<std::uintptr_t>  buckets(100000);
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+            buckets[i] = 0x1000 + i * 16;
+        std::memcpy(table, &u, sizeof(table));
+        table[0] = reinterpret_cast<std::uintptr_t>(buckets.data());
+        table[1] = std::uintptr_t{1} << 60;
+        ec.clear();
+        stdcxx::read<stdcxx::unordered_map<int, int>>(mem, table, ec);
+        REQUIRE(ec == std::errc::bad_message);
+    }
+}
+
+#endif
+
+#include <remote_memory/stats_operations_policy.hpp>
+#include <thread>
+
+TEST_CASE("latency_histogram")
+{
+    using histogram = remote::latency_histogram;
+    for (std::uint64_t ns : {0ull, 3ull, 4ull, 7ull, 8ull, 1000ull, 123456789ull, ~0ull}) {
+        const auto bucket = histogram::bucket(ns);
+        REQUIRE(bucket < histogram::bucket_count);
+        REQUIRE(histogram::lower_bound(bucket) <= ns);
+        if (bucket + 1 < histogram::bucket_count)
+            REQUIRE(histogram::lower_bound(bucket + 1) > ns);
+    }
+    REQUIRE(std::min<std::size_t>(1000, histogram::bucket_count) == 252);
+    REQUIRE(std::min<std::size_t>(1000, remote::transfer_statistics::error_buckets) == 128);
+
+    histogram h;
+    h.add(histogram::bucket(100), 99);
+    h.add(histogram::bucket(10000), 1);
+    REQUIRE(h.total() == 100);
+    REQUIRE(h.percentile(0.5) == histogram::lower_bound(histogram::bucket(100)));
+    REQUIRE(h.percentile(0.995) == histogram::lower_bound(histogram::bucket(10000)));
+}
+
+TEST_CASE("stats_operations_policy")
+{
+    using stats_policy = remote::stats_operations_policy<>;
+    std::error_code no_ec;
+    static_assert(noexcept(std::declval<const stats_policy&>().read_many(nullptr, 0, no_ec)), "");
+    static_assert(noexcept(std::declval<const stats_policy&>().write_many(nullptr, 0, no_ec)), "");
+
+    remote::basic_memory<stats_policy> stats;
+
+    REQUIRE(stats.read<int>(ptr_i) == integer);
+    std::error_code ec;
+    stats.read<int>(std::uintptr_t{16}, ec);
+    REQUIRE(ec);
+    REQUIRE_THROWS_AS(stats.read<int>(std::uintptr_t{16}), std::system_error);
+
+    int first = 0, unused = 0;
+    std::vector<remote::read_request> requests = {{ptr_i, &first}, {std::uintptr_t{16}, &unused}};
+    REQUIRE(stats.read_many(requests) == 1);
+
+    // a second thread keeps its own counters until they are merged
+    std::thread([&] {
+        int value = 0;
+        stats.write(&value, 5);
+    }).join();
+
+    auto s = stats.stats();
+    REQUIRE(s.read.calls == 3);
+    REQUIRE(s.read.requests == 3);
+    REQUIRE(s.read.bytes_requested == 3 * sizeof(int));
+    REQUIRE(s.read.bytes_transferred == sizeof(int));
+    REQUIRE(s.read.failures == 2);
+    // the error is platform specific
+    REQUIRE(s.errors_of(ec.value()) == 2);
+    REQUIRE(s.read.latency.total() == 3);
+
+    REQUIRE(s.read_many.calls == 1);
+    REQUIRE(s.read_many.requests == 2);
+    REQUIRE(s.read_many.bytes_transferred == sizeof(int));
+    REQUIRE(s.read_many.failures == 1);
+
+    REQUIRE(s.write.calls == 1);
+    REQUIRE(s.write.bytes_transferred == sizeof(int));
+    REQUIRE(s.write_many.calls == 0);
+
+    SECTION("copies share counters") {
+        auto copy = stats;
+        copy.read<int>(ptr_i);
+        REQUIRE(stats.stats().read.calls == 4);
+    }
+
+    SECTION("reset") {
+        stats.reset_stats();
+        s = stats.stats();
+        REQUIRE(s.read.calls == 0);
+        REQUIRE(s.read.latency.total() == 0);
+        REQUIRE(s.errors_of(ec.value()) == 0);
+    }
+}
+
+#if defined(__linux__)
+
+TEST_CASE("read_best_effort")
+{
+    constexpr std::size_t page = 4096, pages = 64;
+    auto base = static_cast<std::uint8_t*>(::mmap(nullptr, pages * page, PROT_READ | PROT_WRITE
+                                                  , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(base != MAP_FAILED);
+    for (std::size_t i = 0; i < pages * page; ++i)
+        base[i] = static_cast<std::uint8_t>(i / page + 1);
+
+    // holes at the first page, a single page, a long run and the last pages
+    std::vector<bool> readable(pages, true);
+    for (auto hole : {std::make_pair(0, 1), std::make_pair(5, 6), std::make_pair(10, 30), std::make_pair(61, 64)}) {
+        ::mprotect(base + hole.first * page, (hole.second - hole.first) * page, PROT_NONE);
+        for (auto i = hole.first; i < hole.second; ++i)
+            readable[i] = false;
+    }
+
+    remote::basic_memory<remote::stats_operations_policy<>> stats;
+    std::vector<std::uint8_t>                               buffer(pages * page, 0xFF);
+
+    SECTION("unaligned range") {
+        const auto offset = std::size_t{100};
+        const auto size   = pages * page - 2 * offset;
+        auto       result = stats.read_best_effort(base + offset, buffer.data(), size);
+
+        REQUIRE(result.first_page == reinterpret_cast<std::uintptr_t>(base));
+        REQUIRE(result.page_count == pages);
+        REQUIRE_FALSE(result.complete());
+        std::size_t expected = 0;
+        for (std::size_t i = 0; i < pages; ++i) {
+            REQUIRE(result.readable(i) == readable[i]);
+            expected += readable[i] ? page : 0;
+        }
+        REQUIRE(result.transferred == expected);
+
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto p = (i + offset) / page;
+            REQUIRE(buffer[i] == (readable[p] ? base[i + offset] : 0));
+        }
+
+        // the holes are probed instead of reading every page on its own
+        REQUIRE(stats.stats().read_many.calls < pages / 2);
+    }
+
+    SECTION("hole ending before the range") {
+        // the gallop from page 40 overshoots the end, so the pages after the hole are found by the last probe
+        ::mprotect(base + 40 * page, 18 * page, PROT_NONE);
+        auto result = stats.read_best_effort(base + 32 * page, buffer.data(), 29 * page);
+        REQUIRE(result.transferred == 11 * page);
+        for (std::size_t i = 0; i < 29; ++i) {
+            const auto hole = i >= 8 && i < 26;
+            REQUIRE(result.readable(i) == !hole);
+            REQUIRE(buffer[i * page] == (hole ? 0 : base[(32 + i) * page]));
+        }
+    }
+
+    SECTION("readable range") {
+        auto result = stats.read_best_effort(base + 30 * page, buffer.data(), 31 * page);
+        REQUIRE(result.complete());
+        REQUIRE(result.transferred == 31 * page);
+        REQUIRE(stats.stats().read_many.calls == 1);
+    }
+
+    SECTION("unreadable range") {
+        std::error_code ec;
+        auto            result = stats.read_best_effort(base + 10 * page, buffer.data(), 20 * page, ec);
+        REQUIRE_FALSE(ec);
+        REQUIRE(result.transferred == 0);
+        REQUIRE(std::all_of(buffer.begin(), buffer.begin() + 20 * page, [](std::uint8_t b) { return b == 0; }));
+    }
+
+    SECTION("empty range") {
+        auto result = stats.read_best_effort(base, buffer.data(), 0);
+        REQUIRE(result.page_count == 0);
+        REQUIRE(result.complete());
+    }
+
+    ::munmap(base, pages * page);
+}
+
+#endif
+
+#if defined(__linux__)
+
+#include <remote_memory/pointer_scanner.hpp>
+
+namespace {
+
+    struct pointer_scanner_leaf {
+        std::uint64_t padding[5];
+        std::uint32_t value;
+    };
+
+    struct pointer_scanner_node {
+        std::uint64_t         padding[3];
+        pointer_scanner_leaf* leaf;
+    };
+
+    // the root of the path lives in the .bss of the test executable
+    pointer_scanner_node* pointer_scanner_root = nullptr;
+
+} // namespace
+
+TEST_CASE("pointer_scanner")
+{
+    std::unique_ptr<pointer_scanner_node> node(new pointer_scanner_node());
+    std::unique_ptr<pointer_scanner_leaf> leaf(new pointer_scanner_leaf());
+    node->leaf           = leaf.get();
+    pointer_scanner_root = node.get();
+    const auto target    = reinterpret_cast<std::uintptr_t>(&leaf->value);
+
+    remote::pointer_scanner scanner;
+    scanner.scan([] { return remote::memory(); }, remote::region_map());
+    REQUIRE(scanner.size() > 0);
+
+    const std::vector<std::ptrdiff_t> expected = {offsetof(pointer_scanner_node, leaf)
+                                                  , offsetof(pointer_scanner_leaf, value)};
+    const auto                        root     = reinterpret_cast<std::uintptr_t>(&pointer_scanner_root);
+    const auto                        has_path = [&](const std::vector<remote::pointer_path>& paths) {
+        return std::any_of(paths.begin(), paths.end(), [&](const remote::pointer_path& p) {
+            return p.base == root && p.offsets == expected;
+        });
+    };
+
+    remote::pointer_search_options options;
+    options.max_depth  = 3;
+    options.max_offset = 0x100;
+    const auto paths   = scanner.find_paths(target, options);
+    REQUIRE(has_path(paths));
+    for (std::size_t i = 1; i < paths.size(); ++i)
+        REQUIRE(paths[i - 1].offsets.size() <= paths[i].offsets.size());
+
+    SECTION("paths resolve to the target") {
+        const auto& path = *std::find_if(paths.begin(), paths.end(), [&](const remote::pointer_path& p) {
+            return p.base == root;
+        });
+        REQUIRE(path.module.find('/') != std::string::npos);
+        REQUIRE(path.module_offset > 0);
+
+        remote::pointer_chain chain = path.chain();
+        REQUIRE(mem.resolve_pointer_chains(&chain, 1) == 1);
+        REQUIRE(chain.result + path.offsets.back() == target);
+    }
+
+    SECTION("limits prune the search") {
+        options.max_offset = offsetof(pointer_scanner_leaf, value) - 1;
+        REQUIRE_FALSE(has_path(scanner.find_paths(target, options)));
+
+        options.max_offset = 0x100;
+        options.max_depth  = 1;
+        REQUIRE_FALSE(has_path(scanner.find_paths(target, options)));
+
+        options.max_depth   = 3;
+        options.max_results = 1;
+        REQUIRE(scanner.find_paths(target, options).size() == 1);
+    }
+
+    SECTION("save and load") {
+        char path[] = "/tmp/remote_memory_pointer_map_XXXXXX";
+        const auto fd = ::mkstemp(path);
+        REQUIRE(fd != -1);
+        ::close(fd);
+
+        scanner.save(path);
+        remote::pointer_scanner loaded;
+        loaded.load(path);
+        REQUIRE(loaded.size() == scanner.size());
+
+        // the map is reused as is, so it still describes the pointers at the time of the scan
+        pointer_scanner_root = nullptr;
+        REQUIRE(has_path(loaded.find_paths(target, options)));
+
+        std::error_code ec;
+        loaded.load("/nonexistent/remote_memory_pointer_map", ec);
+        REQUIRE(ec);
+        REQUIRE(loaded.empty());
+        ::unlink(path);
+    }
+
+    pointer_scanner_root = nullptr;
+}
+
+#endif
+
+#include <remote_memory/fleet.hpp>
+#if defined(__linux__)
+#include <sys/wait.h>
+#endif
+
+TEST_CASE("fleet")
+{
+    struct worker_state {
+        std::int32_t  requests;
+        std::uint8_t  padding[12];
+        std::uint64_t bytes[2];
+    };
+
+    // every process reads its own copy, selected through the per process base
+    std::vector<worker_state> states(5);
+    for (std::size_t i = 0; i < states.size(); ++i)
+        states[i] = {static_cast<std::int32_t>(i * 10), {}, {i, i * 2}};
+
+    remote::fleet fleet(2);
+    for (std::size_t i = 0; i < states.size(); ++i)
+        REQUIRE(fleet.add(::getpid(), i * sizeof(worker_state)) == i);
+    REQUIRE(fleet.size() == states.size());
+
+    const std::vector<remote::fleet_field> fields = {
+            remote::make_fleet_field<std::int32_t>(&states[0].requests)
+            , {&states[0].bytes, sizeof(states[0].bytes)}};
+
+    auto result = fleet.read(fields);
+    REQUIRE(result.processes() == states.size());
+    REQUIRE(result.fields() == 2);
+    REQUIRE(result.field_size(1) == 16);
+
+    // column major, the values of a field for every process are contiguous
+    const auto requests = result.column_as<std::int32_t>(0);
+    const auto bytes    = result.column_as<std::uint64_t>(1);
+    for (std::size_t p = 0; p < states.size(); ++p) {
+        REQUIRE(result.succeeded(p, 0));
+        REQUIRE(result.succeeded(p, 1));
+        REQUIRE_FALSE(result.error(p));
+        REQUIRE(requests[p] == static_cast<std::int32_t>(p * 10));
+        REQUIRE(bytes[p * 2] == p);
+        REQUIRE(bytes[p * 2 + 1] == p * 2);
+        REQUIRE(result.get<std::int32_t>(p, 0) == requests[p]);
+    }
+
+    SECTION("the storage of a result is reused") {
+        states[3].requests = 1234;
+        fleet.read(fields, result);
+        REQUIRE(result.column_as<std::int32_t>(0)[3] == 1234);
+        REQUIRE(result.column_as<std::int32_t>(0) == requests);
+    }
+
+    SECTION("failures are reported per process and field") {
+        const std::vector<remote::fleet_field> unreadable = {fields[0], {std::uintptr_t{8}, 8}};
+        fleet.read(unreadable, result);
+        for (std::size_t p = 0; p < states.size(); ++p) {
+            REQUIRE(result.succeeded(p, 0));
+            REQUIRE_FALSE(result.succeeded(p, 1));
+        }
+    }
+
+#if defined(__linux__)
+    SECTION("a process that exited does not affect the others") {
+        const auto child = ::fork();
+        if (child == 0)
+            ::_exit(0);
+        ::waitpid(child, nullptr, 0);
+
+        const auto index = fleet.add(child);
+        fleet.read(fields, result);
+        REQUIRE(result.error(index));
+        REQUIRE_FALSE(result.succeeded(index, 0));
+        REQUIRE(result.succeeded(0, 0));
+
+        fleet.remove(index);
+        REQUIRE(fleet.size() == states.size());
+    }
+#endif
+}
+
+#if defined(__linux__)
+
+#include <remote_memory/mapped_operations_policy.hpp>
+#include <fcntl.h>
+
+TEST_CASE("mapped_operations_policy")
+{
+    constexpr std::size_t size   = 4 * 4096;
+    auto                  shared = static_cast<std::uint8_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE
+                                                                     , MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(shared != MAP_FAILED);
+    for (std::size_t i = 0; i < size; ++i)
+        shared[i] = static_cast<std::uint8_t>(i * 7);
+
+    std::vector<std::uint8_t> heap(size, 0x5A);
+
+    // the stats of the underlying policy show which transfers were not served from a mapping
+    using policy = remote::mapped_operations_policy<remote::stats_operations_policy<>>;
+    std::error_code no_ec;
+    static_assert(noexcept(std::declval<const policy&>().read_many(nullptr, 0, no_ec)), "");
+    static_assert(noexcept(std::declval<const policy&>().write_many(nullptr, 0, no_ec)), "");
+    remote::region_map           regions;
+    remote::basic_memory<policy> mapped(regions);
+    std::vector<std::uint8_t>    buffer(size);
+    const auto                   fallbacks = [&] {
+        const auto s = mapped.stats();
+        return s.read.calls + s.read_many.calls + s.write.calls + s.write_many.calls;
+    };
+
+    SECTION("shared memory is read and written without the underlying policy") {
+        mapped.read(shared + 100, buffer.data(), std::size_t{1000});
+        REQUIRE(std::equal(buffer.begin(), buffer.begin() + 1000, shared + 100));
+
+        const std::uint32_t value = 0xDEADBEEF;
+        mapped.write(shared + 4096, value);
+        REQUIRE(std::memcmp(shared + 4096, &value, sizeof(value)) == 0);
+        REQUIRE(fallbacks() == 0);
+
+        // and changes made by the target are seen right away
+        shared[10] = 0x42;
+        REQUIRE(mapped.read<std::uint8_t>(shared + 10) == 0x42);
+        REQUIRE(fallbacks() == 0);
+    }
+
+    SECTION("private memory falls back to the underlying policy") {
+        mapped.read(heap.data(), buffer.data(), size);
+        REQUIRE(buffer == heap);
+        REQUIRE(mapped.stats().read.calls == 1);
+    }
+
+    SECTION("batches are split between the mapping and the underlying policy") {
+        std::uint8_t a[16], b[16], c[16];
+        std::vector<remote::read_request> requests = {
+            {shared, a, sizeof(a)},
+            {heap.data(), b, sizeof(b)},
+            {std::uintptr_t{16}, c, sizeof(c)}
+        };
+        REQUIRE(mapped.read_many(requests) == 2);
+        REQUIRE(requests[0].succeeded());
+        REQUIRE(requests[1].succeeded());
+        REQUIRE(requests[2].transferred == 0);
+        REQUIRE(std::memcmp(a, shared, sizeof(a)) == 0);
+        REQUIRE(std::memcmp(b, heap.data(), sizeof(b)) == 0);
+
+        const auto stats = mapped.stats();
+        REQUIRE(stats.read_many.calls == 1);
+        REQUIRE(stats.read_many.requests == 2);
+    }
+
+    SECTION("private file mappings are only mapped on request") {
+        char path[] = "/tmp/remote_memory_mapped_XXXXXX";
+        const auto fd = ::mkstemp(path);
+        REQUIRE(fd != -1);
+        std::vector<std::uint8_t> contents(8192, 0x11);
+        REQUIRE(::write(fd, contents.data(), contents.size()) == static_cast<::ssize_t>(contents.size()));
+        auto file = static_cast<std::uint8_t*>(::mmap(nullptr, contents.size(), PROT_READ, MAP_PRIVATE, fd, 0));
+        ::close(fd);
+        REQUIRE(file != MAP_FAILED);
+        regions.refresh();
+
+        mapped.read(file, buffer.data(), contents.size());
+        REQUIRE(mapped.stats().read.calls == 1);
+
+        mapped.map_private_files(true);
+        mapped.read(file + 8, buffer.data(), std::size_t{100});
+        REQUIRE(mapped.stats().read.calls == 1);
+        REQUIRE(buffer[0] == 0x11);
+
+        ::munmap(file, contents.size());
+        ::unlink(path);
+    }
+
+    SECTION("mappings are dropped when the region map changes") {
+        mapped.read(shared, buffer.data(), std::size_t{16});
+        REQUIRE(fallbacks() == 0);
+
+        ::munmap(shared + 2 * 4096, 2 * 4096);
+        REQUIRE(regions.refresh());
+
+        std::error_code ec;
+        mapped.read(shared + 2 * 4096, buffer.data(), std::size_t{16}, ec);
+        REQUIRE(ec);
+        REQUIRE(mapped.stats().read.calls == 1);
+
+        mapped.read(shared, buffer.data(), std::size_t{16});
+        REQUIRE(mapped.stats().read.calls == 1);
+    }
+
+    ::munmap(shared, size);
+}
+
+#endif
+
+#include <remote_memory/write_buffer.hpp>
+
+TEST_CASE("write_buffer")
+{
+    std::vector<std::uint8_t>                               target(256, 0);
+    remote::basic_memory<remote::stats_operations_policy<>> stats;
+    auto                                                    writes = remote::make_write_buffer(stats);
+    const auto                                              at     = [&](std::size_t offset) {
+        return target.data() + offset;
+    };
+    const auto fill = [](std::uint8_t value) { return std::vector<std::uint8_t>(8, value); };
+
+    SECTION("overlapping and adjacent writes are merged and later writes win") {
+        writes.write(at(0), fill(0x11).data(), 8);
+        writes.write(at(4), fill(0x22).data(), 8);
+        writes.write(at(12), fill(0x33).data(), 4);
+        writes.write(at(100), fill(0x44).data(), 8);
+        writes.write(at(2), fill(0x55).data(), 1);
+        REQUIRE(writes.size() == 5);
+
+        const auto result = writes.flush();
+        REQUIRE(writes.empty());
+        REQUIRE(result.requests == 2);
+        REQUIRE(result.bytes == 24);
+        REQUIRE(result.failed == 0);
+
+        const auto s = stats.stats();
+        REQUIRE(s.write_many.calls == 1);
+        REQUIRE(s.write.calls == 0);
+
+        const std::vector<std::uint8_t> expected = {0x11, 0x11, 0x55, 0x11, 0x22, 0x22, 0x22, 0x22
+                                                    , 0x22, 0x22, 0x22, 0x22, 0x33, 0x33, 0x33, 0x33, 0};
+        REQUIRE(std::equal(expected.begin(), expected.end(), target.begin()));
+        REQUIRE(target[100] == 0x44);
+        REQUIRE(target[108] == 0);
+    }
+
+    SECTION("bytes held by the shadow are skipped") {
+        std::vector<std::uint8_t> shadow(target);
+        writes.add_shadow(target.data(), shadow.data(), shadow.size());
+
+        writes.write(at(0), std::vector<std::uint8_t>(64, 0).data(), 64);
+        auto result = writes.flush();
+        REQUIRE(result.requests == 0);
+        REQUIRE(result.skipped == 64);
+        REQUIRE(stats.stats().write_many.calls == 0);
+
+        // two changes closer than min_gap become one range, a change far away another one
+        std::vector<std::uint8_t> frame(128, 0);
+        frame[10] = 1;
+        frame[20] = 2;
+        frame[100] = 3;
+        writes.write(at(0), frame.data(), frame.size());
+        result = writes.flush();
+        REQUIRE(result.requests == 2);
+        REQUIRE(result.bytes == 12);
+        REQUIRE(result.skipped == 128 - 12);
+        REQUIRE(target[10] == 1);
+        REQUIRE(target[20] == 2);
+        REQUIRE(target[100] == 3);
+        REQUIRE(shadow == target);
+
+        // bytes outside of every shadow are always written
+        writes.write(at(250), fill(0).data(), 8);
+        result = writes.flush();
+        REQUIRE(result.bytes == 2);
+        REQUIRE(result.skipped == 6);
+    }
+
+    SECTION("min_gap controls when equal bytes split a range") {
+        std::vector<std::uint8_t> shadow(target);
+        writes.add_shadow(target.data(), shadow.data(), shadow.size());
+        writes.min_gap(1);
+
+        std::vector<std::uint8_t> frame(16, 0);
+        frame[0] = frame[2] = 1;
+        writes.write(at(0), frame.data(), frame.size());
+        REQUIRE(writes.flush().requests == 2);
+    }
+
+    SECTION("failed writes are reported") {
+        writes.write(std::uintptr_t{16}, fill(1).data(), 8);
+        writes.write(at(0), fill(1).data(), 8);
+        const auto result = writes.flush();
+        REQUIRE(result.requests == 2);
+        REQUIRE(result.failed == 1);
+        REQUIRE(target[0] == 1);
+    }
+
+    SECTION("discarded writes are not applied") {
+        writes.write(at(0), fill(1).data(), 8);
+        writes.discard();
+        REQUIRE(writes.flush().requests == 0);
+        REQUIRE(target[0] == 0);
+    }
+}
+
+#if defined(__linux__)
+
+#include <remote_memory/symbol_resolver.hpp>
+#include <dlfcn.h>
+#include <link.h>
+
+// exported from the test executable so the resolver finds it in .symtab
+extern "C" {
+    int remote_memory_resolver_probe[4] = {1, 2, 3, 4};
+}
+
+namespace {
+
+    // reads the dynamic section of one image with a string table size far larger than the image
+    struct corrupt_dynamic_memory {
+        std::uintptr_t dynamic;
+
+        void read(std::uintptr_t address, std::uint8_t* buffer, std::size_t size, std::error_code& ec) const
+        {
+            remote::memory().read(address, buffer, size, ec);
+            if (ec || address != dynamic)
+                return;
+
+            for (std::size_t i = 0; i + sizeof(ElfW(Dyn)) <= size; i += sizeof(ElfW(Dyn))) {
+                ElfW(Dyn) entry;
+                std::memcpy(&entry, buffer + i, sizeof(entry));
+                if (entry.d_tag == DT_STRSZ) {
+                    entry.d_un.d_val = std::uint64_t{1} << 60;
+                    std::memcpy(buffer + i, &entry, sizeof(entry));
+                }
+            }
+        }
+    };
+
+} // namespace
+
+TEST_CASE("symbol_resolver")
+{
+    remote::memory     mem;
+    remote::region_map regions;
+
+    char       exe_path[4096];
+    const auto length = ::readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    REQUIRE(length > 0);
+    exe_path[length] = 0;
+    const std::string exe(std::strrchr(exe_path, '/') + 1);
+
+    const auto libc = ::dlopen("libc.so.6", RTLD_NOW | RTLD_NOLOAD);
+    REQUIRE(libc);
+    const auto malloc_address = reinterpret_cast<std::uintptr_t>(::dlsym(libc, "malloc"));
+    const auto probe_address  = reinterpret_cast<std::uintptr_t>(&remote_memory_resolver_probe);
+
+    remote::symbol_resolver_options options;
+    options.use_cache = false;
+
+    SECTION("modules are listed from the region map") {
+        auto symbols = remote::make_symbol_resolver(mem, regions, options);
+        REQUIRE(symbols.find_module(exe));
+        REQUIRE(symbols.find_module(exe_path) == symbols.find_module(exe));
+        REQUIRE(symbols.find_module("libc.so.6"));
+        REQUIRE_FALSE(symbols.find_module("no_such_module.so"));
+
+        const auto module = symbols.find_module(exe);
+        REQUIRE(module->base <= probe_address);
+        REQUIRE(module->end > probe_address);
+        REQUIRE(module->symbols->complete());
+    }
+
+    SECTION("expressions") {
+        auto symbols = remote::make_symbol_resolver(mem, regions, options);
+        REQUIRE(symbols.resolve("libc.so.6!malloc") == malloc_address);
+        REQUIRE(symbols.resolve("libc.so.6", "malloc") == malloc_address);
+        REQUIRE(symbols.resolve(exe + "!remote_memory_resolver_probe") == probe_address);
+        REQUIRE(symbols.resolve(exe + "!remote_memory_resolver_probe+0x8") == probe_address + 8);
+        REQUIRE(symbols.resolve(exe + "!remote_memory_resolver_probe+12") == probe_address + 12);
+        REQUIRE(symbols.resolve("remote_memory_resolver_probe-4") == probe_address - 4);
+        REQUIRE(symbols.resolve("libc.so.6+0x10") == symbols.find_module("libc.so.6")->base + 0x10);
+
+        std::error_code ec;
+        REQUIRE(symbols.resolve("libc.so.6!no_such_symbol", ec) == 0);
+        REQUIRE(ec == std::errc::no_such_file_or_directory);
+        ec.clear();
+        symbols.resolve("no_such_module.so!malloc", ec);
+        REQUIRE(ec == std::errc::no_such_file_or_directory);
+        ec.clear();
+        symbols.resolve("!malloc", ec);
+        REQUIRE(ec == std::errc::invalid_argument);
+        ec.clear();
+        symbols.resolve("libc.so.6!+0x10", ec);
+        REQUIRE(ec == std::errc::invalid_argument);
+        REQUIRE_THROWS_AS(symbols.resolve("libc.so.6!no_such_symbol"), std::system_error);
+    }
+
+    SECTION("dynamic symbols are read through memory without the files") {
+        options.read_files = false;
+        auto symbols       = remote::make_symbol_resolver(mem, regions, options);
+        REQUIRE(symbols.resolve("libc.so.6!malloc") == malloc_address);
+        REQUIRE_FALSE(symbols.find_module("libc.so.6")->symbols->complete());
+        REQUIRE_FALSE(symbols.find_module("libc.so.6")->symbols->build_id().empty());
+    }
+
+    SECTION("sizes larger than the image fail the index") {
+        link_map* map = nullptr;
+        REQUIRE(::dlinfo(libc, RTLD_DI_LINKMAP, &map) == 0);
+        const corrupt_dynamic_memory corrupt{reinterpret_cast<std::uintptr_t>(map->l_ld)};
+
+        options.read_files = false;
+        auto            symbols = remote::make_symbol_resolver(corrupt, regions, options);
+        std::error_code ec;
+        REQUIRE(symbols.resolve("libc.so.6!malloc", ec) == 0);
+        REQUIRE(ec == std::errc::executable_format_error);
+    }
+
+    SECTION("indexes are shared by build id") {
+        remote::symbol_resolver<remote::memory>::clear_cache();
+        auto first  = remote::make_symbol_resolver(mem, regions);
+        auto second = remote::make_symbol_resolver(mem, regions);
+        REQUIRE(first.resolve("libc.so.6!malloc") == malloc_address);
+        REQUIRE(first.find_module("libc.so.6")->symbols == second.find_module("libc.so.6")->symbols);
+        REQUIRE(remote::symbol_resolver<remote::memory>::cached() > 0);
+        remote::symbol_resolver<remote::memory>::clear_cache();
+    }
+}
+
+#endif
+
+#if defined(__linux__)
+
+#include <remote_memory/consistent_capture.hpp>
+#include <sys/stat.h>
+
+namespace {
+
+    // written by a forked child, x always runs ahead of y by at most one
+    volatile std::uint64_t consistent_capture_counters[2 * 512];
+
+    pid_t spawn_counting_child()
+    {
+        const auto child = ::fork();
+        if (child == 0)
+            for (std::uint64_t n = 1;; ++n) {
+                consistent_capture_counters[0]   = n;
+                consistent_capture_counters[512] = n;
+            }
+
+        return child;
+    }
+
+} // namespace
+
+TEST_CASE("capture_consistent")
+{
+    const auto child = spawn_counting_child();
+    REQUIRE(child > 0);
+
+    remote::memory   mem(child);
+    remote::snapshot snap;
+    const auto       begin = reinterpret_cast<std::uintptr_t>(&consistent_capture_counters[0]);
+    const auto       end   = reinterpret_cast<std::uintptr_t>(&consistent_capture_counters[2 * 512]);
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+    };
+    const range regions[] = {{begin, end}};
+
+    const auto counters = [&] {
+        const auto x = snap.find(begin, 8);
+        const auto y = snap.find(begin + 512 * 8, 8);
+        REQUIRE(x);
+        REQUIRE(y);
+        std::uint64_t values[2];
+        std::memcpy(&values[0], x, 8);
+        std::memcpy(&values[1], y, 8);
+        return std::make_pair(values[0], values[1]);
+    };
+
+    SECTION("the counters are captured at one moment") {
+        std::uint64_t last = 0;
+        for (int i = 0; i < 20; ++i) {
+            const auto result = remote::capture_consistent(snap, mem, child, regions);
+            REQUIRE(result.method == remote::freeze_method::signal);
+            REQUIRE(result.pause.count() > 0);
+            REQUIRE(result.freeze <= result.pause);
+            REQUIRE(result.copied > 0);
+
+            const auto values = counters();
+            REQUIRE(values.first - values.second <= 1);
+            REQUIRE(values.first >= last);
+            last = values.first;
+        }
+
+        // the child keeps running afterwards
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        remote::capture_consistent(snap, mem, child, regions);
+        REQUIRE(counters().first > last);
+    }
+
+    SECTION("without pre-copy everything is copied while frozen") {
+        remote::consistent_capture_options options;
+        options.precopy   = false;
+        const auto result = remote::capture_consistent(snap, mem, child, regions, options);
+        REQUIRE_FALSE(result.dirty_tracking);
+        REQUIRE(result.precopied == 0);
+        REQUIRE(result.copied == end - begin);
+        REQUIRE(counters().first - counters().second <= 1);
+    }
+
+    SECTION("the cgroup freezer") {
+        const auto mount = remote::detail::cgroup2_mount();
+        const auto group = mount + "/remote_memory_test_" + std::to_string(child);
+        if (!mount.empty() && ::mkdir(group.c_str(), 0755) == 0) {
+            if (remote::detail::write_text(group + "/cgroup.procs", std::to_string(child).c_str())) {
+                remote::consistent_capture_options options;
+                options.method    = remote::freeze_method::cgroup;
+                const auto result = remote::capture_consistent(snap, mem, child, regions, options);
+                REQUIRE(result.method == remote::freeze_method::cgroup);
+                REQUIRE(counters().first - counters().second <= 1);
+
+                std::string frozen;
+                REQUIRE(remote::detail::read_text(group + "/cgroup.freeze", frozen));
+                REQUIRE(frozen == "0\n");
+            }
+
+            ::kill(child, SIGKILL);
+            ::waitpid(child, nullptr, 0);
+            // the cgroup can only be removed once it is empty
+            while (::rmdir(group.c_str()) != 0 && errno == EBUSY)
+                std::this_thread::yield();
+        }
+    }
+
+    SECTION("errors") {
+        std::error_code ec;
+        remote::capture_consistent(snap, remote::memory(), ::getpid(), regions, {}, ec);
+        REQUIRE(ec == std::errc::invalid_argument);
+    }
+
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+
+    SECTION("a process that exited can not be frozen") {
+        remote::consistent_capture_options options;
+        options.method = remote::freeze_method::signal;
+        REQUIRE_THROWS_AS(remote::capture_consistent(snap, mem, child, regions, options), std::system_error);
+    }
+}
+
+#endif